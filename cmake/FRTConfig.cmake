@@ -1,6 +1,7 @@
 set(THREADS_PREFER_PTHREAD_FLAG TRUE)
 find_package(Threads REQUIRED)
 find_package(OpenCL REQUIRED)
+find_package(LZ4 REQUIRED PATHS ${CMAKE_CURRENT_LIST_DIR})
 find_package(TinyXML REQUIRED PATHS ${CMAKE_CURRENT_LIST_DIR})
 find_package(XRT PATHS ${CMAKE_CURRENT_LIST_DIR})
 find_package(SDx PATHS ${CMAKE_CURRENT_LIST_DIR})
@@ -0,0 +1,21 @@
+find_path(LZ4_INCLUDE_DIR NAMES lz4.h)
+find_library(LZ4_LIBRARY NAMES lz4)
+
+find_package_handle_standard_args(LZ4
+                                  FOUND_VAR
+                                  LZ4_FOUND
+                                  REQUIRED_VARS
+                                  LZ4_LIBRARY
+                                  LZ4_INCLUDE_DIR)
+
+mark_as_advanced(LZ4_INCLUDE_DIR LZ4_LIBRARY)
+
+if(LZ4_FOUND AND NOT TARGET LZ4::LZ4)
+  add_library(LZ4::LZ4 IMPORTED INTERFACE)
+  set_target_properties(
+    LZ4::LZ4
+    PROPERTIES INTERFACE_LINK_LIBRARIES "${LZ4_LIBRARY}")
+  set_target_properties(LZ4::LZ4
+                        PROPERTIES INTERFACE_INCLUDE_DIRECTORIES
+                                   "${LZ4_INCLUDE_DIR}")
+endif()
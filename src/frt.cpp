@@ -1,13 +1,23 @@
 #include "frt.h"
 
+#include <cmath>
+#include <cstdint>
+
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <CL/cl2.hpp>
 
 #include "frt/intel_opencl_device.h"
+#include "frt/page_preparer.h"
+#include "frt/probes.h"
 #include "frt/tapa_fast_cosim_device.h"
 #include "frt/xilinx_opencl_device.h"
 
@@ -15,45 +25,167 @@ namespace fpga {
 
 Instance::Instance(const std::string& bitstream) {
   std::clog << "INFO: Loading " << bitstream << std::endl;
+  FRT_PROBE(instance__load__begin, bitstream.c_str());
   cl::Program::Binaries binaries;
   {
     std::ifstream stream(bitstream, std::ios::binary);
     binaries = {{std::istreambuf_iterator<char>(stream),
                  std::istreambuf_iterator<char>()}};
   }
+  FRT_PROBE(instance__load__read, bitstream.c_str(),
+            binaries.begin()->size());
 
-  if ((device_ = internal::XilinxOpenclDevice::New(binaries))) {
-    return;
+  if (!(device_ = internal::XilinxOpenclDevice::New(binaries)) &&
+      !(device_ = internal::IntelOpenclDevice::New(binaries)) &&
+      !(device_ = internal::TapaFastCosimDevice::New(
+            bitstream, std::string_view(
+                           reinterpret_cast<char*>(binaries.begin()->data()),
+                           binaries.begin()->size())))) {
+    throw std::runtime_error("unexpected bitstream file");
   }
 
-  if ((device_ = internal::IntelOpenclDevice::New(binaries))) {
-    return;
-  }
+  instrumentation_id_ = device_->GetInstrumentationId();
+  const std::string device_name = device_->GetDeviceName();
+  live_stats_ = internal::LiveStatsSlot::Create(bitstream, device_name);
+  FRT_PROBE(instance__load__end, instrumentation_id_, device_name.c_str());
+}
 
-  if ((device_ = internal::TapaFastCosimDevice::New(
-           bitstream,
-           std::string_view(reinterpret_cast<char*>(binaries.begin()->data()),
-                            binaries.begin()->size())))) {
-    return;
+size_t Instance::SuspendBuf(int index) { return device_->SuspendBuffer(index); }
+
+void Instance::PrepareBuffer(const void* ptr, size_t size, bool is_output) {
+  internal::PagePreparer::Prepare(ptr, size, is_output, /* pin = */ true);
+}
+
+void Instance::SetBufferBank(int index, int bank) {
+  device_->SetBufferBank(index, bank);
+}
+
+void Instance::SetBandwidthLimit(const BandwidthLimit& limit) {
+  device_->SetBandwidthLimit(limit);
+}
+
+void Instance::DeferSubmission(size_t max_operations) {
+  device_->SetDeferredSubmission(max_operations);
+}
+
+void Instance::Flush() { device_->Flush(); }
+
+void Instance::WriteToDevice() {
+  FRT_PROBE(write__begin, instrumentation_id_);
+  device_->WriteToDevice();
+  FRT_PROBE(write__end, instrumentation_id_);
+}
+
+void Instance::ReadFromDevice() {
+  FRT_PROBE(read__begin, instrumentation_id_);
+  device_->ReadFromDevice();
+  FRT_PROBE(read__end, instrumentation_id_);
+}
+
+void Instance::Exec() {
+  FRT_PROBE(exec__begin, instrumentation_id_);
+  device_->Exec();
+  FRT_PROBE(exec__end, instrumentation_id_);
+  if (!is_capturing_) {
+    StartRegisterSampler();
+    if (live_stats_ != nullptr) {
+      live_stats_->AddLaunch();
+    }
   }
+}
 
-  throw std::runtime_error("unexpected bitstream file");
+void Instance::Finish() {
+  FRT_PROBE(finish__begin, instrumentation_id_);
+  device_->Finish();
+  FRT_PROBE(finish__end, instrumentation_id_);
+  if (is_capturing_) {
+    is_finish_captured_ = true;
+  } else {
+    StopRegisterSampler();
+    AccountUsage();
+  }
 }
 
-size_t Instance::SuspendBuf(int index) { return device_->SuspendBuffer(index); }
+void Instance::SetTenant(const std::string& tenant) { tenant_ = tenant; }
 
-void Instance::WriteToDevice() { device_->WriteToDevice(); }
+void Instance::BeginCapture() {
+  device_->BeginCapture();
+  is_capturing_ = true;
+  is_finish_captured_ = false;
+}
 
-void Instance::ReadFromDevice() { device_->ReadFromDevice(); }
+void Instance::EndCapture() {
+  device_->EndCapture();
+  is_capturing_ = false;
+}
 
-void Instance::Exec() { device_->Exec(); }
+void Instance::Replay() {
+  FRT_PROBE(replay__begin, instrumentation_id_);
+  StartRegisterSampler();
+  // Each replay is counted as one launch.
+  if (live_stats_ != nullptr) {
+    live_stats_->AddLaunch();
+  }
+  device_->Replay();
+  if (is_finish_captured_) {
+    StopRegisterSampler();
+    AccountUsage();
+  }
+  FRT_PROBE(replay__end, instrumentation_id_);
+}
 
-void Instance::Finish() { device_->Finish(); }
+void Instance::EnableResultCache(const ResultCacheOptions& options) {
+  result_cache_ = std::make_unique<internal::ResultCache>(options);
+}
+
+ResultCacheStats Instance::GetResultCacheStats() const {
+  return result_cache_ == nullptr ? ResultCacheStats()
+                                  : result_cache_->GetStats();
+}
 
 std::vector<ArgInfo> Instance::GetArgsInfo() const {
   return device_->GetArgsInfo();
 }
 
+StartupProfile Instance::GetStartupProfile() const {
+  return device_->GetStartupProfile();
+}
+
+Timeline Instance::GetTimeline() const { return device_->GetTimeline(); }
+
+uint64_t Instance::GetInstrumentationId() const {
+  return instrumentation_id_;
+}
+
+uint32_t Instance::ReadRegister(const std::string& name) {
+  return device_->ReadRegister(name);
+}
+
+void Instance::SampleRegisters(const std::vector<std::string>& names,
+                               std::chrono::nanoseconds period) {
+  if (!names.empty() && period.count() <= 0) {
+    throw std::invalid_argument("sampling period must be positive");
+  }
+  // Fail early if any register cannot be read.
+  for (const auto& name : names) {
+    device_->ReadRegister(name);
+  }
+  sampled_registers_ = names;
+  sample_period_ = period;
+}
+
+std::vector<RegisterSample> Instance::GetRegisterSamples() const {
+  return register_samples_;
+}
+
+ThrottleStats Instance::GetThrottleStats() const {
+  return device_->GetThrottleStats();
+}
+
+CompressionStats Instance::GetCompressionStats() const {
+  return device_->GetCompressionStats();
+}
+
 int64_t Instance::LoadTimeNanoSeconds() {
   return device_->LoadTimeNanoSeconds();
 }
@@ -78,6 +210,51 @@ double Instance::StoreTimeSeconds() {
   return static_cast<double>(StoreTimeNanoSeconds()) * 1e-9;
 }
 
+CalibrationProfile Instance::Calibrate(const CalibrationOptions& options) {
+  if (is_capturing_) {
+    throw std::runtime_error("cannot calibrate while capturing");
+  }
+  if (options.transfer_sizes.size() < 2 || options.repetitions < 1) {
+    throw std::invalid_argument(
+        "calibration needs two transfer sizes and one repetition");
+  }
+  CalibrationProfile profile;
+  profile.platform = device_->GetPlatformName();
+  profile.device = device_->GetDeviceName();
+  for (bool is_store : {false, true}) {
+    std::vector<std::pair<double, double>> points;
+    for (size_t size : options.transfer_sizes) {
+      int64_t time_ns = INT64_MAX;
+      for (int i = 0; i < options.repetitions; ++i) {
+        time_ns = std::min(time_ns,
+                           device_->ProbeTransferNanoSeconds(size, is_store));
+      }
+      points.push_back({static_cast<double>(size),
+                        static_cast<double>(time_ns)});
+    }
+    const auto [latency_ns, ns_per_byte] = internal::FitLine(points);
+    (is_store ? profile.store_latency_ns : profile.load_latency_ns) =
+        std::llround(latency_ns);
+    (is_store ? profile.store_bytes_per_ns : profile.load_bytes_per_ns) =
+        ns_per_byte > 0 ? 1 / ns_per_byte : 0;
+  }
+  if (options.probe_launch) {
+    profile.launch_latency_ns = INT64_MAX;
+    for (int i = 0; i < options.repetitions; ++i) {
+      device_->Exec();
+      device_->Finish();
+      profile.launch_latency_ns =
+          std::min(profile.launch_latency_ns, ComputeTimeNanoSeconds());
+    }
+  }
+  internal::SaveCalibration(profile);
+  return profile;
+}
+
+std::optional<CalibrationProfile> Instance::GetCalibration() const {
+  return LoadCalibration(device_->GetPlatformName(), device_->GetDeviceName());
+}
+
 double Instance::LoadThroughputGbps() {
   return static_cast<double>(device_->LoadBytes()) /
          static_cast<double>(LoadTimeNanoSeconds());
@@ -88,4 +265,62 @@ double Instance::StoreThroughputGbps() {
          static_cast<double>(StoreTimeNanoSeconds());
 }
 
+bool Instance::LoadCachedResult() {
+  if (result_cache_ == nullptr) {
+    return false;
+  }
+  const bool is_hit = result_cache_->Lookup();
+  FRT_PROBE(result__cache__lookup, instrumentation_id_, is_hit);
+  if (live_stats_ != nullptr) {
+    live_stats_->AddCacheLookup(is_hit);
+  }
+  return is_hit;
+}
+
+void Instance::AccountUsage() {
+  if (tenant_.empty() && live_stats_ == nullptr) {
+    return;
+  }
+  TenantUsage usage;
+  usage.invocations = 1;
+  usage.queue_time_ns = device_->QueueTimeNanoSeconds();
+  usage.load_time_ns = LoadTimeNanoSeconds();
+  usage.compute_time_ns = ComputeTimeNanoSeconds();
+  usage.store_time_ns = StoreTimeNanoSeconds();
+  usage.load_bytes = device_->LoadBytes();
+  usage.store_bytes = device_->StoreBytes();
+  if (!tenant_.empty()) {
+    internal::AddTenantUsage(tenant_, usage);
+  }
+  if (live_stats_ != nullptr) {
+    live_stats_->Finish(usage);
+  }
+}
+
+void Instance::StartRegisterSampler() {
+  if (sampled_registers_.empty()) {
+    return;
+  }
+  // A new invocation starts when the kernels are launched again.
+  register_sampler_ = std::make_unique<internal::RegisterSampler>(
+      [device = device_.get()](const std::string& name) {
+        return device->ReadRegister(name);
+      },
+      sampled_registers_, sample_period_);
+}
+
+void Instance::StopRegisterSampler() {
+  if (register_sampler_ != nullptr) {
+    register_samples_ = register_sampler_->Stop();
+    register_sampler_.reset();
+  }
+}
+
+void Instance::CacheResult() {
+  if (result_cache_ != nullptr) {
+    result_cache_->Insert(LoadTimeNanoSeconds() + ComputeTimeNanoSeconds() +
+                          StoreTimeNanoSeconds());
+  }
+}
+
 }  // namespace fpga
@@ -2,11 +2,13 @@
 #define FPGA_RUNTIME_H_
 
 #include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <ratio>
 #include <string>
 #include <type_traits>
@@ -14,11 +16,22 @@
 #include <vector>
 
 #include "frt/arg_info.h"
+#include "frt/bandwidth_limit.h"
 #include "frt/buffer.h"
+#include "frt/calibration.h"
+#include "frt/compression.h"
 #include "frt/device.h"
+#include "frt/instrumentation.h"
+#include "frt/live_stats.h"
+#include "frt/record_stream.h"
+#include "frt/register_sampler.h"
+#include "frt/result_cache.h"
+#include "frt/startup_profile.h"
 #include "frt/stream.h"
 #include "frt/stream_wrapper.h"
 #include "frt/tag.h"
+#include "frt/tenant_usage.h"
+#include "frt/timeline.h"
 
 namespace fpga {
 
@@ -31,6 +44,16 @@ using ReadWriteBuffer = internal::Buffer<T, internal::Tag::kReadWrite>;
 template <typename T>
 using PlaceholderBuffer = internal::Buffer<T, internal::Tag::kPlaceHolder>;
 
+template <typename T>
+using ReadOnlyChunkedBuffer =
+    internal::ChunkedBuffer<T, internal::Tag::kReadOnly>;
+template <typename T>
+using WriteOnlyChunkedBuffer =
+    internal::ChunkedBuffer<T, internal::Tag::kWriteOnly>;
+template <typename T>
+using ReadWriteChunkedBuffer =
+    internal::ChunkedBuffer<T, internal::Tag::kReadWrite>;
+
 template <typename T>
 ReadOnlyBuffer<T> ReadOnly(T* ptr, size_t n) {
   return ReadOnlyBuffer<T>(ptr, n);
@@ -48,9 +71,40 @@ PlaceholderBuffer<T> Placeholder(T* ptr, size_t n) {
   return PlaceholderBuffer<T>(ptr, n);
 }
 
+// Buffers made of (pointer, element count) chunks of host memory.
+template <typename T>
+ReadOnlyChunkedBuffer<T> ReadOnly(
+    const std::vector<std::pair<T*, size_t>>& chunks) {
+  return ReadOnlyChunkedBuffer<T>(chunks);
+}
+template <typename T>
+WriteOnlyChunkedBuffer<T> WriteOnly(
+    const std::vector<std::pair<T*, size_t>>& chunks) {
+  return WriteOnlyChunkedBuffer<T>(chunks);
+}
+template <typename T>
+ReadWriteChunkedBuffer<T> ReadWrite(
+    const std::vector<std::pair<T*, size_t>>& chunks) {
+  return ReadWriteChunkedBuffer<T>(chunks);
+}
+
+// Buffers transferred in the block format of LZ4-compressed blocks, for
+// kernels with on-chip decompressors or compressors; see `CompressionOptions`
+// and `internal::BlockCompressor` for the format. Inputs are compressed on
+// helper threads, and each block is transferred as soon as it is compressed.
+// Outputs are read back and decompressed when `Finish` is called.
+template <typename T, internal::Tag tag>
+internal::CompressedBuffer<T, tag> Compressed(
+    internal::Buffer<T, tag> buffer, const CompressionOptions& options = {}) {
+  return internal::CompressedBuffer<T, tag>(buffer, options);
+}
+
 using ReadStream = internal::Stream<internal::Tag::kReadOnly>;
 using WriteStream = internal::Stream<internal::Tag::kWriteOnly>;
 
+using RecordReader = internal::RecordReader;
+using RecordWriter = internal::RecordWriter;
+
 class Instance {
  public:
   Instance(const std::string& bitstream);
@@ -59,12 +113,40 @@ class Instance {
   template <typename T>
   void SetArg(int index, T arg) {
     device_->SetScalarArg(index, &arg, sizeof(arg));
+    if (result_cache_ != nullptr) {
+      result_cache_->SetScalarArg(index, &arg, sizeof(arg));
+    }
   }
 
   // Sets a buffer argument.
   template <typename T, internal::Tag tag>
   void SetArg(int index, internal::Buffer<T, tag> arg) {
     device_->SetBufferArg(index, tag, arg);
+    if (result_cache_ != nullptr) {
+      result_cache_->SetBufferArg(index, tag, arg);
+    }
+  }
+
+  // Sets a buffer argument gathered from chunks of host memory.
+  template <typename T, internal::Tag tag>
+  void SetArg(int index, internal::ChunkedBuffer<T, tag> arg) {
+    const auto& buffers = arg.GetChunks();
+    const std::vector<internal::BufferArg> chunks(buffers.begin(),
+                                                  buffers.end());
+    device_->SetChunkedBufferArg(index, tag, chunks);
+    if (result_cache_ != nullptr) {
+      result_cache_->SetChunkedBufferArg(index, tag, chunks);
+    }
+  }
+
+  // Sets a buffer argument transferred in the compressed block format.
+  template <typename T, internal::Tag tag>
+  void SetArg(int index, internal::CompressedBuffer<T, tag> arg) {
+    device_->SetCompressedBufferArg(index, tag, arg.GetBuffer(),
+                                    arg.GetOptions());
+    if (result_cache_ != nullptr) {
+      result_cache_->SetBufferArg(index, tag, arg.GetBuffer());
+    }
   }
 
   // Sets a stream argument.
@@ -88,6 +170,51 @@ class Instance {
   // returns the number of transfer operations suspended.
   size_t SuspendBuf(int index);
 
+  // Prefaults and pins the pages of `buf` on helper threads in the background,
+  // so that its first transfer is not slowed by page faults in the driver.
+  // Call it early for newly allocated buffers, e.g., while earlier
+  // invocations are still running; transfers of `buf` wait for it to finish.
+  // Input buffers are only read, so they may be read-only memory. Pinned
+  // pages stay locked until they are unmapped or the process exits.
+  template <typename T, internal::Tag tag>
+  void PrepareBuf(internal::Buffer<T, tag> buf) {
+    PrepareBuffer(buf.Get(), buf.SizeInBytes(),
+                  /* is_output = */ tag == internal::Tag::kReadOnly ||
+                      tag == internal::Tag::kReadWrite);
+  }
+  template <typename T, internal::Tag tag>
+  void PrepareBuf(const internal::ChunkedBuffer<T, tag>& buf) {
+    for (const auto& chunk : buf.GetChunks()) {
+      PrepareBuf(chunk);
+    }
+  }
+
+  // Allocates the buffer of argument `index` in `bank` of its memory instead
+  // of an automatically chosen one. Must be called before the argument is set.
+  // Only supported on Intel devices; the chosen banks are reported by
+  // `GetArgsInfo`.
+  void SetBufferBank(int index, int bank);
+
+  // Limits the host-to-device and device-to-host bandwidth of this instance,
+  // so that it does not starve other instances sharing the link. Transfers
+  // are split into chunks, and each chunk is held by a helper thread once it
+  // is ready to run until token buckets allow it; the time spent holding is
+  // reported by `GetThrottleStats`. On Xilinx devices, buffers larger than
+  // `BandwidthLimit::chunk_bytes` are not throttled.
+  void SetBandwidthLimit(const BandwidthLimit& limit);
+
+  // Defers submitting the commands of `WriteToDevice`, `Exec`, and
+  // `ReadFromDevice` to the driver until `Flush` or `Finish` is called, or
+  // until `max_operations` of these calls have accumulated, so that commands
+  // of one or more invocations are submitted together. Commands of other
+  // instances that depend on deferred ones, e.g., via shared host memory, wait
+  // for the flush as well. Zero flushes and submits commands immediately,
+  // which is the default.
+  void DeferSubmission(size_t max_operations);
+
+  // Submits deferred commands to the device without waiting for them.
+  void Flush();
+
   // Writes buffers to the device.
   void WriteToDevice();
 
@@ -100,33 +227,99 @@ class Instance {
   // Waits for the program to finish.
   void Finish();
 
+  // Accounts the device usage of invocations to `tenant`, which is reported by
+  // `GetTenantUsage`. Usage is accounted when `Finish` returns, or when a
+  // replayed graph that contains `Finish` returns. An empty `tenant` disables
+  // accounting.
+  void SetTenant(const std::string& tenant);
+
   // Invokes the program on the device. This is a shortcut for `SetArgs`,
   // `WriteToDevice`, `Exec`, `ReadFromDevice`, and if there is no stream
-  // arguments, `Finish` as well.
+  // arguments, `Finish` as well. If the result cache is enabled and there is
+  // no stream arguments, cached results are used if available.
   template <typename... Args>
   Instance& Invoke(Args&&... args) {
     SetArgs(std::forward<Args>(args)...);
-    WriteToDevice();
-    Exec();
-    ReadFromDevice();
     bool has_stream = false;
     bool _[sizeof...(Args)] = {(
         has_stream |=
         std::is_base_of<internal::StreamWrapper,
                         typename std::remove_reference<Args>::type>::value)...};
+    if (!has_stream && LoadCachedResult()) {
+      return *this;
+    }
+    WriteToDevice();
+    Exec();
+    ReadFromDevice();
     if (!has_stream) {
 #ifndef NDEBUG
       std::clog << "DEBUG: no stream found; waiting for command to finish"
                 << std::endl;
 #endif
       Finish();
+      CacheResult();
     }
     return *this;
   }
 
+  // Enables caching the results of `Invoke` by its scalar arguments and the
+  // content of its input buffers, for programs that are pure functions of
+  // them. On a hit, output buffers are copied from the cache and the device
+  // is not used; the timing functions keep reporting the last device run.
+  void EnableResultCache(const ResultCacheOptions& options = {});
+
+  // Returns statistics of the result cache.
+  ResultCacheStats GetResultCacheStats() const;
+
+  // Starts capturing `WriteToDevice`, `Exec`, `ReadFromDevice`, and `Finish`
+  // into a graph instead of running them. Arguments set during capture take
+  // effect immediately and are not captured.
+  void BeginCapture();
+
+  // Stops capturing.
+  void EndCapture();
+
+  // Runs the captured graph. Buffers are bound when captured, so the host
+  // memory must stay at the same address; its content may change.
+  void Replay();
+
   // Returns information of all args as a vector, sorted by the index.
   std::vector<ArgInfo> GetArgsInfo() const;
 
+  // Returns the time spent loading the bitstream.
+  StartupProfile GetStartupProfile() const;
+
+  // Returns when the last invocation was enqueued, loaded, computed, and
+  // stored, in host time. Profiling timestamps of OpenCL devices are mapped
+  // from the device clock, which is synchronized with the host periodically.
+  Timeline GetTimeline() const;
+
+  // Returns the id of this instance in the events reported to
+  // instrumentation observers; see `AddInstrumentationObserver`.
+  uint64_t GetInstrumentationId() const;
+
+  // Returns the value of kernel register `name`, e.g., a performance counter
+  // exposed by the kernel. Registers are named after the kernel arguments
+  // whose control register offsets are in the bitstream metadata. Only
+  // supported on Xilinx devices.
+  uint32_t ReadRegister(const std::string& name);
+
+  // Samples registers `names` every `period` while the kernels are running,
+  // i.e., from `Exec` until `Finish` returns, and once more after that.
+  // Samples of the last invocation are reported by `GetRegisterSamples`. An
+  // empty `names` disables sampling.
+  void SampleRegisters(const std::vector<std::string>& names,
+                       std::chrono::nanoseconds period);
+
+  // Returns the register samples of the last invocation.
+  std::vector<RegisterSample> GetRegisterSamples() const;
+
+  // Returns the time transfers have waited for bandwidth limits.
+  ThrottleStats GetThrottleStats() const;
+
+  // Returns the bytes and the host time of compressed buffers.
+  CompressionStats GetCompressionStats() const;
+
   // Returns the load time in nanoseconds.
   int64_t LoadTimeNanoSeconds();
 
@@ -145,6 +338,16 @@ class Instance {
   // Returns the store time in seconds.
   double StoreTimeSeconds();
 
+  // Fits the transfer and launch performance of the device from probes run
+  // on this instance, saves it for the device, and returns it. Transfers use
+  // scratch buffers. Kernels are only launched if `options.probe_launch` is
+  // set, repeatedly with the arguments that are set, which should make them
+  // do (nearly) nothing.
+  CalibrationProfile Calibrate(const CalibrationOptions& options = {});
+
+  // Returns the profile saved for the device of this instance, if any.
+  std::optional<CalibrationProfile> GetCalibration() const;
+
   // Returns the load throughput in GB/s.
   double LoadThroughputGbps();
 
@@ -158,7 +361,27 @@ class Instance {
     SetArg(index + 1, std::forward<Args>(other_args)...);
   }
 
+  void PrepareBuffer(const void* ptr, size_t size, bool is_output);
+  bool LoadCachedResult();
+  void CacheResult();
+  void AccountUsage();
+  void StartRegisterSampler();
+  void StopRegisterSampler();
+
   std::unique_ptr<internal::Device> device_;
+  // Cached for probes, which must not call the device.
+  uint64_t instrumentation_id_ = 0;
+  std::unique_ptr<internal::ResultCache> result_cache_;
+  std::string tenant_;
+  bool is_capturing_ = false;
+  bool is_finish_captured_ = false;
+  std::vector<std::string> sampled_registers_;
+  std::chrono::nanoseconds sample_period_{};
+  std::vector<RegisterSample> register_samples_;
+  // Declared after `device_`, which it reads, so that it is destroyed first.
+  std::unique_ptr<internal::RegisterSampler> register_sampler_;
+  // Null if live statistics are not published.
+  std::unique_ptr<internal::LiveStatsSlot> live_stats_;
 };
 
 template <typename Arg, typename... Args>
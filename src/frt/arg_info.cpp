@@ -19,6 +19,12 @@ std::ostream& operator<<(std::ostream& os, const ArgInfo::Cat& cat) {
 std::ostream& operator<<(std::ostream& os, const ArgInfo& arg) {
   os << "ArgInfo: {index: " << arg.index << ", name: '" << arg.name
      << "', type: '" << arg.type << "', category: " << arg.cat;
+  if (!arg.memory.empty()) {
+    os << ", memory: '" << arg.memory << "'";
+  }
+  if (arg.bank >= 0) {
+    os << ", bank: " << arg.bank;
+  }
   os << "}";
   return os;
 }
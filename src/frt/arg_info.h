@@ -16,6 +16,11 @@ struct ArgInfo {
   std::string name;
   std::string type;
   Cat cat;
+  // Memory of memory-mapped arguments, if known, e.g., "DDR".
+  std::string memory;
+  // Bank of `memory` that the buffer is allocated in, or -1 if the bank is
+  // chosen by the vendor runtime.
+  int bank = -1;
 };
 
 std::ostream& operator<<(std::ostream& os, const ArgInfo::Cat& cat);
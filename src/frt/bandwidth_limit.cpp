@@ -0,0 +1,51 @@
+#include "frt/bandwidth_limit.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+
+namespace fpga {
+
+std::ostream& operator<<(std::ostream& os, const ThrottleStats& stats) {
+  os << "ThrottleStats: {load: " << stats.load_throttled_time_ns
+     << " ns, store: " << stats.store_throttled_time_ns
+     << " ns, commands: " << stats.throttled_commands;
+  os << "}";
+  return os;
+}
+
+namespace internal {
+
+TokenBucket::TokenBucket(double bytes_per_second, size_t burst_bytes)
+    : bytes_per_second_(bytes_per_second),
+      capacity_(std::max<double>(burst_bytes, 1)),
+      tokens_(capacity_),
+      last_refill_(clock::now()) {}
+
+std::chrono::nanoseconds TokenBucket::Reserve(size_t bytes) {
+  if (!IsLimited()) {
+    return {};
+  }
+  const auto now = clock::now();
+  if (now > last_refill_) {
+    const std::chrono::duration<double> elapsed = now - last_refill_;
+    tokens_ =
+        std::min(capacity_, tokens_ + bytes_per_second_ * elapsed.count());
+    last_refill_ = now;
+  }
+  // Transfers larger than the capacity wait for a full bucket and leave it in
+  // debt, which later transfers pay back.
+  const double needed = std::min<double>(bytes, capacity_);
+  std::chrono::nanoseconds delay{};
+  if (tokens_ < needed) {
+    delay = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>((needed - tokens_) / bytes_per_second_));
+    tokens_ = needed;
+    last_refill_ += delay;
+  }
+  tokens_ -= bytes;
+  return delay;
+}
+
+}  // namespace internal
+}  // namespace fpga
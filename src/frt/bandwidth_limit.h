@@ -0,0 +1,60 @@
+#ifndef FPGA_RUNTIME_BANDWIDTH_LIMIT_H_
+#define FPGA_RUNTIME_BANDWIDTH_LIMIT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <ostream>
+
+namespace fpga {
+
+struct BandwidthLimit {
+  // Host-to-device and device-to-host rates in bytes per second. Zero means
+  // unlimited.
+  double load_bytes_per_second = 0;
+  double store_bytes_per_second = 0;
+  // Bytes that may be transferred at once after the link has been idle.
+  size_t burst_bytes = size_t{16} << 20;
+  // Throttled transfers are split into commands of at most this size. Xilinx
+  // devices cannot split a buffer, so larger buffers are not throttled there.
+  size_t chunk_bytes = size_t{4} << 20;
+};
+
+struct ThrottleStats {
+  // Time transfers were held after their dependencies had completed.
+  int64_t load_throttled_time_ns = 0;
+  int64_t store_throttled_time_ns = 0;
+  // Number of transfer commands that had to wait.
+  int64_t throttled_commands = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const ThrottleStats& stats);
+
+namespace internal {
+
+// Paces a stream of transfers to a rate, allowing bursts up to a capacity.
+class TokenBucket {
+ public:
+  TokenBucket() = default;
+  TokenBucket(double bytes_per_second, size_t burst_bytes);
+
+  bool IsLimited() const { return bytes_per_second_ > 0; }
+
+  // Takes `bytes` from the bucket and returns how long to wait before they
+  // may be transferred. The bucket refills as if the wait has passed.
+  std::chrono::nanoseconds Reserve(size_t bytes);
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  double bytes_per_second_ = 0;
+  double capacity_ = 0;
+  double tokens_ = 0;
+  clock::time_point last_refill_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_BANDWIDTH_LIMIT_H_
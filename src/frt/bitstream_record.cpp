@@ -0,0 +1,64 @@
+#include "frt/bitstream_record.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <optional>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include "frt/environ.h"
+
+namespace fpga {
+namespace internal {
+
+BitstreamRecord::BitstreamRecord(const std::string& device_name) {
+  std::string path = GetRuntimeDir() + "/bitstream.";
+  for (char c : device_name) {
+    path += isalnum(c) ? c : '_';
+  }
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  PLOG_IF(FATAL, fd_ < 0) << "cannot open '" << path << "'";
+  PLOG_IF(FATAL, flock(fd_, LOCK_EX)) << "cannot lock '" << path << "'";
+}
+
+BitstreamRecord::~BitstreamRecord() { close(fd_); }
+
+std::optional<uint64_t> BitstreamRecord::Get() const {
+  char buf[32] = {};
+  const ssize_t size = pread(fd_, buf, sizeof(buf) - 1, /* offset = */ 0);
+  if (size <= 0) {
+    return std::nullopt;
+  }
+  char* end;
+  const uint64_t hash = strtoull(buf, &end, 16);
+  if (end == buf || *end != '\n') {
+    return std::nullopt;
+  }
+  return hash;
+}
+
+void BitstreamRecord::Set(uint64_t hash) {
+  char buf[32];
+  const int size = snprintf(buf, sizeof(buf), "%016llx\n",
+                            static_cast<unsigned long long>(hash));
+  Clear();
+  PLOG_IF(WARNING, pwrite(fd_, buf, size, /* offset = */ 0) != size)
+      << "cannot record bitstream";
+}
+
+void BitstreamRecord::Clear() {
+  PLOG_IF(WARNING, ftruncate(fd_, 0)) << "cannot clear bitstream record";
+}
+
+}  // namespace internal
+}  // namespace fpga
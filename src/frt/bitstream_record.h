@@ -0,0 +1,40 @@
+#ifndef FPGA_RUNTIME_BITSTREAM_RECORD_H_
+#define FPGA_RUNTIME_BITSTREAM_RECORD_H_
+
+#include <cstdint>
+
+#include <optional>
+#include <string>
+
+namespace fpga {
+namespace internal {
+
+// Records the hash of the bitstream loaded on a device, shared by all
+// processes of the user via a file in the runtime directory.
+//
+// The record is locked from construction to destruction, so that processes
+// load bitstreams to the same device one at a time.
+class BitstreamRecord {
+ public:
+  explicit BitstreamRecord(const std::string& device_name);
+  BitstreamRecord(const BitstreamRecord&) = delete;
+  BitstreamRecord& operator=(const BitstreamRecord&) = delete;
+  ~BitstreamRecord();
+
+  // Returns the hash of the bitstream on the device, if known.
+  std::optional<uint64_t> Get() const;
+
+  // Sets the hash of the bitstream on the device.
+  void Set(uint64_t hash);
+
+  // Forgets the bitstream on the device, e.g., before reconfiguring it.
+  void Clear();
+
+ private:
+  int fd_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_BITSTREAM_RECORD_H_
@@ -3,6 +3,10 @@
 
 #include <cstddef>
 
+#include <utility>
+#include <vector>
+
+#include "frt/compression.h"
 #include "frt/tag.h"
 
 namespace fpga {
@@ -20,6 +24,47 @@ class Buffer {
   const size_t n_;
 };
 
+// A buffer whose content is the concatenation of chunks of host memory. It is
+// gathered into one device buffer and scattered back without a host copy.
+template <typename T, Tag tag>
+class ChunkedBuffer {
+ public:
+  explicit ChunkedBuffer(const std::vector<std::pair<T*, size_t>>& chunks) {
+    chunks_.reserve(chunks.size());
+    for (const auto& chunk : chunks) {
+      chunks_.emplace_back(chunk.first, chunk.second);
+    }
+  }
+  const std::vector<Buffer<T, tag>>& GetChunks() const { return chunks_; }
+  size_t SizeInBytes() const {
+    size_t size = 0;
+    for (const auto& chunk : chunks_) {
+      size += chunk.SizeInBytes();
+    }
+    return size;
+  }
+
+ private:
+  std::vector<Buffer<T, tag>> chunks_;
+};
+
+// A buffer that is transferred in the block format of `BlockCompressor`, for
+// kernels with a decompressor or a compressor in front of their memory. Its
+// host memory holds the uncompressed content.
+template <typename T, Tag tag>
+class CompressedBuffer {
+ public:
+  CompressedBuffer(Buffer<T, tag> buffer, const CompressionOptions& options)
+      : buffer_(buffer), options_(options) {}
+  Buffer<T, tag> GetBuffer() const { return buffer_; }
+  const CompressionOptions& GetOptions() const { return options_; }
+  size_t SizeInBytes() const { return buffer_.SizeInBytes(); }
+
+ private:
+  Buffer<T, tag> buffer_;
+  CompressionOptions options_;
+};
+
 }  // namespace internal
 }  // namespace fpga
 
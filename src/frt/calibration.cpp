@@ -0,0 +1,114 @@
+#include "frt/calibration.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "frt/environ.h"
+
+namespace fpga {
+
+namespace {
+
+std::string GetCalibrationPath(const std::string& platform,
+                               const std::string& device) {
+  std::string path = internal::GetRuntimeDir() + "/calibration.";
+  for (char c : platform + "." + device) {
+    path += isalnum(c) ? c : '_';
+  }
+  return path;
+}
+
+int64_t PredictTime(int64_t latency_ns, double bytes_per_ns, size_t bytes) {
+  return latency_ns +
+         (bytes_per_ns > 0 ? std::llround(bytes / bytes_per_ns) : 0);
+}
+
+}  // namespace
+
+int64_t CalibrationProfile::LoadTimeNanoSeconds(size_t bytes) const {
+  return PredictTime(load_latency_ns, load_bytes_per_ns, bytes);
+}
+
+int64_t CalibrationProfile::StoreTimeNanoSeconds(size_t bytes) const {
+  return PredictTime(store_latency_ns, store_bytes_per_ns, bytes);
+}
+
+std::ostream& operator<<(std::ostream& os, const CalibrationProfile& profile) {
+  os << "CalibrationProfile: {platform: " << profile.platform
+     << ", device: " << profile.device
+     << ", load: " << profile.load_latency_ns << " ns + "
+     << profile.load_bytes_per_ns << " B/ns, store: "
+     << profile.store_latency_ns << " ns + " << profile.store_bytes_per_ns
+     << " B/ns, launch: " << profile.launch_latency_ns << " ns";
+  os << "}";
+  return os;
+}
+
+std::optional<CalibrationProfile> LoadCalibration(const std::string& platform,
+                                                  const std::string& device) {
+  std::ifstream file(GetCalibrationPath(platform, device));
+  CalibrationProfile profile;
+  profile.platform = platform;
+  profile.device = device;
+  if (!(file >> profile.load_latency_ns >> profile.load_bytes_per_ns >>
+        profile.store_latency_ns >> profile.store_bytes_per_ns >>
+        profile.launch_latency_ns)) {
+    return std::nullopt;
+  }
+  return profile;
+}
+
+namespace internal {
+
+void SaveCalibration(const CalibrationProfile& profile) {
+  // Readers never see a partially written profile.
+  const std::string path = GetCalibrationPath(profile.platform, profile.device);
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    file.precision(17);
+    file << profile.load_latency_ns << " " << profile.load_bytes_per_ns << "\n"
+         << profile.store_latency_ns << " " << profile.store_bytes_per_ns
+         << "\n"
+         << profile.launch_latency_ns << "\n";
+    if (!file.flush()) {
+      LOG(WARNING) << "cannot write calibration profile '" << tmp_path << "'";
+      return;
+    }
+  }
+  PLOG_IF(WARNING, rename(tmp_path.c_str(), path.c_str()))
+      << "cannot save calibration profile '" << path << "'";
+}
+
+std::pair<double, double> FitLine(
+    const std::vector<std::pair<double, double>>& points) {
+  double mean_x = 0;
+  double mean_y = 0;
+  for (const auto& [x, y] : points) {
+    mean_x += x;
+    mean_y += y;
+  }
+  mean_x /= points.size();
+  mean_y /= points.size();
+  double covariance = 0;
+  double variance = 0;
+  for (const auto& [x, y] : points) {
+    covariance += (x - mean_x) * (y - mean_y);
+    variance += (x - mean_x) * (x - mean_x);
+  }
+  const double slope = variance > 0 ? covariance / variance : 0;
+  return {mean_y - slope * mean_x, slope};
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,68 @@
+#ifndef FPGA_RUNTIME_CALIBRATION_H_
+#define FPGA_RUNTIME_CALIBRATION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fpga {
+
+// Performance model of a device, fitted from probes by
+// `Instance::Calibrate`.
+struct CalibrationProfile {
+  // Identify the device the profile applies to.
+  std::string platform;
+  std::string device;
+  // Setup cost and bandwidth of host-to-device transfers.
+  int64_t load_latency_ns = 0;
+  double load_bytes_per_ns = 0;
+  // Setup cost and bandwidth of device-to-host transfers.
+  int64_t store_latency_ns = 0;
+  double store_bytes_per_ns = 0;
+  // Cost of launching kernels that do no work. Zero unless launches are
+  // probed.
+  int64_t launch_latency_ns = 0;
+
+  // Return the predicted time of transferring `bytes`.
+  int64_t LoadTimeNanoSeconds(size_t bytes) const;
+  int64_t StoreTimeNanoSeconds(size_t bytes) const;
+};
+
+std::ostream& operator<<(std::ostream& os, const CalibrationProfile& profile);
+
+struct CalibrationOptions {
+  // Sizes of the probe transfers in each direction.
+  std::vector<size_t> transfer_sizes = {size_t{4} << 10, size_t{64} << 10,
+                                        size_t{1} << 20, size_t{16} << 20};
+  // Each probe is repeated and the fastest run is used, which filters out
+  // interference from the host.
+  int repetitions = 3;
+  // Whether to probe kernel launches, which requires that the kernel
+  // arguments are set so that the kernels do (nearly) nothing. Off by
+  // default, since the kernels run with whatever arguments are set.
+  bool probe_launch = false;
+};
+
+// Returns the profile saved for `device` of `platform`, if any. Profiles are
+// saved in the FRT runtime directory by `Instance::Calibrate`.
+std::optional<CalibrationProfile> LoadCalibration(const std::string& platform,
+                                                  const std::string& device);
+
+namespace internal {
+
+void SaveCalibration(const CalibrationProfile& profile);
+
+// Returns the intercept and slope of the least-squares line through
+// (x, y) `points`.
+std::pair<double, double> FitLine(
+    const std::vector<std::pair<double, double>>& points);
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_CALIBRATION_H_
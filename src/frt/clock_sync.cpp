@@ -0,0 +1,83 @@
+#include "frt/clock_sync.h"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include <CL/cl.h>
+#include <CL/cl2.hpp>
+
+#include "frt/opencl_util.h"
+
+namespace fpga {
+namespace internal {
+
+namespace {
+
+constexpr int kSampleCount = 5;
+constexpr int64_t kRefreshPeriodNs = 10'000'000'000;
+// The rate is only fitted over spans this long, so that the uncertainty of
+// the samples does not dominate.
+constexpr int64_t kMinRateSpanNs = 1'000'000'000;
+
+int64_t HostNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+void ClockSync::Refresh(const cl::Context& context,
+                        const cl::CommandQueue& cmd) {
+  if (is_synced_ && HostNow() - last_.host_ns < kRefreshPeriodNs) {
+    return;
+  }
+  last_ = Measure(context, cmd);
+  if (!is_synced_) {
+    first_ = last_;
+    is_synced_ = true;
+  } else if (last_.host_ns - first_.host_ns >= kMinRateSpanNs) {
+    rate_ = static_cast<double>(last_.device_ns - first_.device_ns) /
+            (last_.host_ns - first_.host_ns);
+  }
+}
+
+int64_t ClockSync::ToHostTime(int64_t device_time_ns) const {
+  return last_.host_ns + ToHostDuration(device_time_ns - last_.device_ns);
+}
+
+int64_t ClockSync::ToHostDuration(int64_t device_duration_ns) const {
+  return std::llround(device_duration_ns / rate_);
+}
+
+ClockSync::Sample ClockSync::Measure(const cl::Context& context,
+                                     const cl::CommandQueue& cmd) {
+  Sample best = {};
+  int64_t best_uncertainty = -1;
+  for (int i = 0; i < kSampleCount; ++i) {
+    cl_int err;
+    cl::UserEvent release(context, &err);
+    CL_CHECK(err);
+    const std::vector<cl::Event> events = {release};
+    cl::Event marker;
+    CL_CHECK(cmd.enqueueMarkerWithWaitList(&events, &marker));
+    CL_CHECK(cmd.flush());
+    // The marker starts right after it is released.
+    const int64_t before = HostNow();
+    CL_CHECK(release.setStatus(CL_COMPLETE));
+    const int64_t after = HostNow();
+    CL_CHECK(marker.wait());
+    const int64_t device_ns =
+        marker.getProfilingInfo<CL_PROFILING_COMMAND_START>(&err);
+    CL_CHECK(err);
+    if (best_uncertainty < 0 || after - before < best_uncertainty) {
+      best = {before + (after - before) / 2, device_ns};
+      best_uncertainty = after - before;
+    }
+  }
+  return best;
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,47 @@
+#ifndef FPGA_RUNTIME_CLOCK_SYNC_H_
+#define FPGA_RUNTIME_CLOCK_SYNC_H_
+
+#include <cstdint>
+
+#include <CL/cl.h>
+#include <CL/cl2.hpp>
+
+namespace fpga {
+namespace internal {
+
+// Maps timestamps of the OpenCL profiling clock of a device, which has an
+// unspecified time base, to the host's `std::chrono::steady_clock`.
+//
+// Each synchronization releases marker commands from the host and pairs their
+// device timestamps with the host time of the release; the sample with the
+// least host-side uncertainty gives the offset. The rate of the device clock
+// is fitted between the first and the latest synchronization.
+class ClockSync {
+ public:
+  // Synchronizes with the device of `cmd` if never synchronized or if the last
+  // synchronization is older than the refresh period.
+  void Refresh(const cl::Context& context, const cl::CommandQueue& cmd);
+
+  int64_t ToHostTime(int64_t device_time_ns) const;
+  int64_t ToHostDuration(int64_t device_duration_ns) const;
+
+ private:
+  struct Sample {
+    int64_t host_ns;
+    int64_t device_ns;
+  };
+
+  static Sample Measure(const cl::Context& context,
+                        const cl::CommandQueue& cmd);
+
+  bool is_synced_ = false;
+  Sample first_ = {};
+  Sample last_ = {};
+  // Device nanoseconds per host nanosecond.
+  double rate_ = 1.;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_CLOCK_SYNC_H_
@@ -0,0 +1,325 @@
+#include "frt/compression.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lz4.h>
+
+namespace fpga {
+
+std::ostream& operator<<(std::ostream& os, const CompressionStats& stats) {
+  os << "CompressionStats: {load: " << stats.load_raw_bytes << " -> "
+     << stats.load_compressed_bytes << " bytes, store: "
+     << stats.store_compressed_bytes << " -> " << stats.store_raw_bytes
+     << " bytes, compress: " << stats.compress_time_ns
+     << " ns, decompress: " << stats.decompress_time_ns << " ns";
+  os << "}";
+  return os;
+}
+
+namespace internal {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x5a545246;  // "FRTZ" in little-endian.
+constexpr uint32_t kVersion = 1;
+constexpr int kMaxThreadCount = 8;
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t raw_bytes;
+  uint32_t block_bytes;
+  uint32_t block_count;
+};
+static_assert(sizeof(Header) == 24, "unexpected padding in the header");
+static_assert(sizeof(BlockCompressor::Block) == 16,
+              "unexpected padding in the index table");
+
+size_t RoundUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// Runs the blocks of compressions and decompressions of all buffers in the
+// process. Like `PagePreparer`, it is never destroyed and its threads are
+// detached.
+class WorkerPool {
+ public:
+  static WorkerPool& Get() {
+    static auto* pool = new WorkerPool(std::max(
+        1, std::min<int>(std::thread::hardware_concurrency(),
+                         kMaxThreadCount)));
+    return *pool;
+  }
+
+  // Runs `task(i)` for each `i` in [0, `count`) on the worker threads, and
+  // calls `on_done(i)` on the calling thread as each one finishes. Returns
+  // after all tasks have finished. Rethrows the first exception thrown by
+  // `task` or `on_done`.
+  void Run(size_t count, const std::function<void(size_t)>& task,
+           const std::function<void(size_t)>& on_done) {
+    if (count == 0) {
+      return;
+    }
+    Job job;
+    job.task = &task;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      for (size_t i = 0; i < count; ++i) {
+        items_.push_back({&job, i});
+      }
+    }
+    item_cv_.notify_all();
+
+    std::exception_ptr error;
+    std::unique_lock<std::mutex> lock(job.mtx);
+    for (size_t done_count = 0; done_count < count; ++done_count) {
+      job.cv.wait(lock, [&job] { return !job.done.empty(); });
+      const size_t i = job.done.front();
+      job.done.pop_front();
+      if (job.error != nullptr || error != nullptr || on_done == nullptr) {
+        continue;
+      }
+      lock.unlock();
+      try {
+        on_done(i);
+      } catch (...) {
+        // Remaining tasks still refer to `job` and must finish first.
+        error = std::current_exception();
+      }
+      lock.lock();
+    }
+    if (error == nullptr) {
+      error = job.error;
+    }
+    if (error != nullptr) {
+      std::rethrow_exception(error);
+    }
+  }
+
+ private:
+  struct Job {
+    const std::function<void(size_t)>* task;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<size_t> done;
+    std::exception_ptr error;
+  };
+  struct Item {
+    Job* job;
+    size_t index;
+  };
+
+  explicit WorkerPool(int thread_count) {
+    for (int i = 0; i < thread_count; ++i) {
+      std::thread(&WorkerPool::Work, this).detach();
+    }
+  }
+
+  void Work() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (;;) {
+      item_cv_.wait(lock, [this] { return !items_.empty(); });
+      const Item item = items_.front();
+      items_.pop_front();
+      lock.unlock();
+      std::exception_ptr error;
+      try {
+        (*item.job->task)(item.index);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> job_lock(item.job->mtx);
+        if (error != nullptr && item.job->error == nullptr) {
+          item.job->error = error;
+        }
+        item.job->done.push_back(item.index);
+        // Notified while holding the lock; the job is destroyed once the
+        // calling thread sees the last task done.
+        item.job->cv.notify_one();
+      }
+      lock.lock();
+    }
+  }
+
+  std::mutex mtx_;
+  std::condition_variable item_cv_;
+  std::deque<Item> items_;
+};
+
+}  // namespace
+
+BlockCompressor::BlockCompressor(size_t raw_bytes,
+                                 const CompressionOptions& options)
+    : raw_bytes_(raw_bytes), options_(options), staging_(nullptr, free) {
+  if (options.block_bytes == 0 || options.block_bytes > LZ4_MAX_INPUT_SIZE) {
+    throw std::invalid_argument("block size must be in (0, " +
+                                std::to_string(LZ4_MAX_INPUT_SIZE) + "]");
+  }
+  if (options.alignment == 0 ||
+      (options.alignment & (options.alignment - 1)) != 0) {
+    throw std::invalid_argument("block alignment must be a power of two");
+  }
+  block_count_ = (raw_bytes + options.block_bytes - 1) / options.block_bytes;
+  if (block_count_ > UINT32_MAX) {
+    throw std::invalid_argument("too many blocks in a compressed buffer");
+  }
+  slot_bytes_ = RoundUp(LZ4_COMPRESSBOUND(options.block_bytes),
+                        options.alignment);
+  capacity_ = GetSlot(block_count_);
+}
+
+bool BlockCompressor::IsCompatible(size_t raw_bytes,
+                                   const CompressionOptions& options) const {
+  return raw_bytes == raw_bytes_ &&
+         options.block_bytes == options_.block_bytes &&
+         options.alignment == options_.alignment &&
+         options.acceleration == options_.acceleration;
+}
+
+size_t BlockCompressor::GetIndexBytes() const {
+  return sizeof(Header) + block_count_ * sizeof(Block);
+}
+
+char* BlockCompressor::GetStaging() {
+  if (staging_ == nullptr) {
+    staging_.reset(static_cast<char*>(aligned_alloc(
+        std::max(options_.alignment, sizeof(void*)), capacity_)));
+    if (staging_ == nullptr) {
+      throw std::bad_alloc();
+    }
+  }
+  return staging_.get();
+}
+
+size_t BlockCompressor::Compress(const void* src, void* dst,
+                                 const ReadyCallback& on_ready) const {
+  auto raw = static_cast<const char*>(src);
+  auto compressed = static_cast<char*>(dst);
+  std::vector<Block> index(block_count_);
+  WorkerPool::Get().Run(
+      block_count_,
+      [&](size_t i) {
+        const size_t begin = i * options_.block_bytes;
+        const int raw_size =
+            std::min(options_.block_bytes, raw_bytes_ - begin);
+        auto& block = index[i];
+        block.offset = GetSlot(i);
+        block.raw_bytes = raw_size;
+        int size = LZ4_compress_fast(raw + begin, compressed + block.offset,
+                                     raw_size, slot_bytes_,
+                                     options_.acceleration);
+        // Incompressible blocks are stored as is, so that the device never
+        // reads more than the raw bytes.
+        if (size <= 0 || size >= raw_size) {
+          memcpy(compressed + block.offset, raw + begin, raw_size);
+          size = raw_size;
+        }
+        block.compressed_bytes = size;
+      },
+      [&](size_t i) {
+        if (on_ready != nullptr) {
+          on_ready(index[i].offset, index[i].compressed_bytes);
+        }
+      });
+
+  const Header header = {kMagic, kVersion, raw_bytes_,
+                         static_cast<uint32_t>(options_.block_bytes),
+                         static_cast<uint32_t>(block_count_)};
+  memcpy(compressed, &header, sizeof(header));
+  memcpy(compressed + sizeof(header), index.data(),
+         index.size() * sizeof(Block));
+  if (on_ready != nullptr) {
+    on_ready(0, GetIndexBytes());
+  }
+  size_t size = GetIndexBytes();
+  for (const auto& block : index) {
+    size += block.compressed_bytes;
+  }
+  return size;
+}
+
+std::vector<BlockCompressor::Block> BlockCompressor::ReadIndex(
+    const void* src) const {
+  auto compressed = static_cast<const char*>(src);
+  Header header;
+  memcpy(&header, compressed, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion) {
+    throw std::runtime_error("not a compressed buffer of version " +
+                             std::to_string(kVersion));
+  }
+  if (header.raw_bytes != raw_bytes_ ||
+      header.block_bytes != options_.block_bytes ||
+      header.block_count != block_count_) {
+    throw std::runtime_error(
+        "compressed buffer has a different size or block size");
+  }
+  std::vector<Block> index(block_count_);
+  memcpy(index.data(), compressed + sizeof(header),
+         index.size() * sizeof(Block));
+  for (size_t i = 0; i < index.size(); ++i) {
+    const auto& block = index[i];
+    const size_t raw_size =
+        std::min(options_.block_bytes, raw_bytes_ - i * options_.block_bytes);
+    if (block.raw_bytes != raw_size || block.compressed_bytes == 0 ||
+        block.compressed_bytes > slot_bytes_ ||
+        block.offset < GetIndexBytes() || block.offset > capacity_ ||
+        block.compressed_bytes > capacity_ - block.offset) {
+      throw std::runtime_error("invalid entry in the index of block " +
+                               std::to_string(i));
+    }
+  }
+  return index;
+}
+
+size_t BlockCompressor::Decompress(const void* src, void* dst,
+                                   const WaitCallback& wait) const {
+  auto compressed = static_cast<const char*>(src);
+  auto raw = static_cast<char*>(dst);
+  const auto index = ReadIndex(src);
+  WorkerPool::Get().Run(
+      block_count_,
+      [&](size_t i) {
+        if (wait != nullptr) {
+          wait(i);
+        }
+        const auto& block = index[i];
+        char* block_raw = raw + i * options_.block_bytes;
+        if (block.compressed_bytes == block.raw_bytes) {
+          memcpy(block_raw, compressed + block.offset, block.raw_bytes);
+          return;
+        }
+        if (LZ4_decompress_safe(compressed + block.offset, block_raw,
+                                block.compressed_bytes, block.raw_bytes) !=
+            static_cast<int>(block.raw_bytes)) {
+          throw std::runtime_error("corrupted compressed block " +
+                                   std::to_string(i));
+        }
+      },
+      nullptr);
+  size_t size = GetIndexBytes();
+  for (const auto& block : index) {
+    size += block.compressed_bytes;
+  }
+  return size;
+}
+
+size_t BlockCompressor::GetSlot(size_t i) const {
+  return RoundUp(GetIndexBytes(), options_.alignment) + i * slot_bytes_;
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,117 @@
+#ifndef FPGA_RUNTIME_COMPRESSION_H_
+#define FPGA_RUNTIME_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace fpga {
+
+struct CompressionOptions {
+  // Buffers are split into blocks of this many uncompressed bytes, which are
+  // compressed and decompressed independently.
+  size_t block_bytes = size_t{1} << 20;
+  // Compressed blocks start at multiples of this many bytes, both in the
+  // host staging buffer and in the device buffer. Must be a power of two.
+  size_t alignment = 4096;
+  // LZ4 acceleration; larger values compress faster and less.
+  int acceleration = 1;
+};
+
+struct CompressionStats {
+  // Uncompressed and compressed bytes of the buffers compressed on the host,
+  // including the header and the index table of the latter.
+  int64_t load_raw_bytes = 0;
+  int64_t load_compressed_bytes = 0;
+  // Uncompressed and compressed bytes of the buffers decompressed on the host.
+  int64_t store_raw_bytes = 0;
+  int64_t store_compressed_bytes = 0;
+  // Time spent compressing and decompressing on the host, overlapped with
+  // transfers.
+  int64_t compress_time_ns = 0;
+  int64_t decompress_time_ns = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const CompressionStats& stats);
+
+namespace internal {
+
+// Converts buffers between their content and the block format of compressed
+// buffer arguments, which is what decompressors and compressors on the device
+// read and write. All integers are little-endian.
+//
+//   Header      magic "FRTZ", version (u32 each), raw bytes (u64),
+//               block bytes, block count (u32 each)
+//   Index table per block: offset from the beginning of the buffer (u64),
+//               compressed bytes, raw bytes (u32 each)
+//   Blocks      LZ4 blocks at aligned offsets after the index table; a block
+//               whose compressed bytes equal its raw bytes is stored as is
+//
+// Block `i` is stored in a slot at a fixed offset that fits its worst-case
+// size, so blocks can be transferred as soon as each one is compressed.
+// Blocks are compressed and decompressed on helper threads.
+class BlockCompressor {
+ public:
+  struct Block {
+    uint64_t offset;
+    uint32_t compressed_bytes;
+    uint32_t raw_bytes;
+  };
+
+  // Called for each range of a buffer in the block format that is ready.
+  using ReadyCallback = std::function<void(size_t offset, size_t size)>;
+  // Called before block `i` of a buffer in the block format is read.
+  using WaitCallback = std::function<void(size_t i)>;
+
+  BlockCompressor(size_t raw_bytes, const CompressionOptions& options);
+
+  // Returns whether this compressor converts buffers of `raw_bytes` with
+  // `options`.
+  bool IsCompatible(size_t raw_bytes, const CompressionOptions& options) const;
+
+  // Returns the size of a buffer in the block format that holds any content.
+  size_t GetCapacity() const { return capacity_; }
+  // Returns the size of the header and the index table.
+  size_t GetIndexBytes() const;
+  size_t GetBlockCount() const { return block_count_; }
+
+  // Returns a host buffer of `GetCapacity()` bytes aligned to the alignment
+  // of blocks, allocated on first use.
+  char* GetStaging();
+
+  // Compresses `raw_bytes` of `src` into `dst` in the block format and
+  // returns the number of bytes used. `on_ready` is called on the calling
+  // thread for each block as soon as it is compressed, and for the header and
+  // the index table after all blocks.
+  size_t Compress(const void* src, void* dst,
+                  const ReadyCallback& on_ready = nullptr) const;
+
+  // Returns the index table of `src` after validating its header. Throws
+  // `std::runtime_error` if `src` is not a buffer of this compressor.
+  std::vector<Block> ReadIndex(const void* src) const;
+
+  // Decompresses `src` in the block format into `raw_bytes` of `dst` and
+  // returns the number of compressed bytes. `wait` is called on a helper
+  // thread before each block is read, e.g., to wait for its transfer.
+  size_t Decompress(const void* src, void* dst,
+                    const WaitCallback& wait = nullptr) const;
+
+ private:
+  size_t GetSlot(size_t i) const;
+
+  const size_t raw_bytes_;
+  const CompressionOptions options_;
+  size_t block_count_;
+  size_t slot_bytes_;
+  size_t capacity_;
+  std::unique_ptr<char, void (*)(void*)> staging_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_COMPRESSION_H_
@@ -0,0 +1,144 @@
+#include "frt/dependency_tracker.h"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <CL/cl.h>
+#include <CL/cl2.hpp>
+
+#include "frt/opencl_util.h"
+
+namespace fpga {
+namespace internal {
+
+namespace {
+
+bool IsComplete(const cl::Event& event) {
+  cl_int err;
+  cl_int status = event.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>(&err);
+  CL_CHECK(err);
+  return status <= CL_COMPLETE;
+}
+
+void CL_CALLBACK CompleteUserEvent(cl_event, cl_int status, void* data) {
+  auto user_event = static_cast<cl_event>(data);
+  clSetUserEventStatus(user_event, status < 0 ? status : CL_COMPLETE);
+  clReleaseEvent(user_event);
+}
+
+// Returns an event in `context` that completes with `event`, which belongs to
+// another context and cannot be waited for directly.
+cl::Event Bridge(const cl::Context& context, const cl::Event& event) {
+  cl_int err;
+  cl_event user_event = clCreateUserEvent(context(), &err);
+  CL_CHECK(err);
+  // The returned object and the callback each hold a reference.
+  cl::Event result(user_event, /* retain = */ false);
+  CL_CHECK(clRetainEvent(user_event));
+  CL_CHECK(clSetEventCallback(event(), CL_COMPLETE, CompleteUserEvent,
+                              user_event));
+  return result;
+}
+
+}  // namespace
+
+DependencyTracker& DependencyTracker::GetHostTracker() {
+  // Never destroyed; events must not outlive the OpenCL runtime.
+  static auto* tracker = new DependencyTracker;
+  return *tracker;
+}
+
+void DependencyTracker::GetDependencies(const cl::Context& context,
+                                        const void* ptr, size_t size,
+                                        bool is_write,
+                                        std::vector<cl::Event>& events) {
+  const auto begin = reinterpret_cast<uintptr_t>(ptr);
+  const auto end = begin + size;
+  std::lock_guard<std::mutex> lock(mtx_);
+  accesses_.erase(std::remove_if(accesses_.begin(), accesses_.end(),
+                                 [](const Access& access) {
+                                   return IsComplete(access.event);
+                                 }),
+                  accesses_.end());
+  for (auto& access : accesses_) {
+    if (!(access.begin < end && begin < access.end &&
+          (is_write || access.is_write))) {
+      continue;
+    }
+    if (access.context == context()) {
+      events.push_back(access.event);
+      continue;
+    }
+    // Bridges are reused, so that commands in the same context share one
+    // user event and callback per command, and writes that waited for it are
+    // recognized in `AddAccess`.
+    auto bridge = std::find_if(access.bridges.begin(), access.bridges.end(),
+                               [&context](const auto& bridge) {
+                                 return bridge.first == context();
+                               });
+    if (bridge == access.bridges.end()) {
+      access.bridges.emplace_back(context(), Bridge(context, access.event));
+      bridge = std::prev(access.bridges.end());
+    }
+    events.push_back(bridge->second);
+  }
+}
+
+void DependencyTracker::AddAccess(const cl::Context& context, const void* ptr,
+                                  size_t size, bool is_write,
+                                  const cl::Event& event,
+                                  const std::vector<cl::Event>& waited) {
+  const auto begin = reinterpret_cast<uintptr_t>(ptr);
+  const auto end = begin + size;
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (is_write) {
+    // Accesses within the range of a write that it waited for are covered by
+    // waiting for the write. Dropping them keeps the dependencies of commands
+    // that are not submitted yet from piling up. Accesses that it did not
+    // wait for, e.g., those of commands enqueued concurrently, are kept.
+    auto is_waited = [&waited](const Access& access) {
+      return std::any_of(
+          waited.begin(), waited.end(),
+          [&access](const cl::Event& event) { return access.Is(event); });
+    };
+    accesses_.erase(std::remove_if(accesses_.begin(), accesses_.end(),
+                                   [&](const Access& access) {
+                                     return begin <= access.begin &&
+                                            access.end <= end &&
+                                            is_waited(access);
+                                   }),
+                    accesses_.end());
+  }
+  accesses_.push_back({begin, end, is_write, context(), event});
+}
+
+void DependencyTracker::RemoveContext(const cl::Context& context) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  accesses_.erase(std::remove_if(accesses_.begin(), accesses_.end(),
+                                 [&context](const Access& access) {
+                                   return access.context == context();
+                                 }),
+                  accesses_.end());
+  for (auto& access : accesses_) {
+    access.bridges.erase(
+        std::remove_if(access.bridges.begin(), access.bridges.end(),
+                       [&context](const auto& bridge) {
+                         return bridge.first == context();
+                       }),
+        access.bridges.end());
+  }
+}
+
+bool DependencyTracker::Access::Is(const cl::Event& other) const {
+  return other() == event() ||
+         std::any_of(bridges.begin(), bridges.end(),
+                     [&other](const auto& bridge) {
+                       return bridge.second() == other();
+                     });
+}
+
+}  // namespace internal
+}  // namespace fpga
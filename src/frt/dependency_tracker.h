@@ -0,0 +1,65 @@
+#ifndef FPGA_RUNTIME_DEPENDENCY_TRACKER_H_
+#define FPGA_RUNTIME_DEPENDENCY_TRACKER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <CL/cl.h>
+#include <CL/cl2.hpp>
+
+namespace fpga {
+namespace internal {
+
+// Tracks the memory ranges accessed by in-flight OpenCL commands, so that
+// commands accessing the same memory can be ordered by events instead of
+// host synchronization. Reads are ordered after earlier writes; writes are
+// ordered after all earlier accesses.
+class DependencyTracker {
+ public:
+  // Returns the tracker of host memory, shared by all devices in the process.
+  static DependencyTracker& GetHostTracker();
+
+  // Appends to `events` the in-flight commands that an access to
+  // [`ptr`, `ptr` + `size`) must wait for. Commands in other contexts are
+  // represented by user events in `context`, one per command and context.
+  void GetDependencies(const cl::Context& context, const void* ptr,
+                       size_t size, bool is_write,
+                       std::vector<cl::Event>& events);
+
+  // Records that the command of `event` in `context` accesses
+  // [`ptr`, `ptr` + `size`) after waiting for `waited`, which includes the
+  // dependencies returned by `GetDependencies` for the access.
+  void AddAccess(const cl::Context& context, const void* ptr, size_t size,
+                 bool is_write, const cl::Event& event,
+                 const std::vector<cl::Event>& waited);
+
+  // Forgets the commands in `context` and the user events created in it,
+  // e.g., before the context is released.
+  void RemoveContext(const cl::Context& context);
+
+ private:
+  struct Access {
+    uintptr_t begin;
+    uintptr_t end;
+    bool is_write;
+    cl_context context;
+    cl::Event event;
+    // User events that complete with `event`, in other contexts.
+    std::vector<std::pair<cl_context, cl::Event>> bridges;
+
+    // Returns whether `other` is `event` or one of `bridges`.
+    bool Is(const cl::Event& other) const;
+  };
+
+  std::mutex mtx_;
+  std::vector<Access> accesses_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_DEPENDENCY_TRACKER_H_
@@ -4,12 +4,17 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <string>
 #include <vector>
 
 #include "frt/arg_info.h"
+#include "frt/bandwidth_limit.h"
 #include "frt/buffer_arg.h"
+#include "frt/compression.h"
+#include "frt/startup_profile.h"
 #include "frt/stream_wrapper.h"
 #include "frt/tag.h"
+#include "frt/timeline.h"
 
 namespace fpga {
 namespace internal {
@@ -20,20 +25,53 @@ class Device {
 
   virtual void SetScalarArg(int index, const void* arg, int size) = 0;
   virtual void SetBufferArg(int index, Tag tag, const BufferArg& arg) = 0;
+  // Sets a buffer argument whose content is the concatenation of `chunks`.
+  virtual void SetChunkedBufferArg(int index, Tag tag,
+                                   const std::vector<BufferArg>& chunks) = 0;
+  // Sets a buffer argument that is transferred in the block format, i.e.,
+  // compressed on the host before loads and decompressed after stores.
+  virtual void SetCompressedBufferArg(int index, Tag tag, const BufferArg& arg,
+                                      const CompressionOptions& options) = 0;
   virtual void SetStreamArg(int index, Tag tag, StreamWrapper& arg) = 0;
   virtual size_t SuspendBuffer(int index) = 0;
+  virtual void SetBufferBank(int index, int bank) = 0;
+  virtual void SetBandwidthLimit(const BandwidthLimit& limit) = 0;
+  // Defers submitting commands until `Flush` or until `max_operations`
+  // operations have accumulated; zero submits commands immediately.
+  virtual void SetDeferredSubmission(size_t max_operations) = 0;
 
   virtual void WriteToDevice() = 0;
   virtual void ReadFromDevice() = 0;
   virtual void Exec() = 0;
+  virtual void Flush() = 0;
   virtual void Finish() = 0;
 
+  virtual void BeginCapture() = 0;
+  virtual void EndCapture() = 0;
+  virtual void Replay() = 0;
+
   virtual std::vector<ArgInfo> GetArgsInfo() const = 0;
+  virtual StartupProfile GetStartupProfile() const = 0;
+  virtual ThrottleStats GetThrottleStats() const = 0;
+  virtual CompressionStats GetCompressionStats() const = 0;
+  virtual Timeline GetTimeline() const = 0;
+  virtual int64_t QueueTimeNanoSeconds() const = 0;
   virtual int64_t LoadTimeNanoSeconds() const = 0;
   virtual int64_t ComputeTimeNanoSeconds() const = 0;
   virtual int64_t StoreTimeNanoSeconds() const = 0;
   virtual size_t LoadBytes() const = 0;
   virtual size_t StoreBytes() const = 0;
+
+  virtual std::string GetPlatformName() const = 0;
+  virtual std::string GetDeviceName() const = 0;
+  // Returns the time of transferring `size` bytes between the host and a
+  // scratch buffer on the device.
+  virtual int64_t ProbeTransferNanoSeconds(size_t size, bool is_store) = 0;
+  // Returns the value of the kernel register `name`. May be called from
+  // another thread while commands are in flight.
+  virtual uint32_t ReadRegister(const std::string& name) = 0;
+  // Returns the id of the instance in instrumentation events.
+  virtual uint64_t GetInstrumentationId() const = 0;
 };
 
 }  // namespace internal
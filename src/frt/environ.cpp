@@ -0,0 +1,117 @@
+#include "frt/environ.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+namespace fpga {
+namespace internal {
+
+namespace {
+
+std::mutex& GetMutex() {
+  static std::mutex mtx;
+  return mtx;
+}
+
+// Variables exported by FRT and their values.
+Environ& GetExported() {
+  static Environ exported;
+  return exported;
+}
+
+}  // namespace
+
+std::optional<std::string> GetEnv(const std::string& name) {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  if (const char* value = getenv(name.c_str())) {
+    return value;
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> GetUserEnv(const std::string& name) {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  const char* value = getenv(name.c_str());
+  if (value == nullptr) {
+    return std::nullopt;
+  }
+  // A value that differs from the one FRT exported has been set by the user
+  // since.
+  const auto& exported = GetExported();
+  if (auto it = exported.find(name);
+      it != exported.end() && it->second == value) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+void ExportEnviron(Environ& environ, bool overwrite) {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  auto& exported = GetExported();
+  // Conflicts are checked before anything is set, so that a failed export
+  // leaves the environment as it was.
+  if (!overwrite) {
+    for (const auto& [name, value] : environ) {
+      if (auto it = exported.find(name);
+          it != exported.end() && it->second != value) {
+        throw std::runtime_error("environment variable '" + name +
+                                 "' is already '" + it->second +
+                                 "' in this process; cannot set it to '" +
+                                 value + "'");
+      }
+    }
+  }
+  for (auto& [name, value] : environ) {
+    const char* current = getenv(name.c_str());
+    if (!overwrite && current != nullptr) {
+      value = current;
+      continue;
+    }
+    // Vendor runtime threads may be calling `getenv` without our lock, which
+    // `setenv` races with, so variables that already have the value are not
+    // set again. Only variables that FRT sets count as exported.
+    if (current == nullptr || value != current) {
+      setenv(name.c_str(), value.c_str(), /* __replace = */ 1);
+      exported[name] = value;
+    }
+  }
+}
+
+void ExportDefaults(Environ& environ) {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  auto& exported = GetExported();
+  for (auto& [name, value] : environ) {
+    if (const char* current = getenv(name.c_str())) {
+      value = current;
+    } else {
+      setenv(name.c_str(), value.c_str(), /* __replace = */ 1);
+      exported[name] = value;
+    }
+  }
+}
+
+std::string GetRuntimeDir() {
+  std::string dir = GetEnv("TMPDIR").value_or("/tmp");
+  dir += "/.frt." + std::to_string(geteuid());
+  if (mkdir(dir.c_str(), S_IRUSR | S_IWUSR | S_IXUSR) && errno != EEXIST) {
+    LOG(FATAL) << "cannot create FRT tmpdir '" << dir
+               << "': " << strerror(errno);
+  }
+  return dir;
+}
+
+}  // namespace internal
+}  // namespace fpga
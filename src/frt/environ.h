@@ -0,0 +1,49 @@
+#ifndef FPGA_RUNTIME_ENVIRON_H_
+#define FPGA_RUNTIME_ENVIRON_H_
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace fpga {
+namespace internal {
+
+using Environ = std::unordered_map<std::string, std::string>;
+
+// Returns the value of environment variable `name` if it is set.
+//
+// Vendor runtimes read some configuration from the process environment, so
+// FRT has to export it there. All FRT accesses to the process environment go
+// through this file and are serialized, so that devices can be constructed on
+// multiple threads concurrently.
+std::optional<std::string> GetEnv(const std::string& name);
+
+// Returns the value of environment variable `name` if it is set by the user,
+// i.e., not to the value exported by FRT.
+std::optional<std::string> GetUserEnv(const std::string& name);
+
+// Exports `environ` to the process environment, where vendor runtimes and the
+// processes they spawn can see it, and updates `environ` with the values in
+// effect.
+//
+// If `overwrite` is false, a variable that the user has set is kept. A
+// variable that FRT has already exported with a different value is a conflict
+// and throws `std::runtime_error` before anything is exported, because vendor
+// runtimes typically read such variables only once per process. Variables
+// that already have the value are not set again, since `setenv` races with
+// `getenv` on threads of vendor runtimes, and do not count as exported.
+void ExportEnviron(Environ& environ, bool overwrite);
+
+// Exports the variables of `environ` that are not set, and updates `environ`
+// with the values in effect. Unlike `ExportEnviron`, values that are already
+// set, by the user or by FRT, are kept without conflict.
+void ExportDefaults(Environ& environ);
+
+// Returns the per-user runtime directory of FRT, `$TMPDIR/.frt.<uid>`, and
+// creates it if necessary.
+std::string GetRuntimeDir();
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_ENVIRON_H_
@@ -0,0 +1,127 @@
+#ifndef FPGA_RUNTIME_HASH_H_
+#define FPGA_RUNTIME_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+
+namespace fpga {
+namespace internal {
+
+// Non-cryptographic 64-bit hash in the style of xxHash64. The input is
+// consumed in 32-byte stripes by four independent lanes, so that the compiler
+// can keep them in flight together; it runs at memory bandwidth for large
+// buffers.
+class Hasher {
+ public:
+  explicit Hasher(uint64_t seed = 0)
+      : lanes_{seed + kPrime1 + kPrime2, seed + kPrime2, seed,
+               seed - kPrime1},
+        seed_(seed) {}
+
+  Hasher& Update(const void* data, size_t size) {
+    auto ptr = static_cast<const unsigned char*>(data);
+    size_ += size;
+    if (tail_size_ > 0) {
+      const size_t n = std::min(size, sizeof(tail_) - tail_size_);
+      memcpy(tail_ + tail_size_, ptr, n);
+      tail_size_ += n;
+      ptr += n;
+      size -= n;
+      if (tail_size_ < sizeof(tail_)) {
+        return *this;
+      }
+      Stripe(tail_);
+      tail_size_ = 0;
+    }
+    for (; size >= sizeof(tail_); size -= sizeof(tail_)) {
+      Stripe(ptr);
+      ptr += sizeof(tail_);
+    }
+    memcpy(tail_, ptr, size);
+    tail_size_ = size;
+    return *this;
+  }
+
+  uint64_t Digest() const {
+    uint64_t hash;
+    if (size_ >= sizeof(tail_)) {
+      hash = Rotate(lanes_[0], 1) + Rotate(lanes_[1], 7) +
+             Rotate(lanes_[2], 12) + Rotate(lanes_[3], 18);
+      for (auto lane : lanes_) {
+        hash = (hash ^ Round(0, lane)) * kPrime1 + kPrime4;
+      }
+    } else {
+      hash = seed_ + kPrime5;
+    }
+    hash += size_;
+    size_t i = 0;
+    for (; i + 8 <= tail_size_; i += 8) {
+      hash ^= Round(0, Load64(tail_ + i));
+      hash = Rotate(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (i + 4 <= tail_size_) {
+      hash ^= Load32(tail_ + i) * kPrime1;
+      hash = Rotate(hash, 23) * kPrime2 + kPrime3;
+      i += 4;
+    }
+    for (; i < tail_size_; ++i) {
+      hash ^= tail_[i] * kPrime5;
+      hash = Rotate(hash, 11) * kPrime1;
+    }
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+  }
+
+ private:
+  static constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+  static constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+  static constexpr uint64_t kPrime3 = 0x165667b19e3779f9ULL;
+  static constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63ULL;
+  static constexpr uint64_t kPrime5 = 0x27d4eb2f165667c5ULL;
+
+  static uint64_t Rotate(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+  }
+  static uint64_t Round(uint64_t lane, uint64_t input) {
+    return Rotate(lane + input * kPrime2, 31) * kPrime1;
+  }
+  static uint64_t Load64(const unsigned char* ptr) {
+    uint64_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+  }
+  static uint64_t Load32(const unsigned char* ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+  }
+
+  void Stripe(const unsigned char* ptr) {
+    for (int i = 0; i < 4; ++i) {
+      lanes_[i] = Round(lanes_[i], Load64(ptr + i * 8));
+    }
+  }
+
+  uint64_t lanes_[4];
+  const uint64_t seed_;
+  uint64_t size_ = 0;
+  unsigned char tail_[32];
+  size_t tail_size_ = 0;
+};
+
+// Returns the hash of `size` bytes at `data`.
+inline uint64_t Hash(const void* data, size_t size, uint64_t seed = 0) {
+  return Hasher(seed).Update(data, size).Digest();
+}
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_HASH_H_
@@ -0,0 +1,231 @@
+#include "frt/instance_group.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fpga {
+
+namespace {
+
+// Weight of the latest task in the learned throughput.
+constexpr double kThroughputWeight = 0.25;
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os, const InstanceGroupStats& stats) {
+  os << "InstanceGroupStats: {";
+  for (size_t i = 0; i < stats.members.size(); ++i) {
+    const auto& member = stats.members[i];
+    os << (i == 0 ? "" : ", ") << member.bitstream << ": {tasks: "
+       << member.tasks << ", stolen: " << member.stolen_tasks
+       << ", share: " << member.share
+       << ", utilization: " << member.utilization
+       << ", throughput: " << member.throughput << "/s}";
+  }
+  os << "}";
+  return os;
+}
+
+InstanceGroup::InstanceGroup(const std::vector<std::string>& bitstreams) {
+  if (bitstreams.empty()) {
+    throw std::invalid_argument("instance group must not be empty");
+  }
+  members_.resize(bitstreams.size());
+  for (size_t i = 0; i < bitstreams.size(); ++i) {
+    members_[i].instance = std::make_unique<Instance>(bitstreams[i]);
+    members_[i].stats.bitstream = bitstreams[i];
+  }
+  // Threads start after `members_` stops changing, and utilization excludes
+  // the time of loading bitstreams.
+  created_ = clock::now();
+  for (size_t i = 0; i < members_.size(); ++i) {
+    members_[i].thread = std::thread(&InstanceGroup::Run, this, i);
+  }
+}
+
+InstanceGroup::~InstanceGroup() {
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this] { return pending_tasks_ == 0; });
+    is_stopped_ = true;
+  }
+  cv_.notify_all();
+  for (auto& member : members_) {
+    member.thread.join();
+  }
+}
+
+void InstanceGroup::Submit(Task task, double cost) {
+  if (!(cost > 0)) {
+    throw std::invalid_argument("task cost must be positive");
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto member = std::min_element(
+        members_.begin(), members_.end(),
+        [this, cost](const Member& lhs, const Member& rhs) {
+          return EstimateNanoSeconds(lhs, cost) <
+                 EstimateNanoSeconds(rhs, cost);
+        });
+    member->queue.push_back({std::move(task), cost});
+    member->queued_cost += cost;
+    ++pending_tasks_;
+  }
+  cv_.notify_all();
+}
+
+void InstanceGroup::Wait() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  cv_.wait(lock, [this] { return pending_tasks_ == 0; });
+  if (error_ != nullptr) {
+    std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+}
+
+InstanceGroupStats InstanceGroup::GetStats() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  const int64_t lifetime_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                           created_)
+          .count();
+  double total_cost = 0;
+  for (const auto& member : members_) {
+    total_cost += member.stats.cost;
+  }
+  InstanceGroupStats stats;
+  for (const auto& member : members_) {
+    auto member_stats = member.stats;
+    member_stats.share = total_cost > 0 ? member_stats.cost / total_cost : 0;
+    member_stats.utilization =
+        lifetime_ns > 0
+            ? static_cast<double>(member_stats.busy_time_ns) / lifetime_ns
+            : 0;
+    member_stats.throughput = member.throughput * 1e9;
+    stats.members.push_back(std::move(member_stats));
+  }
+  return stats;
+}
+
+double InstanceGroup::GetThroughput(const Member& member) const {
+  if (member.throughput > 0) {
+    return member.throughput;
+  }
+  double fastest = 0;
+  for (const auto& other : members_) {
+    fastest = std::max(fastest, other.throughput);
+  }
+  // Without any measurement, costs are compared as they are.
+  return fastest > 0 ? fastest : 1;
+}
+
+double InstanceGroup::EstimateNanoSeconds(const Member& member,
+                                          double cost) const {
+  return (member.queued_cost + member.running_cost + cost) /
+         GetThroughput(member);
+}
+
+bool InstanceGroup::TakeTask(size_t index, QueuedTask& task,
+                             bool& is_stolen) {
+  auto& self = members_[index];
+  if (!self.queue.empty()) {
+    task = std::move(self.queue.front());
+    self.queue.pop_front();
+    self.queued_cost -= task.cost;
+    is_stolen = false;
+    return true;
+  }
+  // Steal the last task of the member that would finish it last, but only if
+  // this member would finish it earlier.
+  Member* victim = nullptr;
+  double victim_ns = 0;
+  for (auto& member : members_) {
+    if (!member.queue.empty()) {
+      const double ns = EstimateNanoSeconds(member, 0);
+      if (victim == nullptr || ns > victim_ns) {
+        victim = &member;
+        victim_ns = ns;
+      }
+    }
+  }
+  if (victim == nullptr ||
+      EstimateNanoSeconds(self, victim->queue.back().cost) >= victim_ns) {
+    return false;
+  }
+  task = std::move(victim->queue.back());
+  victim->queue.pop_back();
+  victim->queued_cost -= task.cost;
+  is_stolen = true;
+  return true;
+}
+
+void InstanceGroup::Run(size_t index) {
+  auto& member = members_[index];
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (;;) {
+    QueuedTask task;
+    bool is_stolen = false;
+    cv_.wait(lock, [&] {
+      return is_stopped_ || TakeTask(index, task, is_stolen);
+    });
+    if (task.task == nullptr) {
+      return;
+    }
+    member.running_cost = task.cost;
+    lock.unlock();
+
+    std::exception_ptr error;
+    const auto tic = clock::now();
+    try {
+      task.task(*member.instance);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    const int64_t wall_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                             tic)
+            .count();
+    // Learn from the time the device spent if it is reported, which excludes
+    // the host-side overhead of the task.
+    int64_t device_ns = 0;
+    if (error == nullptr) {
+      device_ns = member.instance->LoadTimeNanoSeconds() +
+                  member.instance->ComputeTimeNanoSeconds() +
+                  member.instance->StoreTimeNanoSeconds();
+    }
+    const int64_t time_ns =
+        device_ns > 0 && device_ns <= wall_ns ? device_ns : wall_ns;
+
+    lock.lock();
+    member.running_cost = 0;
+    if (error != nullptr) {
+      if (error_ == nullptr) {
+        error_ = error;
+      }
+    } else if (time_ns > 0) {
+      const double throughput = task.cost / time_ns;
+      member.throughput =
+          member.throughput > 0
+              ? member.throughput +
+                    kThroughputWeight * (throughput - member.throughput)
+              : throughput;
+    }
+    ++member.stats.tasks;
+    member.stats.stolen_tasks += is_stolen;
+    member.stats.cost += task.cost;
+    member.stats.busy_time_ns += wall_ns;
+    --pending_tasks_;
+    // Other members may now steal, and waiters may be done.
+    cv_.notify_all();
+  }
+}
+
+}  // namespace fpga
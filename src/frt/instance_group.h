@@ -0,0 +1,117 @@
+#ifndef FPGA_RUNTIME_INSTANCE_GROUP_H_
+#define FPGA_RUNTIME_INSTANCE_GROUP_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frt.h"
+
+namespace fpga {
+
+struct InstanceGroupStats {
+  struct Member {
+    std::string bitstream;
+    // Tasks run, including those taken from the queues of other members.
+    int64_t tasks = 0;
+    int64_t stolen_tasks = 0;
+    // Work done in units of task costs, and its fraction of the group's.
+    double cost = 0;
+    double share = 0;
+    // Time spent running tasks, and its fraction of the group's lifetime.
+    int64_t busy_time_ns = 0;
+    double utilization = 0;
+    // Learned throughput in cost per second; zero until a task has run.
+    double throughput = 0;
+  };
+
+  std::vector<Member> members;
+};
+
+std::ostream& operator<<(std::ostream& os, const InstanceGroupStats& stats);
+
+// Runs tasks on a group of instances, e.g., cards of different kinds, each
+// with its own bitstream of the same program. Each task is queued on the
+// member expected to finish it first according to the throughput learned
+// from the profiling data of earlier tasks, and members that run out of work
+// take queued tasks from the busiest member if they would finish them sooner.
+class InstanceGroup {
+ public:
+  // A task invokes the program on the instance it is given and waits for it
+  // to finish, e.g., by calling `Invoke` without stream arguments. Tasks run
+  // on the thread of their member, concurrently with tasks of other members.
+  using Task = std::function<void(Instance& instance)>;
+
+  explicit InstanceGroup(const std::vector<std::string>& bitstreams);
+  // Waits for queued tasks to finish.
+  ~InstanceGroup();
+
+  InstanceGroup(const InstanceGroup&) = delete;
+  InstanceGroup& operator=(const InstanceGroup&) = delete;
+
+  // Queues `task`, which does `cost` units of work, e.g., bytes or elements.
+  // Throughput is learned from the profiling data of the last invocation of
+  // each task, so a task should invoke the program once.
+  void Submit(Task task, double cost = 1);
+
+  // Waits for all submitted tasks to finish, and rethrows the first exception
+  // thrown by them, if any.
+  void Wait();
+
+  // Returns the work done by each member, in the order of `bitstreams`.
+  InstanceGroupStats GetStats() const;
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  struct QueuedTask {
+    Task task;
+    double cost;
+  };
+
+  struct Member {
+    std::unique_ptr<Instance> instance;
+    std::deque<QueuedTask> queue;
+    double queued_cost = 0;
+    double running_cost = 0;
+    // Learned throughput in cost per nanosecond; zero until a task has run.
+    double throughput = 0;
+    InstanceGroupStats::Member stats;
+    std::thread thread;
+  };
+
+  // Returns the throughput assumed for `member`. Members that have not run a
+  // task are assumed to be as fast as the fastest one, so that they get work.
+  double GetThroughput(const Member& member) const;
+  // Returns the estimated time until `member` finishes its work and `cost`.
+  double EstimateNanoSeconds(const Member& member, double cost) const;
+  // Takes the next task of member `index`, either from its own queue or from
+  // another member. Returns false if there is none to take.
+  bool TakeTask(size_t index, QueuedTask& task, bool& is_stolen);
+  void Run(size_t index);
+
+  clock::time_point created_;
+  mutable std::mutex mtx_;
+  // Notified when tasks are queued or finished, or when stopping.
+  std::condition_variable cv_;
+  std::vector<Member> members_;
+  // Tasks that are queued or running.
+  size_t pending_tasks_ = 0;
+  bool is_stopped_ = false;
+  std::exception_ptr error_;
+};
+
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_INSTANCE_GROUP_H_
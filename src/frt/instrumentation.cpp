@@ -0,0 +1,168 @@
+#include "frt/instrumentation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fpga {
+
+namespace {
+
+using Observers = std::vector<std::pair<int, InstrumentationObserver>>;
+
+std::mutex& GetMutex() {
+  static std::mutex mtx;
+  return mtx;
+}
+
+// Replaced as a whole when observers change, so that they are called without
+// holding the lock, and may add or remove observers themselves.
+std::shared_ptr<const Observers>& GetObservers() {
+  static auto* observers =
+      new std::shared_ptr<const Observers>(std::make_shared<Observers>());
+  return *observers;
+}
+
+int next_observer_id = 0;
+std::atomic<uint64_t> next_instance_id{1};
+
+int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os,
+                         const InstrumentationEvent::Kind& kind) {
+  switch (kind) {
+    case InstrumentationEvent::kInvocationStart:
+      return os << "invocation start";
+    case InstrumentationEvent::kEnqueue:
+      return os << "enqueue";
+    case InstrumentationEvent::kComplete:
+      return os << "complete";
+  }
+  return os << "unknown";
+}
+
+std::ostream& operator<<(std::ostream& os,
+                         const InstrumentationEvent::Command& command) {
+  switch (command) {
+    case InstrumentationEvent::kNone:
+      return os << "none";
+    case InstrumentationEvent::kLoad:
+      return os << "load";
+    case InstrumentationEvent::kLaunch:
+      return os << "launch";
+    case InstrumentationEvent::kStore:
+      return os << "store";
+  }
+  return os << "unknown";
+}
+
+std::ostream& operator<<(std::ostream& os, const InstrumentationEvent& event) {
+  os << "InstrumentationEvent: {kind: " << event.kind
+     << ", instance: " << event.instance_id
+     << ", invocation: " << event.invocation << ", time: " << event.host_time_ns
+     << " ns";
+  if (event.kind != InstrumentationEvent::kInvocationStart) {
+    os << ", command: " << event.command << ", arg: " << event.arg_index
+       << ", name: " << event.name << ", bytes: " << event.bytes;
+  }
+  if (event.kind == InstrumentationEvent::kComplete) {
+    os << ", queued: " << event.queued_ns << " ns, start: " << event.start_ns
+       << " ns, end: " << event.end_ns << " ns";
+  }
+  os << "}";
+  return os;
+}
+
+int AddInstrumentationObserver(InstrumentationObserver observer) {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  auto& observers = GetObservers();
+  auto updated = std::make_shared<Observers>(*observers);
+  const int id = next_observer_id++;
+  updated->emplace_back(id, std::move(observer));
+  observers = std::move(updated);
+  internal::is_instrumented.store(true, std::memory_order_relaxed);
+  return id;
+}
+
+void RemoveInstrumentationObserver(int id) {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  auto& observers = GetObservers();
+  auto updated = std::make_shared<Observers>(*observers);
+  updated->erase(std::remove_if(updated->begin(), updated->end(),
+                                [id](const auto& pair) {
+                                  return pair.first == id;
+                                }),
+                 updated->end());
+  internal::is_instrumented.store(!updated->empty(),
+                                  std::memory_order_relaxed);
+  observers = std::move(updated);
+}
+
+namespace internal {
+
+std::atomic<bool> is_instrumented{false};
+
+Instrumentation::Instrumentation() : id_(next_instance_id++) {}
+
+void Instrumentation::Enqueue(InstrumentationEvent::Command command,
+                              int arg_index, std::string name, size_t bytes) {
+  if (!is_invoking_) {
+    is_invoking_ = true;
+    ++invocation_;
+    InstrumentationEvent event;
+    event.kind = InstrumentationEvent::kInvocationStart;
+    Notify(event);
+  }
+  InstrumentationEvent event;
+  event.kind = InstrumentationEvent::kEnqueue;
+  event.command = command;
+  event.arg_index = arg_index;
+  event.name = std::move(name);
+  event.bytes = bytes;
+  Notify(event);
+}
+
+void Instrumentation::Complete(InstrumentationEvent::Command command,
+                               int arg_index, std::string name, size_t bytes,
+                               int64_t queued_ns, int64_t start_ns,
+                               int64_t end_ns) {
+  InstrumentationEvent event;
+  event.kind = InstrumentationEvent::kComplete;
+  event.command = command;
+  event.arg_index = arg_index;
+  event.name = std::move(name);
+  event.bytes = bytes;
+  event.queued_ns = queued_ns;
+  event.start_ns = start_ns;
+  event.end_ns = end_ns;
+  Notify(event);
+}
+
+void Instrumentation::Notify(InstrumentationEvent& event) {
+  event.instance_id = id_;
+  event.invocation = invocation_;
+  event.host_time_ns = Now();
+  std::shared_ptr<const Observers> observers;
+  {
+    std::lock_guard<std::mutex> lock(GetMutex());
+    observers = GetObservers();
+  }
+  for (const auto& [id, observer] : *observers) {
+    observer(event);
+  }
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,115 @@
+#ifndef FPGA_RUNTIME_INSTRUMENTATION_H_
+#define FPGA_RUNTIME_INSTRUMENTATION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace fpga {
+
+// An operation of an instance, reported to instrumentation observers. Times
+// are in nanoseconds of the host's `std::chrono::steady_clock`, comparable
+// with `Timeline`.
+struct InstrumentationEvent {
+  enum Kind {
+    // The first command of an invocation is about to be enqueued.
+    kInvocationStart,
+    // A command has been enqueued.
+    kEnqueue,
+    // A command has completed.
+    kComplete,
+  };
+  enum Command {
+    kNone,
+    kLoad,
+    kLaunch,
+    kStore,
+  };
+
+  Kind kind = kInvocationStart;
+  Command command = kNone;
+  // Identifies the instance in this process; see `GetInstrumentationId`.
+  uint64_t instance_id = 0;
+  // Numbers the invocations of the instance, starting from 1. An invocation
+  // ends when `Finish` returns.
+  uint64_t invocation = 0;
+  // Argument moved by a load or a store, or -1 for launches.
+  int arg_index = -1;
+  // Name of the argument, as in `ArgInfo`, or of the kernel for launches, if
+  // known.
+  std::string name;
+  // Bytes moved by a load or a store.
+  size_t bytes = 0;
+  // When the event was reported.
+  int64_t host_time_ns = 0;
+  // When a completed command was enqueued, started, and ended.
+  int64_t queued_ns = 0;
+  int64_t start_ns = 0;
+  int64_t end_ns = 0;
+};
+
+std::ostream& operator<<(std::ostream& os,
+                         const InstrumentationEvent::Kind& kind);
+std::ostream& operator<<(std::ostream& os,
+                         const InstrumentationEvent::Command& command);
+std::ostream& operator<<(std::ostream& os, const InstrumentationEvent& event);
+
+using InstrumentationObserver =
+    std::function<void(const InstrumentationEvent& event)>;
+
+// Registers `observer` for the operations of all instances in this process,
+// and returns an id for `RemoveInstrumentationObserver`. Observers are called
+// on the thread that calls the instance, so they must be fast and must not
+// call the instance. Enqueues are reported as commands are enqueued, and
+// completions when `Finish` returns, in the order of enqueuing. Commands that
+// move several buffers at once are reported once per buffer with the same
+// times.
+int AddInstrumentationObserver(InstrumentationObserver observer);
+
+// Unregisters the observer of `id`. Calls already started on other threads may
+// still be running when this returns.
+void RemoveInstrumentationObserver(int id);
+
+namespace internal {
+
+extern std::atomic<bool> is_instrumented;
+
+// Returns whether any observer is registered. Devices check this before
+// preparing events, so that instrumentation costs a single branch otherwise.
+inline bool IsInstrumented() {
+  return is_instrumented.load(std::memory_order_relaxed);
+}
+
+// Reports the operations of an instance to the registered observers.
+class Instrumentation {
+ public:
+  Instrumentation();
+
+  uint64_t GetId() const { return id_; }
+
+  // Reports that `command` has been enqueued. The first command after
+  // `EndInvocation` starts a new invocation.
+  void Enqueue(InstrumentationEvent::Command command, int arg_index,
+               std::string name, size_t bytes);
+  // Reports that `command` has completed.
+  void Complete(InstrumentationEvent::Command command, int arg_index,
+                std::string name, size_t bytes, int64_t queued_ns,
+                int64_t start_ns, int64_t end_ns);
+  void EndInvocation() { is_invoking_ = false; }
+
+ private:
+  void Notify(InstrumentationEvent& event);
+
+  const uint64_t id_;
+  uint64_t invocation_ = 0;
+  bool is_invoking_ = false;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_INSTRUMENTATION_H_
@@ -1,5 +1,6 @@
 #include "frt/intel_opencl_device.h"
 
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -8,18 +9,38 @@
 
 #include <tinyxml.h>
 
+#include "frt/environ.h"
 #include "frt/opencl_util.h"
 #include "frt/stream_wrapper.h"
 #include "frt/tag.h"
 
+#ifndef CL_CONTEXT_COMPILER_MODE_INTELFPGA
+#define CL_CONTEXT_COMPILER_MODE_INTELFPGA 0x40F0
+#endif  // CL_CONTEXT_COMPILER_MODE_INTELFPGA
+#ifndef CL_CONTEXT_COMPILER_MODE_PRELOADED_BINARY_ONLY_INTELFPGA
+#define CL_CONTEXT_COMPILER_MODE_PRELOADED_BINARY_ONLY_INTELFPGA 3
+#endif  // CL_CONTEXT_COMPILER_MODE_PRELOADED_BINARY_ONLY_INTELFPGA
+
 namespace fpga {
 namespace internal {
 
+namespace {
+
+// Buffers can be allocated in bank N of their memory with
+// `CL_CHANNEL_<N + 1>_INTELFPGA`, which is `(N + 1) << 16`, if the bitstream
+// is compiled without interleaving across banks.
+constexpr int kMaxBanks = 7;
+
+cl_mem_flags GetBankFlag(int bank) { return cl_mem_flags(bank + 1) << 16; }
+
+}  // namespace
+
 IntelOpenclDevice::IntelOpenclDevice(const cl::Program::Binaries& binaries) {
   std::string target_device_name;
   std::string vendor_name;
   std::vector<std::string> kernel_names;
   std::vector<int> kernel_arg_counts;
+  std::string default_memory;
   int arg_count = 0;
   auto data = binaries.begin()->data();
   if (data[EI_CLASS] == ELFCLASS32) {
@@ -58,6 +79,9 @@ IntelOpenclDevice::IntelOpenclDevice(const cl::Program::Binaries& binaries) {
             ++arg_count;
             arg.name = xml_arg->Attribute("name");
             arg.type = xml_arg->Attribute("type_name");
+            if (auto location = xml_arg->Attribute("buffer_location")) {
+              arg.memory = location;
+            }
             auto cat = atoi(xml_arg->Attribute("opencl_access_type"));
             switch (cat) {
               case 0:
@@ -71,15 +95,45 @@ IntelOpenclDevice::IntelOpenclDevice(const cl::Program::Binaries& binaries) {
             }
           }
         }
+      } else if (strcmp(section_name, ".acl.board_spec.xml") == 0) {
+        TiXmlDocument doc;
+        doc.Parse(reinterpret_cast<const char*>(elf_header) +
+                      section_header->sh_offset,
+                  0, TIXML_ENCODING_UTF8);
+        auto xml_board = doc.FirstChildElement("board");
+        for (auto xml_mem = xml_board == nullptr
+                                ? nullptr
+                                : xml_board->FirstChildElement("global_mem");
+             xml_mem != nullptr;
+             xml_mem = xml_mem->NextSiblingElement("global_mem")) {
+          const char* name = xml_mem->Attribute("name");
+          if (name == nullptr) {
+            continue;
+          }
+          int bank_count = 0;
+          for (auto xml_interface = xml_mem->FirstChildElement("interface");
+               xml_interface != nullptr;
+               xml_interface = xml_interface->NextSiblingElement("interface")) {
+            ++bank_count;
+          }
+          bank_counts_[name] = std::min(bank_count, kMaxBanks);
+          const char* is_default = xml_mem->Attribute("default");
+          if (default_memory.empty() ||
+              (is_default != nullptr && strcmp(is_default, "1") == 0)) {
+            default_memory = name;
+          }
+        }
       } else if (strcmp(section_name, ".acl.board") == 0) {
         const std::string board_name(reinterpret_cast<const char*>(elf_header) +
                                          section_header->sh_offset,
                                      section_header->sh_size);
         if (board_name == "EmulatorDevice") {
-          setenv("CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA", "1", 0);
+          Environ environ = {{"CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA", "1"}};
+          ExportEnviron(environ, /* overwrite = */ false);
         }
         if (board_name == "SimulatorDevice") {
-          setenv("CL_CONTEXT_MPSIM_DEVICE_INTELFPGA", "1", 0);
+          Environ environ = {{"CL_CONTEXT_MPSIM_DEVICE_INTELFPGA", "1"}};
+          ExportEnviron(environ, /* overwrite = */ false);
         }
         target_device_name = board_name;
       }
@@ -87,6 +141,12 @@ IntelOpenclDevice::IntelOpenclDevice(const cl::Program::Binaries& binaries) {
     if (kernel_names.empty() || target_device_name.empty()) {
       throw std::runtime_error("unexpected ELF file");
     }
+    for (auto& pair : arg_table_) {
+      auto& arg = pair.second;
+      if (arg.cat == ArgInfo::kMmap && arg.memory.empty()) {
+        arg.memory = default_memory;
+      }
+    }
   } else if (data[EI_CLASS] == ELFCLASS64) {
     vendor_name = "Intel(R) FPGA Emulation Platform for OpenCL(TM)";
     target_device_name = "Intel(R) FPGA Emulation Device";
@@ -112,38 +172,117 @@ void IntelOpenclDevice::SetStreamArg(int index, Tag tag, StreamWrapper& arg) {
   throw std::runtime_error("Intel OpenCL device does not support streaming");
 };
 
-void IntelOpenclDevice::WriteToDevice() {
-  load_event_.resize(load_indices_.size());
-  int i = 0;
-  for (auto index : load_indices_) {
-    auto buffer = buffer_table_[index];
-    CL_CHECK(cmd_.enqueueWriteBuffer(
-        buffer, /* blocking = */ CL_FALSE, /* offset = */ 0,
-        buffer.getInfo<CL_MEM_SIZE>(), host_ptr_table_[index],
-        /* events = */ nullptr, &load_event_[i]));
-    ++i;
+void IntelOpenclDevice::SetBufferBank(int index, int bank) {
+  auto arg = arg_table_.find(index);
+  if (arg == arg_table_.end() || arg->second.cat != ArgInfo::kMmap) {
+    throw std::invalid_argument("argument " + std::to_string(index) +
+                                " is not a buffer");
   }
+  auto bank_count = bank_counts_.find(arg->second.memory);
+  if (bank < 0 || bank_count == bank_counts_.end() ||
+      bank >= bank_count->second) {
+    throw std::out_of_range("bank " + std::to_string(bank) +
+                            " does not exist in memory '" +
+                            arg->second.memory + "'");
+  }
+  bank_hints_[index] = bank;
+}
+
+uint32_t IntelOpenclDevice::ReadRegister(const std::string& name) {
+  throw std::runtime_error(
+      "Intel OpenCL device does not support reading registers");
+}
+
+void IntelOpenclDevice::EnqueueLoad(const TransferList& transfers,
+                                    const std::vector<cl::Event>& events) {
+  EnqueueTransfers(transfers, events, /* is_store = */ false, load_event_);
+}
+
+void IntelOpenclDevice::EnqueueStore(const TransferList& transfers,
+                                     const std::vector<cl::Event>& events) {
+  EnqueueTransfers(transfers, events, /* is_store = */ true, store_event_);
 }
 
-void IntelOpenclDevice::ReadFromDevice() {
-  store_event_.resize(store_indices_.size());
-  int i = 0;
-  for (auto index : store_indices_) {
-    auto buffer = buffer_table_[index];
-    cmd_.enqueueReadBuffer(buffer, /* blocking = */ CL_FALSE,
-                           /* offset = */ 0, buffer.getInfo<CL_MEM_SIZE>(),
-                           host_ptr_table_[index], &compute_event_,
-                           &store_event_[i]);
-    ++i;
+void IntelOpenclDevice::EnqueueTransfers(
+    const TransferList& transfers, const std::vector<cl::Event>& events,
+    bool is_store, std::vector<cl::Event>& transfer_events) {
+  // Throttled buffers are moved in chunks, each after the previous one, so
+  // that the last chunk completes the transfer. Events of the earlier chunks
+  // follow those of the transfers and are only used for profiling.
+  const size_t chunk_size = GetTransferChunkSize(is_store);
+  std::vector<cl::Event> chunk_events;
+  transfer_events.resize(transfers.indices.size());
+  for (int i = 0; i < transfers.indices.size(); ++i) {
+    const auto& buffer = buffer_table_[transfers.indices[i]];
+    auto host_ptr = static_cast<char*>(transfers.host_ptrs[i]);
+    std::vector<cl::Event> wait_events = events;
+    for (size_t offset = 0;;) {
+      const size_t size = std::min(chunk_size, transfers.sizes[i] - offset);
+      const auto paced_events = Throttle(is_store, size, wait_events);
+      cl::Event event;
+      if (is_store) {
+        CL_CHECK(cmd_.enqueueReadBuffer(buffer, /* blocking = */ CL_FALSE,
+                                        offset, size, host_ptr + offset,
+                                        &paced_events, &event));
+      } else {
+        CL_CHECK(cmd_.enqueueWriteBuffer(buffer, /* blocking = */ CL_FALSE,
+                                         offset, size, host_ptr + offset,
+                                         &paced_events, &event));
+      }
+      offset += size;
+      if (offset >= transfers.sizes[i]) {
+        transfer_events[i] = event;
+        break;
+      }
+      chunk_events.push_back(event);
+      wait_events = {event};
+    }
   }
+  transfer_events.insert(transfer_events.end(), chunk_events.begin(),
+                         chunk_events.end());
+}
+
+std::vector<cl_context_properties>
+IntelOpenclDevice::GetPreloadedContextProperties() const {
+  return {CL_CONTEXT_COMPILER_MODE_INTELFPGA,
+          CL_CONTEXT_COMPILER_MODE_PRELOADED_BINARY_ONLY_INTELFPGA, 0};
 }
 
 cl::Buffer IntelOpenclDevice::CreateBuffer(int index, cl_mem_flags flags,
                                            void* host_ptr, size_t size) {
   flags |= /* CL_MEM_HETEROGENEOUS_INTELFPGA = */ 1 << 19;
-  host_ptr_table_[index] = host_ptr;
-  host_ptr = nullptr;
-  return OpenclDevice::CreateBuffer(index, flags, host_ptr, size);
+  auto& arg = arg_table_[index];
+  arg.bank = PickBank(index);
+  if (arg.bank >= 0) {
+    flags |= GetBankFlag(arg.bank);
+  }
+  return OpenclDevice::CreateBuffer(index, flags, /* host_ptr = */ nullptr,
+                                    size);
+}
+
+int IntelOpenclDevice::PickBank(int index) const {
+  auto hint = bank_hints_.find(index);
+  if (hint != bank_hints_.end()) {
+    return hint->second;
+  }
+  const auto& memory = arg_table_.at(index).memory;
+  auto bank_count = bank_counts_.find(memory);
+  if (bank_count == bank_counts_.end() || bank_count->second <= 1) {
+    return -1;
+  }
+
+  // Put the buffer in the bank with the fewest bytes of the other buffers, so
+  // that buffers accessed together are served by different memory
+  // controllers.
+  std::vector<size_t> bank_bytes(bank_count->second);
+  for (const auto& pair : host_buffer_table_) {
+    const auto& other = arg_table_.at(pair.first);
+    if (pair.first != index && other.memory == memory && other.bank >= 0) {
+      bank_bytes[other.bank] += pair.second.size;
+    }
+  }
+  return std::min_element(bank_bytes.begin(), bank_bytes.end()) -
+         bank_bytes.begin();
 }
 
 }  // namespace internal
@@ -2,9 +2,12 @@
 #define FPGA_RUNTIME_INTEL_OPENCL_DEVICE_H_
 
 #include <cstddef>
+#include <cstdint>
 
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <CL/cl.h>
 #include <CL/cl2.hpp>
@@ -21,14 +24,32 @@ class IntelOpenclDevice : public OpenclDevice {
   static std::unique_ptr<Device> New(const cl::Program::Binaries& binaries);
 
   void SetStreamArg(int index, Tag tag, StreamWrapper& arg) override;
-  void WriteToDevice() override;
-  void ReadFromDevice() override;
+  void SetBufferBank(int index, int bank) override;
+  uint32_t ReadRegister(const std::string& name) override;
 
  private:
+  std::vector<cl_context_properties> GetPreloadedContextProperties()
+      const override;
   cl::Buffer CreateBuffer(int index, cl_mem_flags flags, void* host_ptr,
                           size_t size) override;
-
-  std::unordered_map<int, void*> host_ptr_table_;
+  void EnqueueLoad(const TransferList& transfers,
+                   const std::vector<cl::Event>& events) override;
+  void EnqueueStore(const TransferList& transfers,
+                    const std::vector<cl::Event>& events) override;
+  // Enqueues a write or read per buffer of `transfers` after `events`, and
+  // sets `transfer_events` to their events.
+  void EnqueueTransfers(const TransferList& transfers,
+                        const std::vector<cl::Event>& events, bool is_store,
+                        std::vector<cl::Event>& transfer_events);
+
+  // Returns the bank to allocate the buffer of argument `index` in, or -1 if
+  // the memory has only one bank.
+  int PickBank(int index) const;
+
+  // Number of banks of each global memory, from the board spec.
+  std::unordered_map<std::string, int> bank_counts_;
+  // Banks requested by the user.
+  std::unordered_map<int, int> bank_hints_;
 };
 
 }  // namespace internal
@@ -0,0 +1,386 @@
+#include "frt/live_stats.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include "frt/environ.h"
+
+namespace fpga {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x53545246;  // "FRTS" in little-endian.
+// Bumped whenever the layout of `Segment` changes.
+constexpr uint32_t kVersion = 1;
+constexpr int kSlotCount = 64;
+constexpr int kNameBytes = 128;
+// Latencies are bucketed by their power of two and the next two bits, i.e.,
+// with a relative error below 25%.
+constexpr int kSubBucketBits = 2;
+constexpr int kLatencyBuckets = 64 << kSubBucketBits;
+
+constexpr char kSegmentPrefix[] = "stats.";
+
+static_assert(std::atomic<int64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "atomics in shared memory must be lock-free");
+
+enum SlotState : uint32_t {
+  kFree = 0,
+  kClaimed = 1,
+  kActive = 2,
+};
+
+struct Slot {
+  std::atomic<uint32_t> state;
+  std::atomic<uint64_t> generation;
+  char bitstream[kNameBytes];
+  char device[kNameBytes];
+  std::atomic<int64_t> invocations;
+  std::atomic<int64_t> in_flight;
+  std::atomic<int64_t> load_bytes;
+  std::atomic<int64_t> store_bytes;
+  std::atomic<int64_t> load_time_ns;
+  std::atomic<int64_t> compute_time_ns;
+  std::atomic<int64_t> store_time_ns;
+  std::atomic<int64_t> cache_hits;
+  std::atomic<int64_t> cache_misses;
+  std::atomic<int64_t> latency_histogram[kLatencyBuckets];
+};
+
+// The segment of a process, a file that is zero-filled when created. `magic`
+// is set last, after the other fields of the header.
+struct Segment {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t slot_bytes;
+  int64_t pid;
+  Slot slots[kSlotCount];
+};
+
+int GetLatencyBucket(int64_t ns) {
+  if (ns < (1 << kSubBucketBits)) {
+    return std::max<int64_t>(ns, 0);
+  }
+  const int exponent = 63 - __builtin_clzll(ns);
+  const int mantissa = (ns >> (exponent - kSubBucketBits)) &
+                       ((1 << kSubBucketBits) - 1);
+  return ((exponent - kSubBucketBits + 1) << kSubBucketBits) + mantissa;
+}
+
+// Returns the largest latency in bucket `bucket`.
+int64_t GetLatencyBucketBound(int bucket) {
+  if (bucket < (1 << kSubBucketBits)) {
+    return bucket;
+  }
+  const int exponent = (bucket >> kSubBucketBits) + kSubBucketBits - 1;
+  const int64_t mantissa =
+      (bucket & ((1 << kSubBucketBits) - 1)) + (1 << kSubBucketBits);
+  return ((mantissa + 1) << (exponent - kSubBucketBits)) - 1;
+}
+
+std::string GetSegmentPath(int64_t pid) {
+  return internal::GetRuntimeDir() + "/" + kSegmentPrefix +
+         std::to_string(pid);
+}
+
+bool IsAlive(int64_t pid) { return kill(pid, 0) == 0 || errno == EPERM; }
+
+// Maps the segment of this process, or returns null if publishing is
+// disabled or the segment cannot be created. The segment is removed when the
+// process exits.
+Segment* CreateSegment() {
+  const auto enabled = internal::GetEnv("FRT_LIVE_STATS");
+  if (enabled.has_value() && *enabled == "0") {
+    return nullptr;
+  }
+  static const auto* path = new std::string(GetSegmentPath(getpid()));
+  const int fd = open(path->c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    PLOG(WARNING) << "cannot create live statistics '" << *path << "'";
+    return nullptr;
+  }
+  void* addr = MAP_FAILED;
+  if (ftruncate(fd, sizeof(Segment)) == 0) {
+    addr = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, 0);
+  }
+  if (addr == MAP_FAILED) {
+    PLOG(WARNING) << "cannot map live statistics '" << *path << "'";
+    close(fd);
+    unlink(path->c_str());
+    return nullptr;
+  }
+  close(fd);
+  auto segment = static_cast<Segment*>(addr);
+  segment->version = kVersion;
+  segment->slot_count = kSlotCount;
+  segment->slot_bytes = sizeof(Slot);
+  segment->pid = getpid();
+  segment->magic.store(kMagic, std::memory_order_release);
+  atexit([] { unlink(path->c_str()); });
+  return segment;
+}
+
+Segment* GetSegment() {
+  // Never unmapped; instances may be destroyed after `main` returns.
+  static Segment* const segment = CreateSegment();
+  return segment;
+}
+
+void CopyName(const std::string& name, char (&dst)[kNameBytes]) {
+  memset(dst, 0, kNameBytes);
+  // Long names, e.g., bitstream paths, keep their most specific end.
+  const size_t size = std::min<size_t>(name.size(), kNameBytes - 1);
+  memcpy(dst, name.data() + name.size() - size, size);
+}
+
+// Reads the live instances in the segment of `pid` into `stats`.
+void ReadSegment(int64_t pid, std::vector<LiveStats>& stats) {
+  const std::string path = GetSegmentPath(pid);
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat st;
+  void* addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size == sizeof(Segment)) {
+    addr = mmap(nullptr, sizeof(Segment), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return;
+  }
+  const auto segment = static_cast<const Segment*>(addr);
+  // Segments of other versions, and of processes that exited without
+  // removing theirs, are skipped.
+  if (segment->magic.load(std::memory_order_acquire) == kMagic &&
+      segment->version == kVersion && segment->slot_count == kSlotCount &&
+      segment->slot_bytes == sizeof(Slot) && segment->pid == pid &&
+      IsAlive(pid)) {
+    for (int i = 0; i < kSlotCount; ++i) {
+      const auto& slot = segment->slots[i];
+      if (slot.state.load(std::memory_order_acquire) != kActive) {
+        continue;
+      }
+      LiveStats item;
+      item.pid = pid;
+      item.slot = i;
+      item.generation = slot.generation.load(std::memory_order_acquire);
+      item.bitstream.assign(slot.bitstream,
+                            strnlen(slot.bitstream, kNameBytes));
+      item.device.assign(slot.device, strnlen(slot.device, kNameBytes));
+      item.invocations = slot.invocations.load(std::memory_order_relaxed);
+      item.in_flight = slot.in_flight.load(std::memory_order_relaxed);
+      item.load_bytes = slot.load_bytes.load(std::memory_order_relaxed);
+      item.store_bytes = slot.store_bytes.load(std::memory_order_relaxed);
+      item.load_time_ns = slot.load_time_ns.load(std::memory_order_relaxed);
+      item.compute_time_ns =
+          slot.compute_time_ns.load(std::memory_order_relaxed);
+      item.store_time_ns = slot.store_time_ns.load(std::memory_order_relaxed);
+      item.cache_hits = slot.cache_hits.load(std::memory_order_relaxed);
+      item.cache_misses = slot.cache_misses.load(std::memory_order_relaxed);
+      item.latency_histogram.resize(kLatencyBuckets);
+      for (int j = 0; j < kLatencyBuckets; ++j) {
+        item.latency_histogram[j] =
+            slot.latency_histogram[j].load(std::memory_order_relaxed);
+      }
+      // The slot may have been reused while it was read.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.state.load(std::memory_order_relaxed) == kActive &&
+          slot.generation.load(std::memory_order_relaxed) ==
+              item.generation) {
+        stats.push_back(std::move(item));
+      }
+    }
+  }
+  munmap(addr, sizeof(Segment));
+}
+
+}  // namespace
+
+int64_t LiveStats::LatencyPercentileNanoSeconds(double q) const {
+  int64_t total = 0;
+  for (auto count : latency_histogram) {
+    total += count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const auto rank = std::max<int64_t>(1, std::ceil(q * total));
+  int64_t count = 0;
+  for (size_t i = 0; i < latency_histogram.size(); ++i) {
+    count += latency_histogram[i];
+    if (count >= rank) {
+      return GetLatencyBucketBound(i);
+    }
+  }
+  return GetLatencyBucketBound(latency_histogram.size() - 1);
+}
+
+double LiveStats::CacheHitRate() const {
+  const int64_t lookups = cache_hits + cache_misses;
+  return lookups == 0 ? 0. : static_cast<double>(cache_hits) / lookups;
+}
+
+LiveStats LiveStats::Since(const LiveStats& earlier) const {
+  LiveStats stats = *this;
+  stats.invocations -= earlier.invocations;
+  stats.load_bytes -= earlier.load_bytes;
+  stats.store_bytes -= earlier.store_bytes;
+  stats.load_time_ns -= earlier.load_time_ns;
+  stats.compute_time_ns -= earlier.compute_time_ns;
+  stats.store_time_ns -= earlier.store_time_ns;
+  stats.cache_hits -= earlier.cache_hits;
+  stats.cache_misses -= earlier.cache_misses;
+  for (size_t i = 0; i < stats.latency_histogram.size() &&
+                     i < earlier.latency_histogram.size();
+       ++i) {
+    stats.latency_histogram[i] -= earlier.latency_histogram[i];
+  }
+  return stats;
+}
+
+std::ostream& operator<<(std::ostream& os, const LiveStats& stats) {
+  os << "LiveStats: {pid: " << stats.pid << ", bitstream: " << stats.bitstream
+     << ", device: " << stats.device << ", invocations: " << stats.invocations
+     << ", in flight: " << stats.in_flight
+     << ", load bytes: " << stats.load_bytes
+     << ", store bytes: " << stats.store_bytes
+     << ", p50: " << stats.LatencyPercentileNanoSeconds(0.5)
+     << " ns, p99: " << stats.LatencyPercentileNanoSeconds(0.99)
+     << " ns, cache hit rate: " << stats.CacheHitRate();
+  os << "}";
+  return os;
+}
+
+std::vector<LiveStats> ReadLiveStats(int64_t pid) {
+  std::vector<LiveStats> stats;
+  if (pid != 0) {
+    ReadSegment(pid, stats);
+    return stats;
+  }
+  const std::string dir = internal::GetRuntimeDir();
+  std::unique_ptr<DIR, int (*)(DIR*)> entries(opendir(dir.c_str()), closedir);
+  if (entries == nullptr) {
+    return stats;
+  }
+  std::vector<int64_t> pids;
+  const size_t prefix_size = strlen(kSegmentPrefix);
+  while (const dirent* entry = readdir(entries.get())) {
+    const std::string name = entry->d_name;
+    if (name.compare(0, prefix_size, kSegmentPrefix) == 0 &&
+        name.size() > prefix_size &&
+        name.find_first_not_of("0123456789", prefix_size) ==
+            std::string::npos) {
+      pids.push_back(std::stoll(name.substr(prefix_size)));
+    }
+  }
+  std::sort(pids.begin(), pids.end());
+  for (auto pid : pids) {
+    ReadSegment(pid, stats);
+  }
+  return stats;
+}
+
+namespace internal {
+
+std::unique_ptr<LiveStatsSlot> LiveStatsSlot::Create(
+    const std::string& bitstream, const std::string& device) {
+  Segment* segment = GetSegment();
+  if (segment == nullptr) {
+    return nullptr;
+  }
+  for (auto& slot : segment->slots) {
+    uint32_t state = kFree;
+    if (!slot.state.compare_exchange_strong(state, kClaimed,
+                                            std::memory_order_acquire)) {
+      continue;
+    }
+    CopyName(bitstream, slot.bitstream);
+    CopyName(device, slot.device);
+    for (auto* counter :
+         {&slot.invocations, &slot.in_flight, &slot.load_bytes,
+          &slot.store_bytes, &slot.load_time_ns, &slot.compute_time_ns,
+          &slot.store_time_ns, &slot.cache_hits, &slot.cache_misses}) {
+      counter->store(0, std::memory_order_relaxed);
+    }
+    for (auto& count : slot.latency_histogram) {
+      count.store(0, std::memory_order_relaxed);
+    }
+    slot.generation.fetch_add(1, std::memory_order_relaxed);
+    slot.state.store(kActive, std::memory_order_release);
+    return std::unique_ptr<LiveStatsSlot>(new LiveStatsSlot(&slot));
+  }
+  static std::once_flag flag;
+  std::call_once(flag, [] {
+    LOG(WARNING) << "all " << kSlotCount
+                 << " live statistics slots are in use; new instances are "
+                    "not published";
+  });
+  return nullptr;
+}
+
+LiveStatsSlot::~LiveStatsSlot() {
+  static_cast<Slot*>(slot_)->state.store(kFree, std::memory_order_release);
+}
+
+void LiveStatsSlot::AddLaunch() {
+  if (launches_++ == 0) {
+    first_launch_ = clock::now();
+  }
+  static_cast<Slot*>(slot_)->in_flight.fetch_add(1,
+                                                  std::memory_order_relaxed);
+}
+
+void LiveStatsSlot::Finish(const TenantUsage& usage) {
+  auto& slot = *static_cast<Slot*>(slot_);
+  if (launches_ > 0) {
+    const int64_t latency_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                             first_launch_)
+            .count();
+    slot.latency_histogram[GetLatencyBucket(latency_ns)].fetch_add(
+        1, std::memory_order_relaxed);
+    slot.in_flight.fetch_sub(launches_, std::memory_order_relaxed);
+    launches_ = 0;
+  }
+  slot.invocations.fetch_add(usage.invocations, std::memory_order_relaxed);
+  slot.load_bytes.fetch_add(usage.load_bytes, std::memory_order_relaxed);
+  slot.store_bytes.fetch_add(usage.store_bytes, std::memory_order_relaxed);
+  slot.load_time_ns.fetch_add(usage.load_time_ns, std::memory_order_relaxed);
+  slot.compute_time_ns.fetch_add(usage.compute_time_ns,
+                                 std::memory_order_relaxed);
+  slot.store_time_ns.fetch_add(usage.store_time_ns, std::memory_order_relaxed);
+}
+
+void LiveStatsSlot::AddCacheLookup(bool is_hit) {
+  auto& slot = *static_cast<Slot*>(slot_);
+  (is_hit ? slot.cache_hits : slot.cache_misses)
+      .fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,102 @@
+#ifndef FPGA_RUNTIME_LIVE_STATS_H_
+#define FPGA_RUNTIME_LIVE_STATS_H_
+
+#include <cstdint>
+
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "frt/tenant_usage.h"
+
+namespace fpga {
+
+// Counters of an instance, as published by its process for monitors such as
+// `frt-top`. Each process publishes the counters of its instances in a
+// shared-memory segment in the FRT runtime directory, which is updated with
+// atomic operations as invocations finish. Publishing is enabled unless the
+// environment variable `FRT_LIVE_STATS` is set to 0.
+struct LiveStats {
+  int64_t pid = 0;
+  // Identifies the instance among those that have used the same slot of the
+  // segment.
+  int slot = 0;
+  uint64_t generation = 0;
+  std::string bitstream;
+  std::string device;
+
+  // Invocations finished by `Finish`, or by replaying a graph with `Finish`,
+  // counted once per `Finish` as for tenant usage.
+  int64_t invocations = 0;
+  // Kernel launches that have not finished yet.
+  int64_t in_flight = 0;
+  // Profiling data of the finished invocations.
+  int64_t load_bytes = 0;
+  int64_t store_bytes = 0;
+  int64_t load_time_ns = 0;
+  int64_t compute_time_ns = 0;
+  int64_t store_time_ns = 0;
+  // Lookups in the result cache.
+  int64_t cache_hits = 0;
+  int64_t cache_misses = 0;
+  // Number of invocations by host latency, i.e., the time from enqueuing
+  // their first kernel launch until `Finish` returns, in logarithmic buckets.
+  std::vector<int64_t> latency_histogram;
+
+  // Returns the `q`-quantile of the latency, e.g., 0.99, rounded up to the
+  // bucket boundary, or zero if there is no invocation.
+  int64_t LatencyPercentileNanoSeconds(double q) const;
+  double CacheHitRate() const;
+
+  // Returns the counters accumulated since `earlier`, a snapshot of the same
+  // instance, e.g., to compute rates. `in_flight` is kept as is.
+  LiveStats Since(const LiveStats& earlier) const;
+};
+
+std::ostream& operator<<(std::ostream& os, const LiveStats& stats);
+
+// Returns the counters of the live instances of process `pid`, or of all
+// processes of this user if `pid` is zero. Counters are read one by one, so
+// those of a snapshot may be from slightly different moments.
+std::vector<LiveStats> ReadLiveStats(int64_t pid = 0);
+
+namespace internal {
+
+// A slot of the live statistics segment of this process, published while the
+// slot exists.
+class LiveStatsSlot {
+ public:
+  // Returns a new slot, or null if publishing is disabled or all slots are in
+  // use.
+  static std::unique_ptr<LiveStatsSlot> Create(const std::string& bitstream,
+                                               const std::string& device);
+  ~LiveStatsSlot();
+
+  LiveStatsSlot(const LiveStatsSlot&) = delete;
+  LiveStatsSlot& operator=(const LiveStatsSlot&) = delete;
+
+  // Counts a kernel launch, which is in flight until `Finish`.
+  void AddLaunch();
+  // Counts the launches since the last call as finished, and adds `usage`,
+  // the profiling data of the invocation.
+  void Finish(const TenantUsage& usage);
+  void AddCacheLookup(bool is_hit);
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  explicit LiveStatsSlot(void* slot) : slot_(slot) {}
+
+  // Points into the shared-memory segment, whose layout is private to
+  // `live_stats.cpp`.
+  void* const slot_;
+  int64_t launches_ = 0;
+  clock::time_point first_launch_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_LIVE_STATS_H_
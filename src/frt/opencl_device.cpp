@@ -1,13 +1,29 @@
 #include "frt/opencl_device.h"
 #include <CL/cl.h>
 
+#include <cstdint>
+
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "frt/bitstream_record.h"
+#include "frt/compression.h"
+#include "frt/dependency_tracker.h"
+#include "frt/hash.h"
+#include "frt/instrumentation.h"
 #include "frt/opencl_util.h"
+#include "frt/page_preparer.h"
+#include "frt/probes.h"
 
 namespace fpga {
 namespace internal {
@@ -46,14 +62,110 @@ int64_t Latest(const std::vector<cl::Event>& events,
   return default_value;
 }
 
+using clock = std::chrono::steady_clock;
+
+int64_t ToNanoSeconds(clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+      .count();
+}
+
+// Contexts that partial bitstreams can be loaded into, keyed by device and
+// shell. They are kept until the process exits so that instances cycling
+// between bitstreams do not reopen the device. The table is never destroyed,
+// because releasing contexts during static destruction may call into a
+// vendor runtime that is already torn down.
+using ShellContextMap =
+    std::map<std::pair<cl_device_id, std::string>, cl::Context>;
+std::mutex shell_mutex;
+
+ShellContextMap& GetShellContexts() {
+  static auto* shell_contexts = new ShellContextMap;
+  return *shell_contexts;
+}
+
+cl::Context FindShellContext(const cl::Device& device,
+                             const std::string& shell_id) {
+  std::lock_guard<std::mutex> lock(shell_mutex);
+  const auto& shell_contexts = GetShellContexts();
+  auto it = shell_contexts.find({device(), shell_id});
+  return it == shell_contexts.end() ? cl::Context() : it->second;
+}
+
+void AddShellContext(const cl::Device& device, const std::string& shell_id,
+                     const cl::Context& context) {
+  std::lock_guard<std::mutex> lock(shell_mutex);
+  GetShellContexts().emplace(std::make_pair(device(), shell_id), context);
+}
+
+bool IsSameChunks(const std::vector<BufferArg>& lhs,
+                  const std::vector<BufferArg>& rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                    [](const BufferArg& lhs, const BufferArg& rhs) {
+                      return lhs.Get() == rhs.Get() &&
+                             lhs.SizeInBytes() == rhs.SizeInBytes();
+                    });
+}
+
+// Returns the event of the `i`-th transfer in `events`, which has either one
+// event per transfer or one event for all.
+const cl::Event& GetTransferEvent(const std::vector<cl::Event>& events,
+                                  size_t i) {
+  return events.size() == 1 ? events[0] : events[i];
+}
+
+cl::CommandQueue CreateCommandQueue(const cl::Context& context,
+                                    const cl::Device& device) {
+  cl_int err;
+  cl::CommandQueue cmd(
+      context, device,
+      CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_PROFILING_ENABLE,
+      &err);
+  CL_CHECK(err);
+  return cmd;
+}
+
 }  // namespace
 
+OpenclDevice::~OpenclDevice() { ReleaseClObjects(); }
+
 void OpenclDevice::SetScalarArg(int index, const void* arg, int size) {
   auto pair = GetKernel(index);
   pair.second.setArg(pair.first, size, arg);
 }
 
 void OpenclDevice::SetBufferArg(int index, Tag tag, const BufferArg& arg) {
+  SetHostBuffer(index, {arg.Get(), arg.SizeInBytes(), tag, {}});
+}
+
+void OpenclDevice::SetChunkedBufferArg(int index, Tag tag,
+                                       const std::vector<BufferArg>& chunks) {
+  HostBuffer host_buffer = {nullptr, 0, tag, chunks};
+  for (const auto& chunk : chunks) {
+    host_buffer.size += chunk.SizeInBytes();
+  }
+  SetHostBuffer(index, host_buffer);
+}
+
+void OpenclDevice::SetCompressedBufferArg(int index, Tag tag,
+                                          const BufferArg& arg,
+                                          const CompressionOptions& options) {
+  HostBuffer host_buffer = {arg.Get(), arg.SizeInBytes(), tag, {}};
+  // Setting a buffer of the same size again keeps the staging buffer.
+  auto it = host_buffer_table_.find(index);
+  if (it != host_buffer_table_.end() && it->second.compressor != nullptr &&
+      it->second.compressor->IsCompatible(host_buffer.size, options)) {
+    host_buffer.compressor = it->second.compressor;
+  } else {
+    host_buffer.compressor =
+        std::make_shared<BlockCompressor>(host_buffer.size, options);
+  }
+  SetHostBuffer(index, host_buffer);
+}
+
+void OpenclDevice::SetHostBuffer(int index, const HostBuffer& host_buffer) {
+  const Tag tag = host_buffer.tag;
+  FRT_PROBE(set__buffer__arg, instrumentation_.GetId(), index, host_buffer.ptr,
+            host_buffer.size, static_cast<int>(tag));
   cl_mem_flags flags = 0;
   switch (tag) {
     case Tag::kPlaceHolder:
@@ -68,7 +180,32 @@ void OpenclDevice::SetBufferArg(int index, Tag tag, const BufferArg& arg) {
       flags = CL_MEM_READ_WRITE;
       break;
   }
-  cl::Buffer buffer = CreateBuffer(index, flags, arg.Get(), arg.SizeInBytes());
+  cl::Buffer buffer;
+  auto it = host_buffer_table_.find(index);
+  if (it != host_buffer_table_.end() && it->second.ptr == host_buffer.ptr &&
+      it->second.size == host_buffer.size && it->second.tag == tag &&
+      IsSameChunks(it->second.chunks, host_buffer.chunks) &&
+      it->second.compressor == host_buffer.compressor) {
+    // Setting the same host memory again reuses the buffer, which is ordered
+    // after in-flight commands by the dependency tracking.
+    buffer = buffer_table_.at(index);
+    FRT_PROBE(buffer__reuse, instrumentation_.GetId(), index,
+              host_buffer.size);
+  } else {
+    FRT_PROBE(buffer__create, instrumentation_.GetId(), index,
+              host_buffer.size);
+    // Drivers fault in and pin host memory when creating buffers from it.
+    PagePreparer::Wait(host_buffer.ptr, host_buffer.size);
+    if (host_buffer.compressor != nullptr) {
+      // The device buffer holds the block format, which is moved by offset
+      // reads and writes of the staging buffer.
+      buffer = CreateBuffer(index, flags, /* host_ptr = */ nullptr,
+                            host_buffer.compressor->GetCapacity());
+    } else {
+      buffer = CreateBuffer(index, flags, host_buffer.ptr, host_buffer.size);
+    }
+    host_buffer_table_[index] = host_buffer;
+  }
   if (tag == Tag::kReadOnly || tag == Tag::kReadWrite) {
     store_indices_.insert(index);
   }
@@ -83,20 +220,122 @@ size_t OpenclDevice::SuspendBuffer(int index) {
   return load_indices_.erase(index) + store_indices_.erase(index);
 }
 
+void OpenclDevice::SetBufferBank(int index, int bank) {
+  throw std::runtime_error("bank selection is not supported on this device");
+}
+
+void OpenclDevice::SetBandwidthLimit(const BandwidthLimit& limit) {
+  if (limit.load_bytes_per_second < 0 || limit.store_bytes_per_second < 0) {
+    throw std::invalid_argument("bandwidth must not be negative");
+  }
+  if (limit.chunk_bytes == 0) {
+    throw std::invalid_argument("chunk size must be positive");
+  }
+  bandwidth_limit_ = limit;
+  // Pacers are updated in place, so commands already held keep their order.
+  auto set_limit = [this](std::unique_ptr<TransferPacer>& pacer,
+                          double bytes_per_second, size_t burst_bytes) {
+    if (pacer != nullptr) {
+      pacer->SetLimit(bytes_per_second, burst_bytes);
+    } else if (bytes_per_second > 0) {
+      pacer = std::make_unique<TransferPacer>(context_, bytes_per_second,
+                                              burst_bytes);
+    }
+  };
+  set_limit(load_pacer_, limit.load_bytes_per_second, limit.burst_bytes);
+  set_limit(store_pacer_, limit.store_bytes_per_second, limit.burst_bytes);
+}
+
+void OpenclDevice::SetDeferredSubmission(size_t max_operations) {
+  if (max_operations == 0) {
+    Flush();
+  }
+  max_deferred_operations_ = max_operations;
+}
+
+void OpenclDevice::WriteToDevice() {
+  if (is_capturing_) {
+    graph_.push_back({Operation::kLoad, GetTransferList(load_indices_)});
+    return;
+  }
+  Load(GetTransferList(load_indices_));
+}
+
+void OpenclDevice::ReadFromDevice() {
+  if (is_capturing_) {
+    graph_.push_back({Operation::kStore, GetTransferList(store_indices_)});
+    return;
+  }
+  Store(GetTransferList(store_indices_));
+}
+
 void OpenclDevice::Exec() {
-  compute_event_.resize(kernels_.size());
-  int i = 0;
-  for (auto& pair : kernels_) {
-    CL_CHECK(cmd_.enqueueNDRangeKernel(pair.second, cl::NullRange,
-                                       cl::NDRange(1), cl::NDRange(1),
-                                       &load_event_, &compute_event_[i]));
-    ++i;
+  if (is_capturing_) {
+    graph_.push_back({Operation::kExec});
+    return;
   }
+  EnqueueKernels();
 }
 
-void OpenclDevice::Finish() {
+void OpenclDevice::Flush() {
+  if (is_capturing_) {
+    graph_.push_back({Operation::kFlush});
+    return;
+  }
+  if (submit_gate_() != nullptr) {
+    CL_CHECK(submit_gate_.setStatus(CL_COMPLETE));
+    submit_gate_ = cl::UserEvent();
+    deferred_operations_ = 0;
+  }
   CL_CHECK(cmd_.flush());
-  CL_CHECK(cmd_.finish());
+}
+
+void OpenclDevice::Finish() {
+  if (is_capturing_) {
+    graph_.push_back({Operation::kFinish});
+    return;
+  }
+  FinishCommands();
+}
+
+void OpenclDevice::BeginCapture() {
+  if (is_capturing_) {
+    throw std::runtime_error("already capturing");
+  }
+  is_capturing_ = true;
+  graph_.clear();
+}
+
+void OpenclDevice::EndCapture() {
+  if (!is_capturing_) {
+    throw std::runtime_error("not capturing");
+  }
+  is_capturing_ = false;
+}
+
+void OpenclDevice::Replay() {
+  if (is_capturing_) {
+    throw std::runtime_error("cannot replay while capturing");
+  }
+  for (const auto& operation : graph_) {
+    switch (operation.kind) {
+      case Operation::kLoad:
+        Load(operation.transfers);
+        break;
+      case Operation::kExec:
+        EnqueueKernels();
+        break;
+      case Operation::kStore:
+        Store(operation.transfers);
+        break;
+      case Operation::kFlush:
+        Flush();
+        break;
+      case Operation::kFinish:
+        FinishCommands();
+        break;
+    }
+  }
 }
 
 std::vector<ArgInfo> OpenclDevice::GetArgsInfo() const {
@@ -112,17 +351,77 @@ std::vector<ArgInfo> OpenclDevice::GetArgsInfo() const {
   return args;
 }
 
+StartupProfile OpenclDevice::GetStartupProfile() const {
+  return startup_profile_;
+}
+
+ThrottleStats OpenclDevice::GetThrottleStats() const {
+  ThrottleStats stats;
+  if (load_pacer_ != nullptr) {
+    stats.load_throttled_time_ns = load_pacer_->GetThrottledTimeNs();
+    stats.throttled_commands += load_pacer_->GetThrottledCommands();
+  }
+  if (store_pacer_ != nullptr) {
+    stats.store_throttled_time_ns = store_pacer_->GetThrottledTimeNs();
+    stats.throttled_commands += store_pacer_->GetThrottledCommands();
+  }
+  return stats;
+}
+
+CompressionStats OpenclDevice::GetCompressionStats() const {
+  return compression_stats_;
+}
+
+Timeline OpenclDevice::GetTimeline() const {
+  clock_sync_.Refresh(context_, cmd_);
+  auto get_span = [this](const std::vector<cl::Event>& events) {
+    Timeline::Span span;
+    if (!events.empty()) {
+      span.begin_ns = clock_sync_.ToHostTime(
+          Earliest<CL_PROFILING_COMMAND_START>(events));
+      span.end_ns =
+          clock_sync_.ToHostTime(Latest<CL_PROFILING_COMMAND_END>(events));
+    }
+    return span;
+  };
+  std::vector<cl::Event> events = load_event_;
+  events.insert(events.end(), compute_event_.begin(), compute_event_.end());
+  events.insert(events.end(), store_event_.begin(), store_event_.end());
+  Timeline timeline;
+  if (!events.empty()) {
+    timeline.queued_ns =
+        clock_sync_.ToHostTime(Earliest<CL_PROFILING_COMMAND_QUEUED>(events));
+  }
+  timeline.load = get_span(load_event_);
+  timeline.compute = get_span(compute_event_);
+  timeline.store = get_span(store_event_);
+  return timeline;
+}
+
+// Durations are converted at the rate of the device clock, which does not
+// require synchronizing with the device.
+int64_t OpenclDevice::QueueTimeNanoSeconds() const {
+  std::vector<cl::Event> events = load_event_;
+  events.insert(events.end(), compute_event_.begin(), compute_event_.end());
+  events.insert(events.end(), store_event_.begin(), store_event_.end());
+  return clock_sync_.ToHostDuration(
+      Earliest<CL_PROFILING_COMMAND_START>(events) -
+      Earliest<CL_PROFILING_COMMAND_QUEUED>(events));
+}
 int64_t OpenclDevice::LoadTimeNanoSeconds() const {
-  return Latest<CL_PROFILING_COMMAND_END>(load_event_) -
-         Earliest<CL_PROFILING_COMMAND_START>(load_event_);
+  return clock_sync_.ToHostDuration(
+      Latest<CL_PROFILING_COMMAND_END>(load_event_) -
+      Earliest<CL_PROFILING_COMMAND_START>(load_event_));
 }
 int64_t OpenclDevice::ComputeTimeNanoSeconds() const {
-  return Latest<CL_PROFILING_COMMAND_END>(compute_event_) -
-         Earliest<CL_PROFILING_COMMAND_START>(compute_event_);
+  return clock_sync_.ToHostDuration(
+      Latest<CL_PROFILING_COMMAND_END>(compute_event_) -
+      Earliest<CL_PROFILING_COMMAND_START>(compute_event_));
 }
 int64_t OpenclDevice::StoreTimeNanoSeconds() const {
-  return Latest<CL_PROFILING_COMMAND_END>(store_event_) -
-         Earliest<CL_PROFILING_COMMAND_START>(store_event_);
+  return clock_sync_.ToHostDuration(
+      Latest<CL_PROFILING_COMMAND_END>(store_event_) -
+      Earliest<CL_PROFILING_COMMAND_START>(store_event_));
 }
 size_t OpenclDevice::LoadBytes() const {
   size_t total_size = 0;
@@ -143,11 +442,40 @@ size_t OpenclDevice::StoreBytes() const {
   return total_size;
 }
 
+std::string OpenclDevice::GetPlatformName() const { return platform_name_; }
+
+std::string OpenclDevice::GetDeviceName() const { return device_name_; }
+
+int64_t OpenclDevice::ProbeTransferNanoSeconds(size_t size, bool is_store) {
+  cl_int err;
+  cl::Buffer buffer(context_, CL_MEM_READ_WRITE, size, nullptr, &err);
+  CL_CHECK(err);
+  std::vector<char> host(size);
+  cl::Event event;
+  if (is_store) {
+    CL_CHECK(cmd_.enqueueReadBuffer(buffer, /* blocking = */ CL_FALSE,
+                                    /* offset = */ 0, size, host.data(),
+                                    nullptr, &event));
+  } else {
+    CL_CHECK(cmd_.enqueueWriteBuffer(buffer, /* blocking = */ CL_FALSE,
+                                     /* offset = */ 0, size, host.data(),
+                                     nullptr, &event));
+  }
+  CL_CHECK(event.wait());
+  return clock_sync_.ToHostDuration(GetTime<CL_PROFILING_COMMAND_END>(event) -
+                                    GetTime<CL_PROFILING_COMMAND_START>(event));
+}
+
+uint64_t OpenclDevice::GetInstrumentationId() const {
+  return instrumentation_.GetId();
+}
+
 void OpenclDevice::Initialize(const cl::Program::Binaries& binaries,
                               const std::string& vendor_name,
                               const std::string& target_device_name,
                               const std::vector<std::string>& kernel_names,
-                              const std::vector<int>& kernel_arg_counts) {
+                              const std::vector<int>& kernel_arg_counts,
+                              const std::string& shell_id) {
   std::vector<cl::Platform> platforms;
   CL_CHECK(cl::Platform::get(&platforms));
   cl_int err;
@@ -170,32 +498,90 @@ void OpenclDevice::Initialize(const cl::Program::Binaries& binaries,
                            device_name.substr(0, prefix.size()) == prefix;
         if (is_target_device) {
           std::clog << "INFO: Using " << device_name << std::endl;
+          platform_name_ = platformName;
+          device_name_ = device_name;
           device_ = device;
-          context_ = cl::Context(device, nullptr, nullptr, nullptr, &err);
-          if (err == CL_DEVICE_NOT_AVAILABLE) {
-            std::clog << "WARNING: Device '" << device_name << "' not available"
-                      << std::endl;
-            continue;
+          auto tic = clock::now();
+          // Skip reconfiguration if the device already holds the bitstream
+          // and the vendor runtime supports it.
+          const auto preloaded_properties = GetPreloadedContextProperties();
+          std::optional<BitstreamRecord> record;
+          uint64_t hash = 0;
+          if (!preloaded_properties.empty()) {
+            record.emplace(device_name);
+            hash = Hash(binaries.begin()->data(), binaries.begin()->size());
+            startup_profile_.is_program_preloaded = record->Get() == hash;
+          }
+          if (!shell_id.empty()) {
+            context_ = FindShellContext(device, shell_id);
+            startup_profile_.is_context_reused = context_() != nullptr;
+          }
+          if (!startup_profile_.is_context_reused) {
+            context_ = cl::Context(device,
+                                   startup_profile_.is_program_preloaded
+                                       ? preloaded_properties.data()
+                                       : nullptr,
+                                   nullptr, nullptr, &err);
+            if (err == CL_DEVICE_NOT_AVAILABLE) {
+              std::clog << "WARNING: Device '" << device_name
+                        << "' not available" << std::endl;
+              continue;
+            }
+            CL_CHECK(err);
+          }
+          cmd_ = CreateCommandQueue(context_, device);
+          auto toc = clock::now();
+          startup_profile_.context_time_ns = ToNanoSeconds(toc - tic);
+          FRT_PROBE(device__context, device_name.c_str(),
+                    startup_profile_.context_time_ns,
+                    startup_profile_.is_context_reused);
+          tic = toc;
+          if (record.has_value() && !startup_profile_.is_program_preloaded) {
+            record->Clear();
           }
-          CL_CHECK(err);
-          cmd_ = cl::CommandQueue(context_, device,
-                                  CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE |
-                                      CL_QUEUE_PROFILING_ENABLE,
-                                  &err);
-          CL_CHECK(err);
           std::vector<int> binary_status;
           program_ =
               cl::Program(context_, {device}, binaries, &binary_status, &err);
+          if (err != CL_SUCCESS && startup_profile_.is_program_preloaded) {
+            // The device is reconfigured without updating the record.
+            std::clog << "WARNING: Bitstream not found on '" << device_name
+                      << "'; reconfiguring" << std::endl;
+            startup_profile_.is_program_preloaded = false;
+            record->Clear();
+            context_ = cl::Context(device, nullptr, nullptr, nullptr, &err);
+            CL_CHECK(err);
+            cmd_ = CreateCommandQueue(context_, device);
+            binary_status.clear();
+            program_ =
+                cl::Program(context_, {device}, binaries, &binary_status, &err);
+          }
           for (auto status : binary_status) {
             CL_CHECK(status);
           }
           CL_CHECK(err);
           CL_CHECK(program_.build());
+          if (record.has_value()) {
+            record->Set(hash);
+          }
+          toc = clock::now();
+          startup_profile_.program_time_ns = ToNanoSeconds(toc - tic);
+          FRT_PROBE(device__program, device_name.c_str(),
+                    startup_profile_.program_time_ns,
+                    startup_profile_.is_program_preloaded);
+          tic = toc;
           for (int i = 0; i < kernel_names.size(); ++i) {
             kernels_[kernel_arg_counts[i]] =
                 cl::Kernel(program_, kernel_names[i].c_str(), &err);
             CL_CHECK(err);
+            kernel_names_[kernel_arg_counts[i]] = kernel_names[i];
+          }
+          startup_profile_.kernel_time_ns = ToNanoSeconds(clock::now() - tic);
+          FRT_PROBE(device__kernels, device_name.c_str(),
+                    startup_profile_.kernel_time_ns);
+          if (!shell_id.empty() && !startup_profile_.is_context_reused) {
+            AddShellContext(device, shell_id, context_);
           }
+          startup_profile_.is_partial = !shell_id.empty();
           return;
         }
       }
@@ -206,6 +592,35 @@ void OpenclDevice::Initialize(const cl::Program::Binaries& binaries,
   throw std::runtime_error("target platform '" + vendor_name + "' not found");
 }
 
+std::vector<cl_context_properties>
+OpenclDevice::GetPreloadedContextProperties() const {
+  return {};
+}
+
+void OpenclDevice::ReleaseClObjects() {
+  // Deferred commands must not wait for a gate that is never released.
+  if (submit_gate_() != nullptr) {
+    submit_gate_.setStatus(CL_COMPLETE);
+    submit_gate_ = cl::UserEvent();
+  }
+  // Loads are released first, since stores may wait for them via kernels.
+  load_pacer_.reset();
+  store_pacer_.reset();
+  DependencyTracker::GetHostTracker().RemoveContext(context_);
+  buffer_tracker_.RemoveContext(context_);
+  pending_completions_.clear();
+  pending_decompressions_.clear();
+  graph_.clear();
+  load_event_.clear();
+  compute_event_.clear();
+  store_event_.clear();
+  buffer_table_.clear();
+  kernels_.clear();
+  program_ = cl::Program();
+  cmd_ = cl::CommandQueue();
+  context_ = cl::Context();
+}
+
 cl::Buffer OpenclDevice::CreateBuffer(int index, cl_mem_flags flags,
                                       void* host_ptr, size_t size) {
   cl_int err;
@@ -215,6 +630,24 @@ cl::Buffer OpenclDevice::CreateBuffer(int index, cl_mem_flags flags,
   return buffer;
 }
 
+bool OpenclDevice::IsInHostMemory(int index) const { return false; }
+
+size_t OpenclDevice::GetTransferChunkSize(bool is_store) const {
+  const double bytes_per_second = is_store
+                                      ? bandwidth_limit_.store_bytes_per_second
+                                      : bandwidth_limit_.load_bytes_per_second;
+  return bytes_per_second > 0 ? bandwidth_limit_.chunk_bytes : SIZE_MAX;
+}
+
+std::vector<cl::Event> OpenclDevice::Throttle(bool is_store, size_t size,
+                                              std::vector<cl::Event> events) {
+  if (GetTransferChunkSize(is_store) == SIZE_MAX) {
+    return events;
+  }
+  auto& pacer = is_store ? store_pacer_ : load_pacer_;
+  return pacer->Pace(size, std::move(events));
+}
+
 std::vector<cl::Memory> OpenclDevice::GetLoadBuffers() const {
   std::vector<cl::Memory> buffers;
   buffers.reserve(load_indices_.size());
@@ -233,6 +666,365 @@ std::vector<cl::Memory> OpenclDevice::GetStoreBuffers() const {
   return buffers;
 }
 
+OpenclDevice::TransferList OpenclDevice::GetTransferList(
+    const std::unordered_set<int>& indices) const {
+  TransferList transfers;
+  transfers.indices.reserve(indices.size());
+  transfers.buffers.reserve(indices.size());
+  transfers.host_ptrs.reserve(indices.size());
+  transfers.sizes.reserve(indices.size());
+  cl_int err;
+  for (auto index : indices) {
+    const auto& buffer = buffer_table_.at(index);
+    const auto& host_buffer = host_buffer_table_.at(index);
+    if (!host_buffer.chunks.empty()) {
+      transfers.chunked.push_back({index, buffer, host_buffer.chunks});
+      continue;
+    }
+    if (host_buffer.compressor != nullptr) {
+      transfers.compressed.push_back({index, buffer, host_buffer.ptr,
+                                      host_buffer.size,
+                                      host_buffer.compressor});
+      continue;
+    }
+    transfers.indices.push_back(index);
+    transfers.buffers.push_back(buffer);
+    transfers.host_ptrs.push_back(host_buffer.ptr);
+    transfers.sizes.push_back(buffer.getInfo<CL_MEM_SIZE>(&err));
+    CL_CHECK(err);
+  }
+  return transfers;
+}
+
+void OpenclDevice::Load(const TransferList& transfers) {
+  auto& host_tracker = DependencyTracker::GetHostTracker();
+  std::vector<cl::Event> events = GetSubmitGate();
+  // A load reads host memory and writes the device buffer.
+  for (int i = 0; i < transfers.indices.size(); ++i) {
+    PagePreparer::Wait(transfers.host_ptrs[i], transfers.sizes[i]);
+    host_tracker.GetDependencies(context_, transfers.host_ptrs[i],
+                                 transfers.sizes[i], /* is_write = */ false,
+                                 events);
+    buffer_tracker_.GetDependencies(context_, transfers.buffers[i](), 1,
+                                    /* is_write = */ true, events);
+  }
+  EnqueueLoad(transfers, events);
+  for (int i = 0; i < transfers.indices.size(); ++i) {
+    const auto& event = GetTransferEvent(load_event_, i);
+    host_tracker.AddAccess(context_, transfers.host_ptrs[i],
+                           transfers.sizes[i], /* is_write = */ false, event,
+                           events);
+    buffer_tracker_.AddAccess(context_, transfers.buffers[i](), 1,
+                              /* is_write = */ true, event, events);
+    FRT_PROBE(load__enqueue, instrumentation_.GetId(), transfers.indices[i],
+              transfers.sizes[i]);
+    if (IsInstrumented()) {
+      ReportEnqueue(InstrumentationEvent::kLoad, transfers.indices[i],
+                    transfers.sizes[i], event);
+    }
+  }
+  TransferChunks(transfers.chunked, /* is_store = */ false, GetSubmitGate(),
+                 load_event_);
+  LoadCompressed(transfers.compressed, GetSubmitGate());
+  CountDeferredOperation();
+}
+
+void OpenclDevice::EnqueueKernels() {
+  auto& host_tracker = DependencyTracker::GetHostTracker();
+  std::vector<cl::Event> events = GetSubmitGate();
+  events.insert(events.end(), load_event_.begin(), load_event_.end());
+  for (const auto& [index, host_buffer] : host_buffer_table_) {
+    const bool is_write = host_buffer.tag != Tag::kWriteOnly;
+    buffer_tracker_.GetDependencies(context_, buffer_table_.at(index)(), 1,
+                                    is_write, events);
+    if (IsInHostMemory(index)) {
+      host_tracker.GetDependencies(context_, host_buffer.ptr,
+                                   host_buffer.size, is_write, events);
+    }
+  }
+  compute_event_.resize(kernels_.size());
+  int i = 0;
+  auto name = kernel_names_.begin();
+  for (auto& pair : kernels_) {
+    CL_CHECK(cmd_.enqueueNDRangeKernel(pair.second, cl::NullRange,
+                                       cl::NDRange(1), cl::NDRange(1),
+                                       &events, &compute_event_[i]));
+    FRT_PROBE(kernel__launch, instrumentation_.GetId(), name->second.c_str());
+    if (IsInstrumented()) {
+      ReportEnqueue(InstrumentationEvent::kLaunch, /* index = */ -1,
+                    /* bytes = */ 0, compute_event_[i], name->second);
+    }
+    ++i;
+    ++name;
+  }
+  for (const auto& [index, host_buffer] : host_buffer_table_) {
+    const int kernel = std::distance(kernels_.begin(),
+                                     std::prev(kernels_.upper_bound(index)));
+    const bool is_write = host_buffer.tag != Tag::kWriteOnly;
+    buffer_tracker_.AddAccess(context_, buffer_table_.at(index)(), 1,
+                              is_write, compute_event_[kernel], events);
+    // Kernels access host memory directly; later transfers and kernels of
+    // other instances must wait for them as for loads and stores.
+    if (IsInHostMemory(index)) {
+      host_tracker.AddAccess(context_, host_buffer.ptr, host_buffer.size,
+                             is_write, compute_event_[kernel], events);
+    }
+  }
+  CountDeferredOperation();
+}
+
+void OpenclDevice::Store(const TransferList& transfers) {
+  auto& host_tracker = DependencyTracker::GetHostTracker();
+  std::vector<cl::Event> events = GetSubmitGate();
+  events.insert(events.end(), compute_event_.begin(), compute_event_.end());
+  // A store reads the device buffer and writes host memory.
+  for (int i = 0; i < transfers.indices.size(); ++i) {
+    PagePreparer::Wait(transfers.host_ptrs[i], transfers.sizes[i]);
+    host_tracker.GetDependencies(context_, transfers.host_ptrs[i],
+                                 transfers.sizes[i], /* is_write = */ true,
+                                 events);
+    buffer_tracker_.GetDependencies(context_, transfers.buffers[i](), 1,
+                                    /* is_write = */ false, events);
+  }
+  EnqueueStore(transfers, events);
+  for (int i = 0; i < transfers.indices.size(); ++i) {
+    const auto& event = GetTransferEvent(store_event_, i);
+    host_tracker.AddAccess(context_, transfers.host_ptrs[i],
+                           transfers.sizes[i], /* is_write = */ true, event,
+                           events);
+    buffer_tracker_.AddAccess(context_, transfers.buffers[i](), 1,
+                              /* is_write = */ false, event, events);
+    FRT_PROBE(store__enqueue, instrumentation_.GetId(), transfers.indices[i],
+              transfers.sizes[i]);
+    if (IsInstrumented()) {
+      ReportEnqueue(InstrumentationEvent::kStore, transfers.indices[i],
+                    transfers.sizes[i], event);
+    }
+  }
+  std::vector<cl::Event> chunk_events = GetSubmitGate();
+  chunk_events.insert(chunk_events.end(), compute_event_.begin(),
+                      compute_event_.end());
+  TransferChunks(transfers.chunked, /* is_store = */ true,
+                 std::move(chunk_events), store_event_);
+  pending_decompressions_.insert(pending_decompressions_.end(),
+                                 transfers.compressed.begin(),
+                                 transfers.compressed.end());
+  CountDeferredOperation();
+}
+
+std::vector<cl::Event> OpenclDevice::GetSubmitGate() {
+  if (max_deferred_operations_ == 0) {
+    return {};
+  }
+  if (submit_gate_() == nullptr) {
+    cl_int err;
+    submit_gate_ = cl::UserEvent(context_, &err);
+    CL_CHECK(err);
+  }
+  return {submit_gate_};
+}
+
+void OpenclDevice::CountDeferredOperation() {
+  if (submit_gate_() != nullptr &&
+      ++deferred_operations_ >= max_deferred_operations_) {
+    Flush();
+  }
+}
+
+void OpenclDevice::FinishCommands() {
+  Flush();
+  const cl_int err = cmd_.finish();
+  has_failed_ = has_failed_ || err != CL_SUCCESS;
+  CL_CHECK(err);
+  DecompressStores();
+  ReportCompletions();
+}
+
+void OpenclDevice::TransferChunks(
+    const std::vector<ChunkedTransfer>& transfers, bool is_store,
+    std::vector<cl::Event> events, std::vector<cl::Event>& transfer_events) {
+  auto& host_tracker = DependencyTracker::GetHostTracker();
+  for (const auto& transfer : transfers) {
+    for (const auto& chunk : transfer.chunks) {
+      PagePreparer::Wait(chunk.Get(), chunk.SizeInBytes());
+      host_tracker.GetDependencies(context_, chunk.Get(), chunk.SizeInBytes(),
+                                   is_store, events);
+    }
+    buffer_tracker_.GetDependencies(context_, transfer.buffer(), 1, !is_store,
+                                    events);
+  }
+  // Chunks of one buffer are written to disjoint offsets and do not depend on
+  // each other.
+  for (const auto& transfer : transfers) {
+    size_t offset = 0;
+    for (const auto& chunk : transfer.chunks) {
+      if (chunk.SizeInBytes() == 0) {
+        continue;
+      }
+      const auto wait_events = Throttle(is_store, chunk.SizeInBytes(), events);
+      cl::Event event;
+      if (is_store) {
+        CL_CHECK(cmd_.enqueueReadBuffer(transfer.buffer,
+                                        /* blocking = */ CL_FALSE, offset,
+                                        chunk.SizeInBytes(), chunk.Get(),
+                                        &wait_events, &event));
+      } else {
+        CL_CHECK(cmd_.enqueueWriteBuffer(transfer.buffer,
+                                         /* blocking = */ CL_FALSE, offset,
+                                         chunk.SizeInBytes(), chunk.Get(),
+                                         &wait_events, &event));
+      }
+      host_tracker.AddAccess(context_, chunk.Get(), chunk.SizeInBytes(),
+                             is_store, event, wait_events);
+      buffer_tracker_.AddAccess(context_, transfer.buffer(), 1, !is_store,
+                                event, wait_events);
+      if (IsInstrumented()) {
+        ReportEnqueue(is_store ? InstrumentationEvent::kStore
+                               : InstrumentationEvent::kLoad,
+                      transfer.index, chunk.SizeInBytes(), event);
+      }
+      transfer_events.push_back(event);
+      offset += chunk.SizeInBytes();
+    }
+  }
+}
+
+void OpenclDevice::LoadCompressed(
+    const std::vector<CompressedTransfer>& transfers,
+    std::vector<cl::Event> events) {
+  auto& host_tracker = DependencyTracker::GetHostTracker();
+  for (const auto& transfer : transfers) {
+    auto& compressor = *transfer.compressor;
+    char* staging = compressor.GetStaging();
+    // Compression reads the host memory and overwrites the staging buffer on
+    // this thread, so it waits for in-flight commands writing the former or
+    // reading the latter.
+    PagePreparer::Wait(transfer.host_ptr, transfer.size);
+    std::vector<cl::Event> host_events;
+    host_tracker.GetDependencies(context_, transfer.host_ptr, transfer.size,
+                                 /* is_write = */ false, host_events);
+    host_tracker.GetDependencies(context_, staging, compressor.GetCapacity(),
+                                 /* is_write = */ true, host_events);
+    if (!host_events.empty()) {
+      // Deferred commands would never finish without a flush.
+      if (submit_gate_() != nullptr) {
+        Flush();
+      }
+      CL_CHECK(cl::Event::waitForEvents(host_events));
+    }
+    buffer_tracker_.GetDependencies(context_, transfer.buffer(), 1,
+                                    /* is_write = */ true, events);
+
+    // Blocks are written at their offsets in the device buffer, and do not
+    // depend on each other.
+    const auto tic = clock::now();
+    const size_t compressed_bytes = compressor.Compress(
+        transfer.host_ptr, staging, [&](size_t offset, size_t size) {
+          const auto wait_events =
+              Throttle(/* is_store = */ false, size, events);
+          cl::Event event;
+          CL_CHECK(cmd_.enqueueWriteBuffer(transfer.buffer,
+                                           /* blocking = */ CL_FALSE, offset,
+                                           size, staging + offset,
+                                           &wait_events, &event));
+          host_tracker.AddAccess(context_, staging + offset, size,
+                                 /* is_write = */ false, event, wait_events);
+          buffer_tracker_.AddAccess(context_, transfer.buffer(), 1,
+                                    /* is_write = */ true, event,
+                                    wait_events);
+          if (IsInstrumented()) {
+            ReportEnqueue(InstrumentationEvent::kLoad, transfer.index, size,
+                          event);
+          }
+          load_event_.push_back(event);
+        });
+    compression_stats_.compress_time_ns += ToNanoSeconds(clock::now() - tic);
+    compression_stats_.load_raw_bytes += transfer.size;
+    compression_stats_.load_compressed_bytes += compressed_bytes;
+  }
+}
+
+void OpenclDevice::DecompressStores() {
+  const auto transfers = std::move(pending_decompressions_);
+  pending_decompressions_.clear();
+  for (const auto& transfer : transfers) {
+    auto& compressor = *transfer.compressor;
+    char* staging = compressor.GetStaging();
+    // The index table tells which bytes of each block the kernels wrote, so
+    // only those are read.
+    cl::Event event;
+    CL_CHECK(cmd_.enqueueReadBuffer(transfer.buffer, /* blocking = */ CL_FALSE,
+                                    /* offset = */ 0,
+                                    compressor.GetIndexBytes(), staging,
+                                    nullptr, &event));
+    if (IsInstrumented()) {
+      ReportEnqueue(InstrumentationEvent::kStore, transfer.index,
+                    compressor.GetIndexBytes(), event);
+    }
+    CL_CHECK(event.wait());
+    store_event_.push_back(event);
+    const auto index = compressor.ReadIndex(staging);
+    std::vector<cl::Event> events(index.size());
+    for (size_t i = 0; i < index.size(); ++i) {
+      const auto& block = index[i];
+      const auto wait_events =
+          Throttle(/* is_store = */ true, block.compressed_bytes, {});
+      CL_CHECK(cmd_.enqueueReadBuffer(transfer.buffer,
+                                      /* blocking = */ CL_FALSE, block.offset,
+                                      block.compressed_bytes,
+                                      staging + block.offset, &wait_events,
+                                      &events[i]));
+      if (IsInstrumented()) {
+        ReportEnqueue(InstrumentationEvent::kStore, transfer.index,
+                      block.compressed_bytes, events[i]);
+      }
+      store_event_.push_back(events[i]);
+    }
+    CL_CHECK(cmd_.flush());
+
+    // Each block is decompressed as soon as it arrives.
+    const auto tic = clock::now();
+    const size_t compressed_bytes = compressor.Decompress(
+        staging, transfer.host_ptr,
+        [&events](size_t i) { CL_CHECK(events[i].wait()); });
+    compression_stats_.decompress_time_ns += ToNanoSeconds(clock::now() - tic);
+    compression_stats_.store_raw_bytes += transfer.size;
+    compression_stats_.store_compressed_bytes += compressed_bytes;
+  }
+}
+
+void OpenclDevice::ReportEnqueue(InstrumentationEvent::Command command,
+                                 int index, size_t bytes,
+                                 const cl::Event& event, std::string name) {
+  if (index >= 0) {
+    auto it = arg_table_.find(index);
+    if (it != arg_table_.end()) {
+      name = it->second.name;
+    }
+  }
+  instrumentation_.Enqueue(command, index, name, bytes);
+  pending_completions_.push_back(
+      {command, index, std::move(name), bytes, event});
+}
+
+void OpenclDevice::ReportCompletions() {
+  const auto completions = std::move(pending_completions_);
+  pending_completions_.clear();
+  if (!completions.empty()) {
+    clock_sync_.Refresh(context_, cmd_);
+  }
+  for (const auto& completion : completions) {
+    const auto& event = completion.event;
+    instrumentation_.Complete(
+        completion.command, completion.index, completion.name,
+        completion.bytes,
+        clock_sync_.ToHostTime(GetTime<CL_PROFILING_COMMAND_QUEUED>(event)),
+        clock_sync_.ToHostTime(GetTime<CL_PROFILING_COMMAND_START>(event)),
+        clock_sync_.ToHostTime(GetTime<CL_PROFILING_COMMAND_END>(event)));
+  }
+  instrumentation_.EndInvocation();
+}
+
 std::pair<int, cl::Kernel> OpenclDevice::GetKernel(int index) const {
   auto it = std::prev(kernels_.upper_bound(index));
   return {index - it->first, it->second};
@@ -5,6 +5,8 @@
 #include <cstdint>
 
 #include <map>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -13,55 +15,253 @@
 #include <CL/cl2.hpp>
 
 #include "frt/arg_info.h"
+#include "frt/bandwidth_limit.h"
+#include "frt/clock_sync.h"
+#include "frt/compression.h"
+#include "frt/dependency_tracker.h"
 #include "frt/device.h"
+#include "frt/instrumentation.h"
+#include "frt/startup_profile.h"
 #include "frt/stream_wrapper.h"
 #include "frt/tag.h"
+#include "frt/timeline.h"
+#include "frt/transfer_pacer.h"
 
 namespace fpga {
 namespace internal {
 
 class OpenclDevice : public Device {
  public:
+  ~OpenclDevice() override;
+
   void SetScalarArg(int index, const void* arg, int size) override;
   void SetBufferArg(int index, Tag tag, const BufferArg& arg) override;
+  void SetChunkedBufferArg(int index, Tag tag,
+                           const std::vector<BufferArg>& chunks) override;
+  void SetCompressedBufferArg(int index, Tag tag, const BufferArg& arg,
+                              const CompressionOptions& options) override;
   size_t SuspendBuffer(int index) override;
+  void SetBufferBank(int index, int bank) override;
+  void SetBandwidthLimit(const BandwidthLimit& limit) override;
+  void SetDeferredSubmission(size_t max_operations) override;
 
+  void WriteToDevice() override;
+  void ReadFromDevice() override;
   void Exec() override;
+  void Flush() override;
   void Finish() override;
 
+  void BeginCapture() override;
+  void EndCapture() override;
+  void Replay() override;
+
   std::vector<ArgInfo> GetArgsInfo() const override;
+  StartupProfile GetStartupProfile() const override;
+  ThrottleStats GetThrottleStats() const override;
+  CompressionStats GetCompressionStats() const override;
+  Timeline GetTimeline() const override;
+  int64_t QueueTimeNanoSeconds() const override;
   int64_t LoadTimeNanoSeconds() const override;
   int64_t ComputeTimeNanoSeconds() const override;
   int64_t StoreTimeNanoSeconds() const override;
   size_t LoadBytes() const override;
   size_t StoreBytes() const override;
 
+  std::string GetPlatformName() const override;
+  std::string GetDeviceName() const override;
+  int64_t ProbeTransferNanoSeconds(size_t size, bool is_store) override;
+  uint64_t GetInstrumentationId() const override;
+
  protected:
+  // A device buffer gathered from, or scattered to, chunks of host memory.
+  struct ChunkedTransfer {
+    int index;
+    cl::Buffer buffer;
+    std::vector<BufferArg> chunks;
+  };
+
+  // A device buffer in the block format of `compressor`, whose content is
+  // the `size` bytes of host memory at `host_ptr`.
+  struct CompressedTransfer {
+    int index;
+    cl::Buffer buffer;
+    void* host_ptr;
+    size_t size;
+    std::shared_ptr<BlockCompressor> compressor;
+  };
+
+  // Buffers moved by one load or store, precomputed so that replaying a
+  // captured graph does not look them up again. Chunked and compressed
+  // buffers are not in `indices` and are moved by `OpenclDevice` itself.
+  struct TransferList {
+    std::vector<int> indices;
+    std::vector<cl::Memory> buffers;
+    std::vector<void*> host_ptrs;
+    std::vector<size_t> sizes;
+    std::vector<ChunkedTransfer> chunked;
+    std::vector<CompressedTransfer> compressed;
+  };
+
+  // Host memory of a buffer argument. `ptr` is null if the buffer is made of
+  // `chunks`. `compressor` is null unless the buffer is compressed.
+  struct HostBuffer {
+    void* ptr;
+    size_t size;
+    Tag tag;
+    std::vector<BufferArg> chunks;
+    std::shared_ptr<BlockCompressor> compressor;
+  };
+
+  // If `shell_id` is not empty, `binaries` is a partial bitstream for that
+  // shell and the context of an earlier instance with the same shell is
+  // reused, so that only the PR region is reconfigured.
   void Initialize(const cl::Program::Binaries& binaries,
                   const std::string& vendor_name,
                   const std::string& target_device_nam,
                   const std::vector<std::string>& kernel_names,
-                  const std::vector<int>& kernel_arg_countse);
+                  const std::vector<int>& kernel_arg_countse,
+                  const std::string& shell_id = "");
+  // Returns the properties of a context in which programs are created from
+  // the bitstream already on the device without reconfiguring it, or an empty
+  // vector if the vendor runtime does not support that.
+  virtual std::vector<cl_context_properties> GetPreloadedContextProperties()
+      const;
+  // Releases the OpenCL objects held by this device, after completing the
+  // submission gate so that no deferred command waits forever. The vendor
+  // runtime is done with the context afterwards unless another device shares
+  // it. The device must not be used again.
+  void ReleaseClObjects();
   virtual cl::Buffer CreateBuffer(int index, cl_mem_flags flags, void* host_ptr,
                                   size_t size);
+  // Returns whether kernels access the host memory of buffer `index`
+  // directly, without loads and stores.
+  virtual bool IsInHostMemory(int index) const;
+  // Enqueues the load of `transfers` after `events` and sets `load_event_`.
+  virtual void EnqueueLoad(const TransferList& transfers,
+                           const std::vector<cl::Event>& events) = 0;
+  // Enqueues the store of `transfers` after `events` and sets `store_event_`.
+  // `events` include `compute_event_`.
+  virtual void EnqueueStore(const TransferList& transfers,
+                            const std::vector<cl::Event>& events) = 0;
+
+  // Returns the largest size of one transfer command in the direction of
+  // `is_store`, or `SIZE_MAX` if transfers are not throttled.
+  size_t GetTransferChunkSize(bool is_store) const;
+  // Returns the wait list of a command moving `size` bytes in the direction of
+  // `is_store` after `events`. If transfers are throttled, it includes an
+  // event that holds the command until the bandwidth limit allows it.
+  std::vector<cl::Event> Throttle(bool is_store, size_t size,
+                                  std::vector<cl::Event> events);
 
   std::vector<cl::Memory> GetLoadBuffers() const;
   std::vector<cl::Memory> GetStoreBuffers() const;
   std::pair<int, cl::Kernel> GetKernel(int index) const;
+  TransferList GetTransferList(const std::unordered_set<int>& indices) const;
 
+  std::string platform_name_;
+  std::string device_name_;
   cl::Device device_;
   cl::Context context_;
   cl::CommandQueue cmd_;
   cl::Program program_;
   // Maps prefix sum of arg count to kernels.
   std::map<int, cl::Kernel> kernels_;
+  // Names of `kernels_`, with the same keys.
+  std::map<int, std::string> kernel_names_;
   std::unordered_map<int, cl::Buffer> buffer_table_;
+  std::unordered_map<int, HostBuffer> host_buffer_table_;
   std::unordered_map<int, ArgInfo> arg_table_;
   std::unordered_set<int> load_indices_;
   std::unordered_set<int> store_indices_;
   std::vector<cl::Event> load_event_;
   std::vector<cl::Event> compute_event_;
   std::vector<cl::Event> store_event_;
+  StartupProfile startup_profile_;
+  BandwidthLimit bandwidth_limit_;
+  // Created once the direction is throttled, and kept until released.
+  std::unique_ptr<TransferPacer> load_pacer_;
+  std::unique_ptr<TransferPacer> store_pacer_;
+  // Whether commands have failed, e.g., so that logs of the vendor runtime
+  // are kept for inspection.
+  bool has_failed_ = false;
+
+ private:
+  // An operation in a captured graph.
+  struct Operation {
+    enum Kind {
+      kLoad,
+      kExec,
+      kStore,
+      kFlush,
+      kFinish,
+    };
+    Kind kind;
+    TransferList transfers;
+  };
+
+  // A command reported to instrumentation observers when it completes.
+  struct PendingCompletion {
+    InstrumentationEvent::Command command;
+    int index;
+    std::string name;
+    size_t bytes;
+    cl::Event event;
+  };
+
+  void SetHostBuffer(int index, const HostBuffer& host_buffer);
+
+  // Enqueue commands after the in-flight commands accessing the same host
+  // memory or device buffers, and record their own accesses.
+  void Load(const TransferList& transfers);
+  void EnqueueKernels();
+  void Store(const TransferList& transfers);
+  // Returns the events that commands wait for before they are submitted,
+  // i.e., the submission gate if submission is deferred.
+  std::vector<cl::Event> GetSubmitGate();
+  // Counts an operation enqueued after the submission gate, and flushes if
+  // the batch is full.
+  void CountDeferredOperation();
+  // Submits and waits for all commands, recording whether any failed, then
+  // completes compressed stores and reports the invocation.
+  void FinishCommands();
+  // Enqueues a write or read per chunk at its offset in the device buffer
+  // after `events`, and appends their events to `transfer_events`.
+  void TransferChunks(const std::vector<ChunkedTransfer>& transfers,
+                      bool is_store, std::vector<cl::Event> events,
+                      std::vector<cl::Event>& transfer_events);
+  // Compresses `transfers` and enqueues a write per block after `events` as
+  // soon as it is compressed, and appends their events to `load_event_`.
+  void LoadCompressed(const std::vector<CompressedTransfer>& transfers,
+                      std::vector<cl::Event> events);
+  // Reads back and decompresses the compressed buffers of stores since the
+  // last call, which must be after the kernels finish.
+  void DecompressStores();
+  // Reports the enqueue of the command of `event` to instrumentation
+  // observers, and its completion when `Finish` returns. Commands that move
+  // buffers are named after argument `index`.
+  void ReportEnqueue(InstrumentationEvent::Command command, int index,
+                     size_t bytes, const cl::Event& event,
+                     std::string name = "");
+  // Reports the completions since the last call and ends the invocation.
+  void ReportCompletions();
+
+  bool is_capturing_ = false;
+  std::vector<Operation> graph_;
+  // Accesses to device buffers, keyed by `cl_mem`.
+  DependencyTracker buffer_tracker_;
+  // Refreshed when profiling data is converted to host time.
+  mutable ClockSync clock_sync_;
+  // Deferred commands wait for `submit_gate_`, a user event that `Flush`
+  // completes, so that the driver submits them together.
+  size_t max_deferred_operations_ = 0;
+  size_t deferred_operations_ = 0;
+  cl::UserEvent submit_gate_;
+  // Compressed buffers are decompressed when the commands finish, since the
+  // sizes of their blocks are only known then.
+  std::vector<CompressedTransfer> pending_decompressions_;
+  CompressionStats compression_stats_;
+  Instrumentation instrumentation_;
+  std::vector<PendingCompletion> pending_completions_;
 };
 
 }  // namespace internal
@@ -0,0 +1,149 @@
+#include "frt/page_preparer.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+namespace fpga {
+namespace internal {
+
+namespace {
+
+// Ranges are split into chunks of this size to spread them over threads.
+constexpr size_t kChunkSize = 16 << 20;
+constexpr int kMaxThreadCount = 8;
+
+size_t GetPageSize() {
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  return page_size;
+}
+
+void Prefault(uintptr_t begin, uintptr_t end, bool is_output) {
+#if defined(MADV_POPULATE_READ) && defined(MADV_POPULATE_WRITE)
+  if (madvise(reinterpret_cast<void*>(begin), end - begin,
+              is_output ? MADV_POPULATE_WRITE : MADV_POPULATE_READ) == 0) {
+    return;
+  }
+#endif  // MADV_POPULATE_READ && MADV_POPULATE_WRITE
+  // Older kernels fault the pages in by touching them without changing their
+  // content. Writing would fail on read-only memory, so only outputs are
+  // written.
+  for (uintptr_t page = begin; page < end; page += GetPageSize()) {
+    if (is_output) {
+      __atomic_fetch_add(reinterpret_cast<char*>(page), 0, __ATOMIC_RELAXED);
+    } else {
+      *reinterpret_cast<volatile const char*>(page);
+    }
+  }
+}
+
+void Pin(uintptr_t begin, uintptr_t end) {
+  if (mlock(reinterpret_cast<void*>(begin), end - begin) != 0) {
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+      PLOG(WARNING) << "cannot pin host memory; check `ulimit -l`";
+    });
+  }
+}
+
+}  // namespace
+
+std::atomic<bool> PagePreparer::is_created_{false};
+
+PagePreparer& PagePreparer::Get() {
+  // Never destroyed; helper threads may be running at exit.
+  static auto* preparer = [] {
+    auto* preparer = new PagePreparer(std::max(
+        1,
+        std::min<int>(std::thread::hardware_concurrency(), kMaxThreadCount)));
+    is_created_.store(true, std::memory_order_release);
+    return preparer;
+  }();
+  return *preparer;
+}
+
+void PagePreparer::Prepare(const void* ptr, size_t size, bool is_output,
+                           bool pin) {
+  if (size == 0) {
+    return;
+  }
+  const uintptr_t page_mask = ~(GetPageSize() - 1);
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & page_mask;
+  const uintptr_t end =
+      (reinterpret_cast<uintptr_t>(ptr) + size + GetPageSize() - 1) &
+      page_mask;
+  Get().Enqueue(begin, end, is_output, pin);
+}
+
+void PagePreparer::Wait(const void* ptr, size_t size) {
+  if (!is_created_.load(std::memory_order_acquire)) {
+    return;
+  }
+  const auto begin = reinterpret_cast<uintptr_t>(ptr);
+  Get().WaitFor(begin, begin + size);
+}
+
+PagePreparer::PagePreparer(int thread_count) {
+  for (int i = 0; i < thread_count; ++i) {
+    threads_.emplace_back(&PagePreparer::Run, this);
+    threads_.back().detach();
+  }
+}
+
+void PagePreparer::Enqueue(uintptr_t begin, uintptr_t end, bool is_output,
+                           bool pin) {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto range = ranges_.insert(ranges_.end(), {begin, end, 0});
+    for (uintptr_t chunk = begin; chunk < end; chunk += kChunkSize) {
+      chunks_.push_back(
+          {chunk, std::min(chunk + kChunkSize, end), is_output, pin, range});
+      ++range->pending_chunks;
+    }
+  }
+  chunk_cv_.notify_all();
+}
+
+void PagePreparer::WaitFor(uintptr_t begin, uintptr_t end) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  done_cv_.wait(lock, [&] {
+    for (const auto& range : ranges_) {
+      if (range.begin < end && begin < range.end) {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+
+void PagePreparer::Run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (;;) {
+    chunk_cv_.wait(lock, [this] { return !chunks_.empty(); });
+    const Chunk chunk = chunks_.front();
+    chunks_.pop_front();
+    lock.unlock();
+    Prefault(chunk.begin, chunk.end, chunk.is_output);
+    if (chunk.pin) {
+      Pin(chunk.begin, chunk.end);
+    }
+    lock.lock();
+    if (--chunk.range->pending_chunks == 0) {
+      ranges_.erase(chunk.range);
+      done_cv_.notify_all();
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,76 @@
+#ifndef FPGA_RUNTIME_PAGE_PREPARER_H_
+#define FPGA_RUNTIME_PAGE_PREPARER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fpga {
+namespace internal {
+
+// Prefaults and pins host memory on helper threads, so that the first
+// transfer of a newly allocated buffer does not stall on page faults in the
+// driver. The helper threads are started by the first `Prepare`.
+//
+// Memory the device only reads is faulted in by reading it, which works on
+// read-only mappings and keeps file-backed pages clean. Memory the device
+// writes is faulted in writable with atomic no-ops, which keeps its content
+// even if the application writes it concurrently.
+//
+// Pinning is best-effort and is never undone by the preparer: pinned pages
+// stay locked until the memory is unmapped or the process exits.
+class PagePreparer {
+ public:
+  // Starts preparing [`ptr`, `ptr` + `size`) in chunks on the helper threads.
+  // `is_output` tells whether the device writes the memory.
+  static void Prepare(const void* ptr, size_t size, bool is_output, bool pin);
+
+  // Waits for the preparation of ranges overlapping [`ptr`, `ptr` + `size`).
+  // Returns immediately if nothing has ever been prepared.
+  static void Wait(const void* ptr, size_t size);
+
+ private:
+  struct Range {
+    uintptr_t begin;
+    uintptr_t end;
+    size_t pending_chunks;
+  };
+  struct Chunk {
+    uintptr_t begin;
+    uintptr_t end;
+    bool is_output;
+    bool pin;
+    std::list<Range>::iterator range;
+  };
+
+  // Returns the preparer shared by the process, creating it if necessary.
+  static PagePreparer& Get();
+
+  explicit PagePreparer(int thread_count);
+  void Enqueue(uintptr_t begin, uintptr_t end, bool is_output, bool pin);
+  void WaitFor(uintptr_t begin, uintptr_t end);
+  void Run();
+
+  // Set once `Get` has created the preparer.
+  static std::atomic<bool> is_created_;
+
+  std::mutex mtx_;
+  std::condition_variable chunk_cv_;
+  std::condition_variable done_cv_;
+  std::deque<Chunk> chunks_;
+  std::list<Range> ranges_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_PAGE_PREPARER_H_
@@ -0,0 +1,51 @@
+#ifndef FPGA_RUNTIME_PROBES_H_
+#define FPGA_RUNTIME_PROBES_H_
+
+// USDT probes of provider `frt` for tracers such as bpftrace and perf, e.g.,
+// `bpftrace -l 'usdt:/usr/lib/libfrt.so:frt:*'`. See `tools/bpftrace` for
+// examples. A probe that is not attached is a single `nop`; its arguments are
+// passed as operands without being copied, so they must be values at hand.
+// `id` is the instrumentation id of the instance. Probes and their arguments:
+//
+//   instance__load__begin    bitstream path
+//   instance__load__read     bitstream path, bytes read
+//   instance__load__end      id, device name
+//   device__context          device name, ns, whether the context is reused
+//   device__program          device name, ns, whether the program is preloaded
+//   device__kernels          device name, ns
+//   set__buffer__arg         id, index, host pointer, bytes, tag
+//   buffer__reuse            id, index, bytes; the device buffer is reused
+//   buffer__create           id, index, bytes; a device buffer is created
+//   result__cache__lookup    id, whether the result cache hits
+//   write__begin, write__end id; `WriteToDevice`
+//   exec__begin, exec__end   id; `Exec`
+//   read__begin, read__end   id; `ReadFromDevice`
+//   finish__begin, finish__end
+//                            id; `Finish`
+//   replay__begin, replay__end
+//                            id; `Replay`
+//   load__enqueue            id, index, bytes
+//   kernel__launch           id, kernel name
+//   store__enqueue           id, index, bytes
+//   stream__read__begin      stream name, host pointer, bytes, end of transfer
+//   stream__read__end        stream name, bytes
+//   stream__write__begin     stream name, host pointer, bytes, end of transfer
+//   stream__write__end       stream name, bytes
+//
+// Probes of device phases, buffers, and enqueues are only fired by OpenCL
+// devices. Probes are compiled in if <sys/sdt.h> (systemtap-sdt-dev or
+// systemtap-sdt-devel) is available, unless `FRT_DISABLE_USDT` is defined.
+#if !defined(FRT_DISABLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define FRT_HAS_USDT 1
+#endif  // __has_include(<sys/sdt.h>)
+#endif  // !defined(FRT_DISABLE_USDT) && defined(__has_include)
+
+#ifdef FRT_HAS_USDT
+#define FRT_PROBE(name, ...) STAP_PROBEV(frt, name, ##__VA_ARGS__)
+#else  // FRT_HAS_USDT
+#define FRT_PROBE(name, ...) static_cast<void>(0)
+#endif  // FRT_HAS_USDT
+
+#endif  // FPGA_RUNTIME_PROBES_H_
@@ -0,0 +1,241 @@
+#ifndef FPGA_RUNTIME_RECORD_STREAM_H_
+#define FPGA_RUNTIME_RECORD_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "frt/stream.h"
+#include "frt/tag.h"
+
+namespace fpga {
+namespace internal {
+
+// Variable-length records framed over a stream.
+//
+// The stream is a sequence of chunks of `chunk_size` bytes; both ends must
+// agree on the chunk size, which must be a multiple of 4. Within the chunks,
+// each record is a 32-bit little-endian length followed by the payload,
+// padded to 4 bytes. Records may span chunks. A length of `kRecordPadding`
+// is a 4-byte filler and `kRecordEnd` marks the end of the stream; the rest of
+// the last chunk is filler.
+constexpr uint32_t kRecordPadding = 0xffffffff;
+constexpr uint32_t kRecordEnd = 0xfffffffe;
+constexpr uint32_t kMaxRecordSize = 0xfffffffc;
+constexpr size_t kDefaultRecordChunkSize = 1 << 16;
+
+// Writes records to a stream in chunks. Payloads that cover whole chunks are
+// written from user memory without copying. `Close` must be called after the
+// last record.
+class RecordWriter {
+ public:
+  RecordWriter(Stream<Tag::kWriteOnly>& stream,
+               size_t chunk_size = kDefaultRecordChunkSize)
+      : stream_(stream), chunk_size_(chunk_size) {
+    if (chunk_size_ == 0 || chunk_size_ % 4 != 0) {
+      throw std::invalid_argument("chunk size must be a multiple of 4");
+    }
+    chunk_.reserve(chunk_size_);
+  }
+  RecordWriter(const RecordWriter&) = delete;
+  RecordWriter& operator=(const RecordWriter&) = delete;
+
+  // Writes a record of `size` bytes.
+  void Write(const void* data, size_t size) {
+    if (is_closed_) {
+      throw std::runtime_error("cannot write to closed record stream");
+    }
+    if (size > kMaxRecordSize) {
+      throw std::invalid_argument("record too large");
+    }
+    const uint32_t length = size;
+    Append(&length, sizeof(length));
+    auto ptr = static_cast<const char*>(data);
+    // Fill the current chunk, then write whole chunks directly.
+    if (chunk_.size() + size >= chunk_size_) {
+      const size_t head = chunk_.empty() ? 0 : chunk_size_ - chunk_.size();
+      Append(ptr, head);
+      ptr += head;
+      size -= head;
+      const size_t body = size / chunk_size_ * chunk_size_;
+      if (body > 0) {
+        stream_.Write(ptr, body, /* eot = */ false);
+        ptr += body;
+        size -= body;
+      }
+    }
+    Append(ptr, size);
+    static constexpr char kZeros[4] = {};
+    Append(kZeros, (4 - length % 4) % 4);
+  }
+
+  // Writes a record of `count` elements of type `T`.
+  template <typename T>
+  void Write(const T* data, size_t count) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "records must be trivially copyable");
+    Write(static_cast<const void*>(data), count * sizeof(T));
+  }
+
+  void Write(std::string_view record) { Write(record.data(), record.size()); }
+
+  // Writes the pending records, padding the current chunk.
+  void Flush() {
+    if (!chunk_.empty()) {
+      Pad();
+    }
+  }
+
+  // Writes the end marker and flushes with end of transfer. No record can be
+  // written afterwards.
+  void Close() {
+    if (is_closed_) {
+      return;
+    }
+    // A full chunk is always written, so there is room for the end marker.
+    AppendWord(kRecordEnd);
+    is_closed_ = true;
+    Pad(/* eot = */ true);
+  }
+
+ private:
+  // Appends to the current chunk, writing it whenever it is full.
+  void Append(const void* data, size_t size) {
+    auto ptr = static_cast<const char*>(data);
+    while (size > 0) {
+      const size_t n = std::min(size, chunk_size_ - chunk_.size());
+      chunk_.insert(chunk_.end(), ptr, ptr + n);
+      ptr += n;
+      size -= n;
+      if (chunk_.size() == chunk_size_) {
+        stream_.Write(chunk_.data(), chunk_.size(), /* eot = */ false);
+        chunk_.clear();
+      }
+    }
+  }
+
+  // Appends a word to the current chunk, which must not be full.
+  void AppendWord(uint32_t word) {
+    auto ptr = reinterpret_cast<const char*>(&word);
+    chunk_.insert(chunk_.end(), ptr, ptr + sizeof(word));
+  }
+
+  // Fills the current chunk with padding and writes it.
+  void Pad(bool eot = false) {
+    while (chunk_.size() < chunk_size_) {
+      AppendWord(kRecordPadding);
+    }
+    stream_.Write(chunk_.data(), chunk_.size(), eot);
+    chunk_.clear();
+  }
+
+  Stream<Tag::kWriteOnly>& stream_;
+  const size_t chunk_size_;
+  std::vector<char> chunk_;
+  bool is_closed_ = false;
+};
+
+// Reads records written by `RecordWriter`. Records within a chunk are returned
+// without copying; records spanning chunks are assembled in a separate
+// buffer. Either way, a record is valid until the next `Read`.
+class RecordReader {
+ public:
+  RecordReader(Stream<Tag::kReadOnly>& stream,
+               size_t chunk_size = kDefaultRecordChunkSize)
+      : stream_(stream), chunk_size_(chunk_size), chunk_(chunk_size) {
+    if (chunk_size_ == 0 || chunk_size_ % 4 != 0) {
+      throw std::invalid_argument("chunk size must be a multiple of 4");
+    }
+    pos_ = chunk_size_;
+  }
+  RecordReader(const RecordReader&) = delete;
+  RecordReader& operator=(const RecordReader&) = delete;
+
+  // Reads the next record into `record`. Returns false at the end of stream.
+  bool Read(std::string_view& record) {
+    if (is_done_) {
+      return false;
+    }
+    uint32_t length;
+    do {
+      Consume(&length, sizeof(length));
+    } while (length == kRecordPadding);
+    if (length == kRecordEnd) {
+      is_done_ = true;
+      return false;
+    }
+    const size_t padded_length = (size_t{length} + 3) / 4 * 4;
+    // Read the payload in place if it fits in the next chunk.
+    if (pos_ == chunk_size_ && padded_length > 0 &&
+        padded_length <= chunk_size_) {
+      ReadChunk();
+    }
+    if (chunk_size_ - pos_ >= padded_length) {
+      record = {chunk_.data() + pos_, length};
+      pos_ += padded_length;
+    } else {
+      record_.resize(padded_length);
+      Consume(record_.data(), padded_length);
+      record = {record_.data(), length};
+    }
+    return true;
+  }
+
+  // Reads the next record of elements of type `T`. Returns false at the end of
+  // stream.
+  template <typename T>
+  bool Read(const T*& data, size_t& count) {
+    static_assert(alignof(T) <= 4, "records are only 4-byte aligned");
+    std::string_view record;
+    if (!Read(record)) {
+      return false;
+    }
+    if (record.size() % sizeof(T) != 0) {
+      throw std::runtime_error("record size is not a multiple of type size");
+    }
+    data = reinterpret_cast<const T*>(record.data());
+    count = record.size() / sizeof(T);
+    return true;
+  }
+
+ private:
+  // Copies `size` bytes from the stream, reading chunks as necessary.
+  void Consume(void* data, size_t size) {
+    auto ptr = static_cast<char*>(data);
+    while (size > 0) {
+      if (pos_ == chunk_size_) {
+        ReadChunk();
+      }
+      const size_t n = std::min(size, chunk_size_ - pos_);
+      memcpy(ptr, chunk_.data() + pos_, n);
+      pos_ += n;
+      ptr += n;
+      size -= n;
+    }
+  }
+
+  void ReadChunk() {
+    stream_.Read(chunk_.data(), chunk_size_, /* eot = */ false);
+    pos_ = 0;
+  }
+
+  Stream<Tag::kReadOnly>& stream_;
+  const size_t chunk_size_;
+  std::vector<char> chunk_;
+  size_t pos_;
+  // Holds records spanning chunks.
+  std::vector<char> record_;
+  bool is_done_ = false;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_RECORD_STREAM_H_
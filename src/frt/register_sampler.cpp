@@ -0,0 +1,93 @@
+#include "frt/register_sampler.h"
+
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace fpga {
+
+std::ostream& operator<<(std::ostream& os, const RegisterSample& sample) {
+  os << "RegisterSample: {name: " << sample.name
+     << ", time: " << sample.time_ns << " ns, value: " << sample.value;
+  os << "}";
+  return os;
+}
+
+namespace internal {
+
+RegisterSampler::RegisterSampler(ReadFunction read,
+                                 std::vector<std::string> names,
+                                 std::chrono::nanoseconds period)
+    : read_(std::move(read)),
+      names_(std::move(names)),
+      period_(period),
+      thread_(&RegisterSampler::Run, this) {}
+
+RegisterSampler::~RegisterSampler() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    is_stopped_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+std::vector<RegisterSample> RegisterSampler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    is_stopped_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  // Counters are final once the kernels have finished.
+  if (!has_failed_) {
+    Sample();
+  }
+  return std::move(samples_);
+}
+
+void RegisterSampler::Run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (!is_stopped_) {
+    lock.unlock();
+    try {
+      Sample();
+    } catch (const std::exception& e) {
+      LOG(WARNING) << "stopped sampling registers: " << e.what();
+      lock.lock();
+      has_failed_ = true;
+      return;
+    }
+    lock.lock();
+    cv_.wait_for(lock, period_, [this] { return is_stopped_; });
+  }
+}
+
+void RegisterSampler::Sample() {
+  std::vector<RegisterSample> samples;
+  for (const auto& name : names_) {
+    RegisterSample sample;
+    sample.name = name;
+    sample.value = read_(name);
+    sample.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+    samples.push_back(std::move(sample));
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  samples_.insert(samples_.end(), samples.begin(), samples.end());
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,66 @@
+#ifndef FPGA_RUNTIME_REGISTER_SAMPLER_H_
+#define FPGA_RUNTIME_REGISTER_SAMPLER_H_
+
+#include <cstdint>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fpga {
+
+// A value read from a kernel register, e.g., a performance counter.
+struct RegisterSample {
+  std::string name;
+  // When the register was read, in nanoseconds of the host's
+  // `std::chrono::steady_clock`, comparable with `Timeline`.
+  int64_t time_ns = 0;
+  uint32_t value = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const RegisterSample& sample);
+
+namespace internal {
+
+// Reads a set of registers periodically on a background thread.
+class RegisterSampler {
+ public:
+  using ReadFunction = std::function<uint32_t(const std::string& name)>;
+
+  // Starts reading `names` with `read` every `period`.
+  RegisterSampler(ReadFunction read, std::vector<std::string> names,
+                  std::chrono::nanoseconds period);
+  ~RegisterSampler();
+
+  RegisterSampler(const RegisterSampler&) = delete;
+  RegisterSampler& operator=(const RegisterSampler&) = delete;
+
+  // Stops sampling, reads each register one last time, and returns all
+  // samples in the order they were read.
+  std::vector<RegisterSample> Stop();
+
+ private:
+  void Run();
+  void Sample();
+
+  const ReadFunction read_;
+  const std::vector<std::string> names_;
+  const std::chrono::nanoseconds period_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool is_stopped_ = false;
+  // Set if a read failed; sampling stops at the first failure.
+  bool has_failed_ = false;
+  std::vector<RegisterSample> samples_;
+  std::thread thread_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_REGISTER_SAMPLER_H_
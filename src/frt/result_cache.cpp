@@ -0,0 +1,199 @@
+#include "frt/result_cache.h"
+
+#include <cstring>
+
+#include <iterator>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "frt/hash.h"
+
+namespace fpga {
+
+double ResultCacheStats::HitRate() const {
+  const int64_t lookups = hits + misses;
+  return lookups == 0 ? 0. : static_cast<double>(hits) / lookups;
+}
+
+std::ostream& operator<<(std::ostream& os, const ResultCacheStats& stats) {
+  os << "ResultCacheStats: {hits: " << stats.hits
+     << ", misses: " << stats.misses << ", hit rate: " << stats.HitRate()
+     << ", evictions: " << stats.evictions << ", size: " << stats.size_bytes
+     << " bytes, saved: " << stats.saved_time_ns << " ns";
+  os << "}";
+  return os;
+}
+
+namespace internal {
+
+namespace {
+
+// Large buffers are sampled in this many blocks of this size.
+constexpr size_t kSampleCount = 32;
+constexpr size_t kSampleSize = 256;
+
+bool IsInput(Tag tag) {
+  return tag == Tag::kWriteOnly || tag == Tag::kReadWrite;
+}
+
+bool IsOutput(Tag tag) {
+  return tag == Tag::kReadOnly || tag == Tag::kReadWrite;
+}
+
+size_t GetSize(const std::vector<BufferArg>& chunks) {
+  size_t size = 0;
+  for (const auto& chunk : chunks) {
+    size += chunk.SizeInBytes();
+  }
+  return size;
+}
+
+}  // namespace
+
+ResultCache::ResultCache(const ResultCacheOptions& options)
+    : options_(options) {}
+
+template <typename Visit>
+void ResultCache::VisitInputs(Visit&& visit) const {
+  for (const auto& pair : args_) {
+    const auto& arg = pair.second;
+    // The signature distinguishes arguments of different kinds and sizes.
+    const uint64_t signature[] = {
+        static_cast<uint64_t>(pair.first),
+        arg.scalar.empty() ? static_cast<uint64_t>(arg.tag) : ~uint64_t{0},
+        arg.scalar.empty() ? GetSize(arg.chunks) : arg.scalar.size(),
+    };
+    visit(signature, sizeof(signature), /* is_buffer = */ false);
+    if (!arg.scalar.empty()) {
+      visit(arg.scalar.data(), arg.scalar.size(), /* is_buffer = */ false);
+    } else if (IsInput(arg.tag)) {
+      for (const auto& chunk : arg.chunks) {
+        visit(chunk.Get(), chunk.SizeInBytes(), /* is_buffer = */ true);
+      }
+    }
+  }
+}
+
+void ResultCache::SetScalarArg(int index, const void* arg, int size) {
+  auto& scalar = args_[index].scalar;
+  auto ptr = static_cast<const char*>(arg);
+  scalar.assign(ptr, ptr + size);
+  args_[index].chunks.clear();
+}
+
+void ResultCache::SetBufferArg(int index, Tag tag, const BufferArg& arg) {
+  SetChunkedBufferArg(index, tag, {arg});
+}
+
+void ResultCache::SetChunkedBufferArg(int index, Tag tag,
+                                      const std::vector<BufferArg>& chunks) {
+  args_[index] = {tag, chunks, {}};
+}
+
+bool ResultCache::Lookup() {
+  const uint64_t hash = HashInputs();
+  auto range = index_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    auto entry = it->second;
+    if (!Matches(entry->inputs)) {
+      continue;
+    }
+    const char* ptr = entry->outputs.data();
+    for (const auto& pair : args_) {
+      const auto& arg = pair.second;
+      if (arg.scalar.empty() && IsOutput(arg.tag)) {
+        for (const auto& chunk : arg.chunks) {
+          memcpy(chunk.Get(), ptr, chunk.SizeInBytes());
+          ptr += chunk.SizeInBytes();
+        }
+      }
+    }
+    entries_.splice(entries_.begin(), entries_, entry);
+    ++stats_.hits;
+    stats_.saved_time_ns += entry->time_ns;
+    has_pending_ = false;
+    return true;
+  }
+
+  ++stats_.misses;
+  has_pending_ = true;
+  pending_hash_ = hash;
+  pending_inputs_.clear();
+  VisitInputs([this](const void* data, size_t size, bool) {
+    auto ptr = static_cast<const char*>(data);
+    pending_inputs_.insert(pending_inputs_.end(), ptr, ptr + size);
+  });
+  return false;
+}
+
+void ResultCache::Insert(int64_t time_ns) {
+  if (!has_pending_) {
+    return;
+  }
+  has_pending_ = false;
+  Entry entry = {pending_hash_, std::move(pending_inputs_), {}, time_ns};
+  pending_inputs_ = {};
+  for (const auto& pair : args_) {
+    const auto& arg = pair.second;
+    if (arg.scalar.empty() && IsOutput(arg.tag)) {
+      for (const auto& chunk : arg.chunks) {
+        entry.outputs.insert(entry.outputs.end(), chunk.Get(),
+                             chunk.Get() + chunk.SizeInBytes());
+      }
+    }
+  }
+
+  const size_t size = entry.inputs.size() + entry.outputs.size();
+  if (size > options_.capacity_bytes) {
+    return;
+  }
+  while (stats_.size_bytes + size > options_.capacity_bytes) {
+    auto victim = std::prev(entries_.end());
+    auto range = index_.equal_range(victim->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == victim) {
+        index_.erase(it);
+        break;
+      }
+    }
+    stats_.size_bytes -= victim->inputs.size() + victim->outputs.size();
+    ++stats_.evictions;
+    entries_.erase(victim);
+  }
+  const uint64_t hash = entry.hash;
+  entries_.push_front(std::move(entry));
+  index_.emplace(hash, entries_.begin());
+  stats_.size_bytes += size;
+}
+
+uint64_t ResultCache::HashInputs() const {
+  Hasher hasher;
+  VisitInputs([this, &hasher](const void* data, size_t size, bool is_buffer) {
+    if (!is_buffer || options_.sample_threshold_bytes == 0 ||
+        size <= options_.sample_threshold_bytes || size < kSampleSize) {
+      hasher.Update(data, size);
+      return;
+    }
+    auto ptr = static_cast<const char*>(data);
+    for (size_t i = 0; i < kSampleCount; ++i) {
+      hasher.Update(ptr + i * (size - kSampleSize) / (kSampleCount - 1),
+                    kSampleSize);
+    }
+  });
+  return hasher.Digest();
+}
+
+bool ResultCache::Matches(const std::vector<char>& inputs) const {
+  size_t pos = 0;
+  bool is_match = true;
+  VisitInputs([&](const void* data, size_t size, bool) {
+    is_match = is_match && pos + size <= inputs.size() &&
+               memcmp(inputs.data() + pos, data, size) == 0;
+    pos += size;
+  });
+  return is_match && pos == inputs.size();
+}
+
+}  // namespace internal
+}  // namespace fpga
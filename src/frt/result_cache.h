@@ -0,0 +1,101 @@
+#ifndef FPGA_RUNTIME_RESULT_CACHE_H_
+#define FPGA_RUNTIME_RESULT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <list>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "frt/buffer_arg.h"
+#include "frt/tag.h"
+
+namespace fpga {
+
+struct ResultCacheOptions {
+  // Memory budget of the cached arguments and results.
+  size_t capacity_bytes = size_t{1} << 30;
+  // Buffers larger than this are hashed from evenly spaced samples instead of
+  // the full content; hits are still verified against the full content. Zero
+  // disables sampling.
+  size_t sample_threshold_bytes = 0;
+};
+
+struct ResultCacheStats {
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t evictions = 0;
+  // Memory used by the cached arguments and results.
+  size_t size_bytes = 0;
+  // Device time of the invocations that hits have avoided.
+  int64_t saved_time_ns = 0;
+
+  double HitRate() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const ResultCacheStats& stats);
+
+namespace internal {
+
+// Caches the output buffers of invocations by their scalar arguments and the
+// content of their input buffers, evicting the least recently used entries.
+class ResultCache {
+ public:
+  explicit ResultCache(const ResultCacheOptions& options);
+
+  void SetScalarArg(int index, const void* arg, int size);
+  void SetBufferArg(int index, Tag tag, const BufferArg& arg);
+  void SetChunkedBufferArg(int index, Tag tag,
+                           const std::vector<BufferArg>& chunks);
+
+  // Looks up the current arguments. On a hit, copies the cached results to the
+  // output buffers and returns true. On a miss, keeps a copy of the inputs for
+  // `Insert`, since the invocation may overwrite them.
+  bool Lookup();
+
+  // Caches the current output buffers as the results of the last missed
+  // `Lookup`, which took `time_ns` on the device.
+  void Insert(int64_t time_ns);
+
+  ResultCacheStats GetStats() const { return stats_; }
+
+ private:
+  struct Arg {
+    Tag tag;
+    // Chunks of a buffer argument; a contiguous buffer has one chunk.
+    std::vector<BufferArg> chunks;
+    std::vector<char> scalar;
+  };
+  struct Entry {
+    uint64_t hash;
+    std::vector<char> inputs;
+    std::vector<char> outputs;
+    int64_t time_ns;
+  };
+
+  // Calls `visit(data, size, is_buffer)` on the signature and inputs of the
+  // current arguments, in a canonical order.
+  template <typename Visit>
+  void VisitInputs(Visit&& visit) const;
+  uint64_t HashInputs() const;
+  bool Matches(const std::vector<char>& inputs) const;
+
+  const ResultCacheOptions options_;
+  std::map<int, Arg> args_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index_;
+  // Inputs of the last missed `Lookup`.
+  bool has_pending_ = false;
+  uint64_t pending_hash_ = 0;
+  std::vector<char> pending_inputs_;
+  ResultCacheStats stats_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_RESULT_CACHE_H_
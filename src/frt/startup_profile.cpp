@@ -0,0 +1,18 @@
+#include "frt/startup_profile.h"
+
+#include <ostream>
+
+namespace fpga {
+
+std::ostream& operator<<(std::ostream& os, const StartupProfile& profile) {
+  os << "StartupProfile: {context: " << profile.context_time_ns
+     << " ns, program: " << profile.program_time_ns
+     << " ns, kernel: " << profile.kernel_time_ns
+     << " ns, partial: " << (profile.is_partial ? "true" : "false")
+     << ", context reused: " << (profile.is_context_reused ? "true" : "false")
+     << ", preloaded: " << (profile.is_program_preloaded ? "true" : "false");
+  os << "}";
+  return os;
+}
+
+}  // namespace fpga
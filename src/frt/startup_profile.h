@@ -0,0 +1,30 @@
+#ifndef FPGA_RUNTIME_STARTUP_PROFILE_H_
+#define FPGA_RUNTIME_STARTUP_PROFILE_H_
+
+#include <cstdint>
+
+#include <ostream>
+
+namespace fpga {
+
+struct StartupProfile {
+  // Time spent opening the device and creating the context.
+  int64_t context_time_ns = 0;
+  // Time spent loading the bitstream. For partial bitstreams loaded into a
+  // reused context, this is the reconfiguration time of the PR region.
+  int64_t program_time_ns = 0;
+  // Time spent creating kernels.
+  int64_t kernel_time_ns = 0;
+  // Whether the bitstream only reconfigures a PR region.
+  bool is_partial = false;
+  // Whether the context of an earlier instance with the same shell is reused.
+  bool is_context_reused = false;
+  // Whether the device already holds the bitstream and is not reconfigured.
+  bool is_program_preloaded = false;
+};
+
+std::ostream& operator<<(std::ostream& os, const StartupProfile& profile);
+
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_STARTUP_PROFILE_H_
@@ -1,5 +1,6 @@
 #include "frt/tapa_fast_cosim_device.h"
 
+#include <cctype>
 #include <cstdlib>
 
 #include <algorithm>
@@ -12,6 +13,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <unistd.h>
@@ -32,6 +34,15 @@ namespace fs = std::experimental::filesystem;
 #endif
 
 DEFINE_bool(xosim_save_waveform, false, "save waveform in the work directory");
+DEFINE_string(xosim_waveform_begin, "",
+              "if not empty, save waveform from this simulation time on, e.g., "
+              "`500us`; implies --xosim_save_waveform");
+DEFINE_string(xosim_waveform_end, "",
+              "if not empty, save waveform until this simulation time, e.g., "
+              "`600us`; implies --xosim_save_waveform");
+DEFINE_string(xosim_waveform_scopes, "",
+              "if not empty, save waveform of signals in these comma-separated "
+              "HDL scopes only; implies --xosim_save_waveform");
 DEFINE_string(xosim_work_dir, "",
               "if not empty, use the specified work directory instead of a "
               "temporary one");
@@ -39,10 +50,54 @@ DEFINE_string(xosim_work_dir, "",
 namespace fpga {
 namespace internal {
 
+double ParseSimulationTime(const std::string& value) {
+  constexpr std::pair<std::string_view, double> kUnits[] = {
+      {"fs", 1.}, {"ps", 1e3}, {"ns", 1e6}, {"us", 1e9}, {"ms", 1e12},
+      {"s", 1e15},
+  };
+  size_t pos = 0;
+  double number;
+  try {
+    number = std::stod(value, &pos);
+  } catch (const std::logic_error&) {
+    return -1;
+  }
+  const std::string_view unit = std::string_view(value).substr(pos);
+  for (const auto& [name, scale] : kUnits) {
+    if (unit == name && number >= 0) {
+      return number * scale;
+    }
+  }
+  return -1;
+}
+
+}  // namespace internal
+}  // namespace fpga
+
+namespace {
+
+bool ValidateSimulationTime(const char* flag, const std::string& value) {
+  return value.empty() || fpga::internal::ParseSimulationTime(value) >= 0;
+}
+
+}  // namespace
+
+DEFINE_validator(xosim_waveform_begin, &ValidateSimulationTime);
+DEFINE_validator(xosim_waveform_end, &ValidateSimulationTime);
+
+namespace fpga {
+namespace internal {
+
 namespace {
 
 using clock = std::chrono::steady_clock;
 
+int64_t ToNanoSeconds(clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
 std::string GetWorkDirectory() {
   if (!FLAGS_xosim_work_dir.empty()) {
     LOG_IF(INFO, fs::create_directories(FLAGS_xosim_work_dir))
@@ -68,8 +123,82 @@ std::string GetConfigPath(const std::string& work_dir) {
   return work_dir + "/config.json";
 }
 
+bool IsWaveformSelective() {
+  return !FLAGS_xosim_waveform_begin.empty() ||
+         !FLAGS_xosim_waveform_end.empty() ||
+         !FLAGS_xosim_waveform_scopes.empty();
+}
+
+// Returns the help message of the simulator, which lists the options it
+// accepts.
+const std::string& GetSimulatorUsage() {
+  static const std::string usage = [] {
+    subprocess::OutBuffer buf = subprocess::check_output(
+        {
+            "bash",
+            "-c",
+            "python3 -m tapa_fast_cosim.main --help 2>/dev/null || true",
+        },
+        subprocess::environment(XilinxOpenclDevice::GetEnviron()));
+    return std::string(buf.buf.data(), buf.length);
+  }();
+  return usage;
+}
+
+// Returns whether `usage` lists `option` as a whole word.
+bool IsOptionListed(std::string_view usage, std::string_view option) {
+  for (size_t pos = usage.find(option); pos != std::string_view::npos;
+       pos = usage.find(option, pos + 1)) {
+    const size_t end = pos + option.size();
+    if (end == usage.size() ||
+        !(isalnum(usage[end]) || usage[end] == '_' || usage[end] == '-')) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace
 
+void CheckWaveformWindow() {
+  if (!FLAGS_xosim_waveform_begin.empty() &&
+      !FLAGS_xosim_waveform_end.empty() &&
+      ParseSimulationTime(FLAGS_xosim_waveform_begin) >=
+          ParseSimulationTime(FLAGS_xosim_waveform_end)) {
+    throw std::invalid_argument("waveform window is empty");
+  }
+}
+
+std::vector<std::string> GetWaveformArgs(std::string_view usage) {
+  std::vector<std::string> args;
+  if (!FLAGS_xosim_save_waveform && !IsWaveformSelective()) {
+    return args;
+  }
+  args.push_back("--save_waveform");
+  auto add = [&](const std::string& option, const std::string& value) {
+    if (!IsOptionListed(usage, option)) {
+      std::clog << "WARNING: the simulator does not accept " << option
+                << "; saving waveform without it" << std::endl;
+      return false;
+    }
+    args.push_back(option + "=" + value);
+    return true;
+  };
+  if (!FLAGS_xosim_waveform_begin.empty()) {
+    add("--waveform_begin", FLAGS_xosim_waveform_begin);
+  }
+  if (!FLAGS_xosim_waveform_end.empty()) {
+    add("--waveform_end", FLAGS_xosim_waveform_end);
+  }
+  std::istringstream scopes(FLAGS_xosim_waveform_scopes);
+  for (std::string scope; std::getline(scopes, scope, ',');) {
+    if (!scope.empty() && !add("--waveform_scope", scope)) {
+      break;
+    }
+  }
+  return args;
+}
+
 TapaFastCosimDevice::TapaFastCosimDevice(std::string_view xo_path)
     : xo_path(fs::absolute(xo_path)), work_dir(GetWorkDirectory()) {}
 
@@ -86,6 +215,9 @@ std::unique_ptr<Device> TapaFastCosimDevice::New(std::string_view path,
       memcmp(content.data(), kZipMagic.data(), kZipMagic.size()) != 0) {
     return nullptr;
   }
+  // Checked before the work directory is created, so that it is not left
+  // behind.
+  CheckWaveformWindow();
   return std::make_unique<TapaFastCosimDevice>(path);
 }
 
@@ -103,7 +235,12 @@ void TapaFastCosimDevice::SetScalarArg(int index, const void* arg, int size) {
 
 void TapaFastCosimDevice::SetBufferArg(int index, Tag tag,
                                        const BufferArg& arg) {
-  buffer_table_.insert({index, arg});
+  SetChunkedBufferArg(index, tag, {arg});
+}
+
+void TapaFastCosimDevice::SetChunkedBufferArg(
+    int index, Tag tag, const std::vector<BufferArg>& chunks) {
+  buffer_table_.insert({index, chunks});
   if (tag == Tag::kReadOnly || tag == Tag::kReadWrite) {
     store_indices_.insert(index);
   }
@@ -112,6 +249,13 @@ void TapaFastCosimDevice::SetBufferArg(int index, Tag tag,
   }
 }
 
+void TapaFastCosimDevice::SetCompressedBufferArg(
+    int index, Tag tag, const BufferArg& arg,
+    const CompressionOptions& options) {
+  throw std::runtime_error(
+      "compressed buffers are not supported in simulation");
+}
+
 void TapaFastCosimDevice::SetStreamArg(int index, Tag tag, StreamWrapper& arg) {
   LOG(FATAL) << "TAPA fast cosim device does not support streaming";
 }
@@ -120,29 +264,76 @@ size_t TapaFastCosimDevice::SuspendBuffer(int index) {
   return load_indices_.erase(index) + store_indices_.erase(index);
 }
 
+void TapaFastCosimDevice::SetBufferBank(int index, int bank) {
+  throw std::runtime_error("bank selection is not supported in simulation");
+}
+
+void TapaFastCosimDevice::SetBandwidthLimit(const BandwidthLimit& limit) {
+  throw std::runtime_error("bandwidth limits are not supported in simulation");
+}
+
+void TapaFastCosimDevice::SetDeferredSubmission(size_t max_operations) {
+  // Simulation runs synchronously; there is nothing to defer.
+}
+
 void TapaFastCosimDevice::WriteToDevice() {
+  if (is_capturing_) {
+    graph_.push_back(&TapaFastCosimDevice::WriteToDevice);
+    return;
+  }
   // All buffers must have a data file.
   auto tic = clock::now();
-  for (const auto& [index, buffer_arg] : buffer_table_) {
-    std::ofstream(GetInputDataPath(work_dir, index),
-                  std::ios::out | std::ios::binary)
-        .write(buffer_arg.Get(), buffer_arg.SizeInBytes());
+  for (const auto& [index, chunks] : buffer_table_) {
+    const auto buffer_tic = clock::now();
+    size_t bytes = 0;
+    {
+      std::ofstream file(GetInputDataPath(work_dir, index),
+                         std::ios::out | std::ios::binary);
+      for (const auto& chunk : chunks) {
+        file.write(chunk.Get(), chunk.SizeInBytes());
+        bytes += chunk.SizeInBytes();
+      }
+    }
+    if (IsInstrumented()) {
+      ReportCommand(InstrumentationEvent::kLoad, index, bytes, buffer_tic);
+    }
   }
-  load_time_ = clock::now() - tic;
+  const auto toc = clock::now();
+  load_time_ = toc - tic;
+  // Simulation runs synchronously; invocations are never queued.
+  timeline_.queued_ns = ToNanoSeconds(tic);
+  timeline_.load = {ToNanoSeconds(tic), ToNanoSeconds(toc)};
 }
 
 void TapaFastCosimDevice::ReadFromDevice() {
+  if (is_capturing_) {
+    graph_.push_back(&TapaFastCosimDevice::ReadFromDevice);
+    return;
+  }
   auto tic = clock::now();
   for (int index : store_indices_) {
-    auto buffer_arg = buffer_table_.at(index);
-    std::ifstream(GetOutputDataPath(work_dir, index),
-                  std::ios::in | std::ios::binary)
-        .read(buffer_arg.Get(), buffer_arg.SizeInBytes());
+    const auto buffer_tic = clock::now();
+    size_t bytes = 0;
+    std::ifstream file(GetOutputDataPath(work_dir, index),
+                       std::ios::in | std::ios::binary);
+    for (const auto& chunk : buffer_table_.at(index)) {
+      file.read(chunk.Get(), chunk.SizeInBytes());
+      bytes += chunk.SizeInBytes();
+    }
+    if (IsInstrumented()) {
+      ReportCommand(InstrumentationEvent::kStore, index, bytes, buffer_tic);
+    }
   }
-  store_time_ = clock::now() - tic;
+  const auto toc = clock::now();
+  store_time_ = toc - tic;
+  timeline_.store = {ToNanoSeconds(tic), ToNanoSeconds(toc)};
 }
 
 void TapaFastCosimDevice::Exec() {
+  if (is_capturing_) {
+    graph_.push_back(&TapaFastCosimDevice::Exec);
+    return;
+  }
   auto tic = clock::now();
 
   nlohmann::json json;
@@ -153,8 +344,12 @@ void TapaFastCosimDevice::Exec() {
   }
   auto& axi_to_c_array_size = json["axi_to_c_array_size"];
   auto& axi_to_data_file = json["axi_to_data_file"];
-  for (const auto& [index, content] : buffer_table_) {
-    axi_to_c_array_size[std::to_string(index)] = content.SizeInCount();
+  for (const auto& [index, chunks] : buffer_table_) {
+    size_t count = 0;
+    for (const auto& chunk : chunks) {
+      count += chunk.SizeInCount();
+    }
+    axi_to_c_array_size[std::to_string(index)] = count;
     axi_to_data_file[std::to_string(index)] = GetInputDataPath(work_dir, index);
   }
   std::ofstream(GetConfigPath(work_dir)) << json.dump(2);
@@ -167,21 +362,59 @@ void TapaFastCosimDevice::Exec() {
       "--tb_output_dir=" + work_dir + "/output",
       "--launch_simulation",
   };
-  if (FLAGS_xosim_save_waveform) {
-    argv.push_back("--save_waveform");
+  // The simulator is asked for its options only if they are needed.
+  const std::string usage = IsWaveformSelective() ? GetSimulatorUsage() : "";
+  for (auto& arg : GetWaveformArgs(usage)) {
+    argv.push_back(std::move(arg));
   }
   int rc = subprocess::Popen(
                argv, subprocess::environment(XilinxOpenclDevice::GetEnviron()))
                .wait();
   LOG_IF(FATAL, rc != 0) << "TAPA fast cosim failed";
 
-  compute_time_ = clock::now() - tic;
+  if (IsInstrumented()) {
+    ReportCommand(InstrumentationEvent::kLaunch, /* index = */ -1,
+                  /* bytes = */ 0, tic);
+  }
+  const auto toc = clock::now();
+  compute_time_ = toc - tic;
+  timeline_.compute = {ToNanoSeconds(tic), ToNanoSeconds(toc)};
 }
 
-void TapaFastCosimDevice::Finish() {
+void TapaFastCosimDevice::Flush() {
   // Not implemented.
 }
 
+void TapaFastCosimDevice::Finish() {
+  // Commands have completed already.
+  instrumentation_.EndInvocation();
+}
+
+void TapaFastCosimDevice::BeginCapture() {
+  if (is_capturing_) {
+    throw std::runtime_error("already capturing");
+  }
+  is_capturing_ = true;
+  graph_.clear();
+}
+
+void TapaFastCosimDevice::EndCapture() {
+  if (!is_capturing_) {
+    throw std::runtime_error("not capturing");
+  }
+  is_capturing_ = false;
+}
+
+void TapaFastCosimDevice::Replay() {
+  if (is_capturing_) {
+    throw std::runtime_error("cannot replay while capturing");
+  }
+  // Simulation is synchronous; replaying is simply running the operations.
+  for (auto operation : graph_) {
+    (this->*operation)();
+  }
+}
+
 std::vector<ArgInfo> TapaFastCosimDevice::GetArgsInfo() const {
   std::vector<ArgInfo> args;
   for (auto& [index, _] : scalars_) {
@@ -201,6 +434,30 @@ std::vector<ArgInfo> TapaFastCosimDevice::GetArgsInfo() const {
   return args;
 }
 
+StartupProfile TapaFastCosimDevice::GetStartupProfile() const {
+  // Nothing is loaded until simulation starts.
+  return {};
+}
+
+ThrottleStats TapaFastCosimDevice::GetThrottleStats() const {
+  // Transfers are never throttled.
+  return {};
+}
+
+CompressionStats TapaFastCosimDevice::GetCompressionStats() const {
+  return {};
+}
+
+Timeline TapaFastCosimDevice::GetTimeline() const {
+  // Simulation is timed by the host clock.
+  return timeline_;
+}
+
+int64_t TapaFastCosimDevice::QueueTimeNanoSeconds() const {
+  // Simulation runs synchronously.
+  return 0;
+}
+
 int64_t TapaFastCosimDevice::LoadTimeNanoSeconds() const {
   return load_time_.count();
 }
@@ -215,8 +472,10 @@ int64_t TapaFastCosimDevice::StoreTimeNanoSeconds() const {
 
 size_t TapaFastCosimDevice::LoadBytes() const {
   size_t total_size = 0;
-  for (auto& [index, buffer_arg] : buffer_table_) {
-    total_size += buffer_arg.SizeInBytes();
+  for (auto& [index, chunks] : buffer_table_) {
+    for (const auto& chunk : chunks) {
+      total_size += chunk.SizeInBytes();
+    }
   }
   return total_size;
 }
@@ -224,11 +483,40 @@ size_t TapaFastCosimDevice::LoadBytes() const {
 size_t TapaFastCosimDevice::StoreBytes() const {
   size_t total_size = 0;
   for (int index : store_indices_) {
-    auto buffer_arg = buffer_table_.at(index);
-    total_size += buffer_arg.SizeInBytes();
+    for (const auto& chunk : buffer_table_.at(index)) {
+      total_size += chunk.SizeInBytes();
+    }
   }
   return total_size;
 }
 
+std::string TapaFastCosimDevice::GetPlatformName() const {
+  return "TAPA fast cosim";
+}
+
+std::string TapaFastCosimDevice::GetDeviceName() const { return xo_path; }
+
+int64_t TapaFastCosimDevice::ProbeTransferNanoSeconds(size_t size,
+                                                      bool is_store) {
+  throw std::runtime_error("calibration is not supported in simulation");
+}
+
+uint32_t TapaFastCosimDevice::ReadRegister(const std::string& name) {
+  throw std::runtime_error("register reads are not supported in simulation");
+}
+
+uint64_t TapaFastCosimDevice::GetInstrumentationId() const {
+  return instrumentation_.GetId();
+}
+
+void TapaFastCosimDevice::ReportCommand(InstrumentationEvent::Command command,
+                                        int index, size_t bytes,
+                                        clock::time_point tic) {
+  // Simulation is synchronous; commands are reported when they complete.
+  instrumentation_.Enqueue(command, index, "", bytes);
+  instrumentation_.Complete(command, index, "", bytes, ToNanoSeconds(tic),
+                            ToNanoSeconds(tic), ToNanoSeconds(clock::now()));
+}
+
 }  // namespace internal
 }  // namespace fpga
@@ -6,16 +6,31 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include <CL/cl2.hpp>
 #include <unordered_set>
 
 #include "frt/buffer.h"
 #include "frt/device.h"
+#include "frt/instrumentation.h"
 
 namespace fpga {
 namespace internal {
 
+// Returns simulation time `value`, e.g., `1.5us`, in femtoseconds, or a
+// negative number if `value` is malformed.
+double ParseSimulationTime(const std::string& value);
+
+// Throws `std::invalid_argument` if the waveform window set by the flags is
+// empty.
+void CheckWaveformWindow();
+
+// Returns the arguments that make the simulator save waveform as the flags
+// request. Options that `usage`, the help message of the simulator, does not
+// list are left out with a warning, since the simulator rejects them.
+std::vector<std::string> GetWaveformArgs(std::string_view usage);
+
 class TapaFastCosimDevice : public Device {
  public:
   TapaFastCosimDevice(std::string_view bitstream);
@@ -31,33 +46,66 @@ class TapaFastCosimDevice : public Device {
 
   void SetScalarArg(int index, const void* arg, int size) override;
   void SetBufferArg(int index, Tag tag, const BufferArg& arg) override;
+  void SetChunkedBufferArg(int index, Tag tag,
+                           const std::vector<BufferArg>& chunks) override;
+  void SetCompressedBufferArg(int index, Tag tag, const BufferArg& arg,
+                              const CompressionOptions& options) override;
   void SetStreamArg(int index, Tag tag, StreamWrapper& arg) override;
   size_t SuspendBuffer(int index) override;
+  void SetBufferBank(int index, int bank) override;
+  void SetBandwidthLimit(const BandwidthLimit& limit) override;
+  void SetDeferredSubmission(size_t max_operations) override;
 
   void WriteToDevice() override;
   void ReadFromDevice() override;
   void Exec() override;
+  void Flush() override;
   void Finish() override;
 
+  void BeginCapture() override;
+  void EndCapture() override;
+  void Replay() override;
+
   std::vector<ArgInfo> GetArgsInfo() const override;
+  StartupProfile GetStartupProfile() const override;
+  ThrottleStats GetThrottleStats() const override;
+  CompressionStats GetCompressionStats() const override;
+  Timeline GetTimeline() const override;
+  int64_t QueueTimeNanoSeconds() const override;
   int64_t LoadTimeNanoSeconds() const override;
   int64_t ComputeTimeNanoSeconds() const override;
   int64_t StoreTimeNanoSeconds() const override;
   size_t LoadBytes() const override;
   size_t StoreBytes() const override;
 
+  std::string GetPlatformName() const override;
+  std::string GetDeviceName() const override;
+  int64_t ProbeTransferNanoSeconds(size_t size, bool is_store) override;
+  uint32_t ReadRegister(const std::string& name) override;
+  uint64_t GetInstrumentationId() const override;
+
   const std::string xo_path;
   const std::string work_dir;
 
  private:
+  // Reports `command`, which started at `tic` and has just completed.
+  void ReportCommand(InstrumentationEvent::Command command, int index,
+                     size_t bytes, std::chrono::steady_clock::time_point tic);
+
   std::unordered_map<int, std::string> scalars_;
-  std::unordered_map<int, BufferArg> buffer_table_;
+  // Buffers are written to and read from data files chunk by chunk.
+  std::unordered_map<int, std::vector<BufferArg>> buffer_table_;
   std::unordered_set<int> load_indices_;
   std::unordered_set<int> store_indices_;
 
   std::chrono::nanoseconds load_time_;
   std::chrono::nanoseconds compute_time_;
   std::chrono::nanoseconds store_time_;
+  Timeline timeline_;
+
+  bool is_capturing_ = false;
+  std::vector<void (TapaFastCosimDevice::*)()> graph_;
+  Instrumentation instrumentation_;
 };
 
 }  // namespace internal
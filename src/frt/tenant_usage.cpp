@@ -0,0 +1,65 @@
+#include "frt/tenant_usage.h"
+
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace fpga {
+
+namespace {
+
+std::mutex& GetMutex() {
+  static std::mutex mtx;
+  return mtx;
+}
+
+std::map<std::string, TenantUsage>& GetUsage() {
+  static auto* usage = new std::map<std::string, TenantUsage>;
+  return *usage;
+}
+
+}  // namespace
+
+TenantUsage& TenantUsage::operator+=(const TenantUsage& other) {
+  invocations += other.invocations;
+  queue_time_ns += other.queue_time_ns;
+  load_time_ns += other.load_time_ns;
+  compute_time_ns += other.compute_time_ns;
+  store_time_ns += other.store_time_ns;
+  load_bytes += other.load_bytes;
+  store_bytes += other.store_bytes;
+  return *this;
+}
+
+std::ostream& operator<<(std::ostream& os, const TenantUsage& usage) {
+  os << "TenantUsage: {invocations: " << usage.invocations
+     << ", queue: " << usage.queue_time_ns
+     << " ns, load: " << usage.load_time_ns
+     << " ns, compute: " << usage.compute_time_ns
+     << " ns, store: " << usage.store_time_ns
+     << " ns, load bytes: " << usage.load_bytes
+     << ", store bytes: " << usage.store_bytes;
+  os << "}";
+  return os;
+}
+
+std::map<std::string, TenantUsage> GetTenantUsage() {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  return GetUsage();
+}
+
+void ResetTenantUsage() {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  GetUsage().clear();
+}
+
+namespace internal {
+
+void AddTenantUsage(const std::string& tenant, const TenantUsage& usage) {
+  std::lock_guard<std::mutex> lock(GetMutex());
+  GetUsage()[tenant] += usage;
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,42 @@
+#ifndef FPGA_RUNTIME_TENANT_USAGE_H_
+#define FPGA_RUNTIME_TENANT_USAGE_H_
+
+#include <cstdint>
+
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace fpga {
+
+// Device resources used by the invocations of a tenant.
+struct TenantUsage {
+  int64_t invocations = 0;
+  // Time between enqueuing the first command of an invocation and the device
+  // starting it, i.e., time spent waiting for the device.
+  int64_t queue_time_ns = 0;
+  int64_t load_time_ns = 0;
+  int64_t compute_time_ns = 0;
+  int64_t store_time_ns = 0;
+  int64_t load_bytes = 0;
+  int64_t store_bytes = 0;
+
+  TenantUsage& operator+=(const TenantUsage& other);
+};
+
+std::ostream& operator<<(std::ostream& os, const TenantUsage& usage);
+
+// Returns the usage accumulated by each tenant in this process.
+std::map<std::string, TenantUsage> GetTenantUsage();
+
+// Clears the usage of all tenants, e.g., after billing.
+void ResetTenantUsage();
+
+namespace internal {
+
+void AddTenantUsage(const std::string& tenant, const TenantUsage& usage);
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_TENANT_USAGE_H_
@@ -0,0 +1,23 @@
+#include "frt/timeline.h"
+
+#include <ostream>
+
+namespace fpga {
+
+namespace {
+
+std::ostream& operator<<(std::ostream& os, const Timeline::Span& span) {
+  return os << "[" << span.begin_ns << ", " << span.end_ns << ")";
+}
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os, const Timeline& timeline) {
+  os << "Timeline: {queued: " << timeline.queued_ns
+     << " ns, load: " << timeline.load << ", compute: " << timeline.compute
+     << ", store: " << timeline.store;
+  os << "}";
+  return os;
+}
+
+}  // namespace fpga
@@ -0,0 +1,31 @@
+#ifndef FPGA_RUNTIME_TIMELINE_H_
+#define FPGA_RUNTIME_TIMELINE_H_
+
+#include <cstdint>
+
+#include <ostream>
+
+namespace fpga {
+
+// Times of the last invocation in nanoseconds of the host's
+// `std::chrono::steady_clock`, i.e., `CLOCK_MONOTONIC` on Linux, so that they
+// can be compared with host-side timestamps.
+struct Timeline {
+  struct Span {
+    int64_t begin_ns = 0;
+    int64_t end_ns = 0;
+  };
+
+  // When the first command was enqueued.
+  int64_t queued_ns = 0;
+  // Spans of the phases; empty if the phase did not run.
+  Span load;
+  Span compute;
+  Span store;
+};
+
+std::ostream& operator<<(std::ostream& os, const Timeline& timeline);
+
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_TIMELINE_H_
@@ -0,0 +1,102 @@
+#include "frt/transfer_pacer.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <CL/cl.h>
+#include <CL/cl2.hpp>
+#include <glog/logging.h>
+
+#include "frt/opencl_util.h"
+
+namespace fpga {
+namespace internal {
+
+TransferPacer::TransferPacer(const cl::Context& context,
+                             double bytes_per_second, size_t burst_bytes)
+    : context_(context),
+      bucket_(bytes_per_second, burst_bytes),
+      thread_(&TransferPacer::Run, this) {}
+
+TransferPacer::~TransferPacer() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    is_stopped_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+void TransferPacer::SetLimit(double bytes_per_second, size_t burst_bytes) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  bucket_ = TokenBucket(bytes_per_second, burst_bytes);
+}
+
+std::vector<cl::Event> TransferPacer::Pace(size_t size,
+                                           std::vector<cl::Event> events) {
+  cl_int err;
+  cl::UserEvent gate(context_, &err);
+  CL_CHECK(err);
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    commands_.push_back({gate, size, events});
+  }
+  cv_.notify_all();
+  events.push_back(gate);
+  return events;
+}
+
+int64_t TransferPacer::GetThrottledTimeNs() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return throttled_time_ns_;
+}
+
+int64_t TransferPacer::GetThrottledCommands() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return throttled_commands_;
+}
+
+void TransferPacer::Run() {
+  using clock = std::chrono::steady_clock;
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (;;) {
+    cv_.wait(lock, [this] { return is_stopped_ || !commands_.empty(); });
+    if (commands_.empty()) {
+      return;
+    }
+    Command command = std::move(commands_.front());
+    commands_.pop_front();
+    if (!is_stopped_ && !command.events.empty()) {
+      // A failed dependency fails the command itself, so the error is not
+      // handled here.
+      lock.unlock();
+      cl::Event::waitForEvents(command.events);
+      lock.lock();
+    }
+    if (!is_stopped_) {
+      const auto delay = bucket_.Reserve(command.size);
+      if (delay.count() > 0) {
+        const auto tic = clock::now();
+        cv_.wait_for(lock, delay, [this] { return is_stopped_; });
+        const auto waited = clock::now() - tic;
+        throttled_time_ns_ +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(waited)
+                .count();
+        ++throttled_commands_;
+      }
+    }
+    lock.unlock();
+    const cl_int err = command.gate.setStatus(CL_COMPLETE);
+    if (err != CL_SUCCESS) {
+      LOG(ERROR) << "cannot release paced transfer: "
+                 << OpenclErrToString(err);
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace internal
+}  // namespace fpga
@@ -0,0 +1,74 @@
+#ifndef FPGA_RUNTIME_TRANSFER_PACER_H_
+#define FPGA_RUNTIME_TRANSFER_PACER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <CL/cl.h>
+#include <CL/cl2.hpp>
+
+#include "frt/bandwidth_limit.h"
+
+namespace fpga {
+namespace internal {
+
+// Paces transfer commands in one direction to the rate of a token bucket.
+//
+// Each paced command also waits for a user event, which a helper thread
+// completes once the other dependencies of the command have completed and the
+// bucket has enough tokens. Commands are thus paced when they are ready to
+// run rather than when they are enqueued, and are released in the order they
+// are paced.
+class TransferPacer {
+ public:
+  TransferPacer(const cl::Context& context, double bytes_per_second,
+                size_t burst_bytes);
+  // Releases the commands still held without pacing them.
+  ~TransferPacer();
+
+  TransferPacer(const TransferPacer&) = delete;
+  TransferPacer& operator=(const TransferPacer&) = delete;
+
+  // Changes the rate and burst size of commands paced from now on.
+  void SetLimit(double bytes_per_second, size_t burst_bytes);
+
+  // Returns `events` and an event that completes when a command moving
+  // `size` bytes after `events` may start.
+  std::vector<cl::Event> Pace(size_t size, std::vector<cl::Event> events);
+
+  // Returns the time commands were held after their dependencies had
+  // completed.
+  int64_t GetThrottledTimeNs() const;
+  // Returns the number of commands that were held.
+  int64_t GetThrottledCommands() const;
+
+ private:
+  struct Command {
+    cl::UserEvent gate;
+    size_t size;
+    std::vector<cl::Event> events;
+  };
+
+  void Run();
+
+  const cl::Context context_;
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+  TokenBucket bucket_;
+  std::deque<Command> commands_;
+  bool is_stopped_ = false;
+  int64_t throttled_time_ns_ = 0;
+  int64_t throttled_commands_ = 0;
+  std::thread thread_;
+};
+
+}  // namespace internal
+}  // namespace fpga
+
+#endif  // FPGA_RUNTIME_TRANSFER_PACER_H_
@@ -1,12 +1,24 @@
 #include "frt/xilinx_opencl_device.h"
 
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 
+#include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <iostream>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
+#include <fcntl.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -16,18 +28,51 @@
 #include <xclbin.h>
 #include <subprocess.hpp>
 
+#include "frt/dependency_tracker.h"
+#include "frt/environ.h"
 #include "frt/opencl_util.h"
 #include "frt/stream_wrapper.h"
 #include "frt/tag.h"
 #include "frt/xilinx_opencl_stream.h"
 
+#ifdef __cpp_lib_filesystem
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
+
+// Not available in older XRT releases.
+#ifndef XCL_MEM_EXT_HOST_ONLY
+#define XCL_MEM_EXT_HOST_ONLY (1 << 29)
+#endif  // XCL_MEM_EXT_HOST_ONLY
+#ifndef CL_MEM_EXT_PTR_XILINX
+#define CL_MEM_EXT_PTR_XILINX (1u << 31)
+#endif  // CL_MEM_EXT_PTR_XILINX
+
+// Declared in `xrt.h`, which is not included so that FRT does not depend on
+// the XRT headers. Link against libxrt_core only if registers are read.
+extern "C" {
+void* xclGetXrtDevice(cl_device_id device, cl_int* errcode_ret);
+int xclOpenContext(void* handle, const unsigned char* xclbin_id,
+                   unsigned ip_index, bool shared);
+int xclCloseContext(void* handle, const unsigned char* xclbin_id,
+                    unsigned ip_index);
+int xclRegRead(void* handle, uint32_t ip_index, uint32_t offset,
+               uint32_t* datap);
+}
+#pragma weak xclCloseContext
+#pragma weak xclGetXrtDevice
+#pragma weak xclOpenContext
+#pragma weak xclRegRead
+
 namespace fpga {
 namespace internal {
 
 namespace {
 
-void UpdateEnviron(std::string_view script,
-                   XilinxOpenclDevice::Environ& environ) {
+void UpdateEnviron(std::string_view script, Environ& environ) {
   subprocess::OutBuffer output = subprocess::check_output(
       {
           "bash",
@@ -46,25 +91,97 @@ void UpdateEnviron(std::string_view script,
   }
 }
 
+Environ LoadEnviron() {
+  std::string xilinx_tool;
+  for (const char* env : {
+           "XILINX_VITIS",
+           "XILINX_SDX",
+           "XILINX_HLS",
+           "XILINX_VIVADO",
+       }) {
+    if (auto value = GetEnv(env)) {
+      xilinx_tool = *value;
+      break;
+    }
+  }
+
+  if (xilinx_tool.empty()) {
+    for (std::string hls : {"vitis_hls", "vivado_hls"}) {
+      subprocess::OutBuffer buf = subprocess::check_output({
+          "bash",
+          "-c",
+          "\"$0\" -version -help -l /dev/null 2>/dev/null",
+          hls,
+      });
+      std::istringstream lines(std::string(buf.buf.data(), buf.length));
+      for (std::string line; getline(lines, line);) {
+        std::string_view prefix = "source ";
+        std::string suffix = "/scripts/" + hls + "/hls.tcl -notrace";
+        if (line.size() > prefix.size() + suffix.size() &&
+            line.compare(0, prefix.size(), prefix) == 0 &&
+            line.compare(line.size() - suffix.size(), suffix.size(), suffix) ==
+                0) {
+          xilinx_tool = line.substr(
+              prefix.size(), line.size() - prefix.size() - suffix.size());
+          break;
+        }
+      }
+    }
+  }
+
+  Environ environ;
+  UpdateEnviron(xilinx_tool + "/settings64.sh", environ);
+  if (auto xrt = GetEnv("XILINX_XRT")) {
+    UpdateEnviron(*xrt + "/setup.sh", environ);
+  }
+  // Only variables that the scripts set or change are kept; exporting the
+  // inherited ones would take them over from the user.
+  for (auto it = environ.begin(); it != environ.end();) {
+    if (GetEnv(it->first) == it->second) {
+      it = environ.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return environ;
+}
+
+// Returns an ID of the shell that a partial bitstream is built against.
+std::string GetShellId(const axlf_header& header) {
+  std::ostringstream id;
+  id << std::hex << std::setfill('0');
+  for (auto byte : header.rom_uuid) {
+    id << std::setw(2) << static_cast<int>(byte);
+  }
+  id << ':' << reinterpret_cast<const char*>(header.m_platformVBNV);
+  return id.str();
+}
+
 }  // namespace
 
 XilinxOpenclDevice::XilinxOpenclDevice(const cl::Program::Binaries& binaries) {
   std::string target_device_name;
   std::vector<std::string> kernel_names;
   std::vector<int> kernel_arg_counts;
+  // Control register offsets of the arguments of each kernel.
+  std::vector<std::vector<std::pair<std::string, uint32_t>>> kernel_registers;
   int arg_count = 0;
+  std::string emulation_mode;
+  std::string shell_id;
   const auto axlf_top = reinterpret_cast<const axlf*>(binaries.begin()->data());
   switch (axlf_top->m_header.m_mode) {
     case XCLBIN_FLAT:
-    case XCLBIN_PR:
     case XCLBIN_TANDEM_STAGE2:
+      break;
+    case XCLBIN_PR:
     case XCLBIN_TANDEM_STAGE2_WITH_PR:
+      shell_id = GetShellId(axlf_top->m_header);
       break;
     case XCLBIN_HW_EMU:
-      setenv("XCL_EMULATION_MODE", "hw_emu", 0);
+      emulation_mode = "hw_emu";
       break;
     case XCLBIN_SW_EMU:
-      setenv("XCL_EMULATION_MODE", "sw_emu", 0);
+      emulation_mode = "sw_emu";
       break;
     default:
       LOG(FATAL) << "unknown xclbin mode";
@@ -86,6 +203,7 @@ XilinxOpenclDevice::XilinxOpenclDevice(const cl::Program::Binaries& binaries) {
          xml_kernel = xml_kernel->NextSiblingElement("kernel")) {
       kernel_names.push_back(xml_kernel->Attribute("name"));
       kernel_arg_counts.push_back(arg_count);
+      kernel_registers.emplace_back();
       for (auto xml_arg = xml_kernel->FirstChildElement("arg");
            xml_arg != nullptr; xml_arg = xml_arg->NextSiblingElement("arg")) {
         auto& arg = arg_table_[arg_count];
@@ -93,6 +211,10 @@ XilinxOpenclDevice::XilinxOpenclDevice(const cl::Program::Binaries& binaries) {
         ++arg_count;
         arg.name = xml_arg->Attribute("name");
         arg.type = xml_arg->Attribute("type");
+        if (const char* offset = xml_arg->Attribute("offset")) {
+          kernel_registers.back().push_back(
+              {arg.name, static_cast<uint32_t>(strtoul(offset, nullptr, 0))});
+        }
         auto cat = atoi(xml_arg->Attribute("addressQualifier"));
         switch (cat) {
           case 0:
@@ -110,49 +232,129 @@ XilinxOpenclDevice::XilinxOpenclDevice(const cl::Program::Binaries& binaries) {
       }
     }
     // m_mode doesn't always work
-    if (target_meta == "hw_em") {
-      setenv("XCL_EMULATION_MODE", "hw_emu", 0);
-    } else if (target_meta == "csim") {
-      setenv("XCL_EMULATION_MODE", "sw_emu", 0);
+    if (emulation_mode.empty()) {
+      if (target_meta == "hw_em") {
+        emulation_mode = "hw_emu";
+      } else if (target_meta == "csim") {
+        emulation_mode = "sw_emu";
+      }
     }
   } else {
     LOG(FATAL) << "cannot determine kernel name from binary";
   }
 
-  if (const char* xcl_emulation_mode = getenv("XCL_EMULATION_MODE")) {
-    for (const auto& [name, value] : GetEnviron()) {
-      setenv(name.c_str(), value.c_str(), /* __replace = */ 1);
+  // Find arguments connected to host memory, which kernels access directly.
+  const auto topology_section =
+      xclbin::get_axlf_section(axlf_top, MEM_TOPOLOGY);
+  const auto connectivity_section =
+      xclbin::get_axlf_section(axlf_top, CONNECTIVITY);
+  const auto ip_layout_section = xclbin::get_axlf_section(axlf_top, IP_LAYOUT);
+  if (topology_section && connectivity_section && ip_layout_section) {
+    const auto base = reinterpret_cast<const char*>(axlf_top);
+    const auto topology = reinterpret_cast<const mem_topology*>(
+        base + topology_section->m_sectionOffset);
+    const auto connections = reinterpret_cast<const connectivity*>(
+        base + connectivity_section->m_sectionOffset);
+    const auto ips = reinterpret_cast<const ip_layout*>(
+        base + ip_layout_section->m_sectionOffset);
+    for (int i = 0; i < connections->m_count; ++i) {
+      const auto& connection = connections->m_connection[i];
+      if (connection.mem_data_index < 0 ||
+          connection.mem_data_index >= topology->m_count ||
+          connection.m_ip_layout_index < 0 ||
+          connection.m_ip_layout_index >= ips->m_count) {
+        LOG(WARNING) << "invalid connectivity section";
+        break;
+      }
+      const auto& mem = topology->m_mem_data[connection.mem_data_index];
+      if (strncmp(reinterpret_cast<const char*>(mem.m_tag), "HOST", 4) != 0) {
+        continue;
+      }
+      // IP names are in the form of `kernel:instance`.
+      std::string_view ip_name = reinterpret_cast<const char*>(
+          ips->m_ip_data[connection.m_ip_layout_index].m_name);
+      ip_name = ip_name.substr(0, ip_name.find(':'));
+      for (int j = 0; j < kernel_names.size(); ++j) {
+        if (kernel_names[j] == ip_name) {
+          const int index = kernel_arg_counts[j] + connection.arg_index;
+          std::clog << "INFO: Argument '" << arg_table_[index].name
+                    << "' is in host memory" << std::endl;
+          host_indices_.insert(index);
+        }
+      }
     }
+  }
 
-    const auto uid = std::to_string(geteuid());
+  // Registers are read from the first compute unit of each kernel. If kernels
+  // share an argument name, the register of the first kernel is used.
+  memcpy(xclbin_uuid_.data(), axlf_top->m_header.uuid, xclbin_uuid_.size());
+  if (ip_layout_section) {
+    const auto ips = reinterpret_cast<const ip_layout*>(
+        reinterpret_cast<const char*>(axlf_top) +
+        ip_layout_section->m_sectionOffset);
+    std::vector<bool> is_resolved(kernel_names.size());
+    for (int i = 0; i < ips->m_count; ++i) {
+      if (ips->m_ip_data[i].m_type != IP_KERNEL) {
+        continue;
+      }
+      std::string_view ip_name =
+          reinterpret_cast<const char*>(ips->m_ip_data[i].m_name);
+      ip_name = ip_name.substr(0, ip_name.find(':'));
+      for (int j = 0; j < kernel_names.size(); ++j) {
+        if (kernel_names[j] == ip_name && !is_resolved[j]) {
+          is_resolved[j] = true;
+          for (const auto& [name, offset] : kernel_registers[j]) {
+            registers_.insert({name, {static_cast<unsigned>(i), offset}});
+          }
+        }
+      }
+    }
+  }
 
-    // Vitis software simulation stucks without $USER.
-    setenv("USER", uid.c_str(), /* __replace = */ 0);
+  // Hardware binaries can be emulated if XCL_EMULATION_MODE is set.
+  if (emulation_mode.empty()) {
+    emulation_mode = GetEnv("XCL_EMULATION_MODE").value_or("");
+  }
 
-    const char* tmpdir_or_null = getenv("TMPDIR");
-    std::string tmpdir = tmpdir_or_null ? tmpdir_or_null : "/tmp";
-    tmpdir += "/.frt." + uid;
-    if (mkdir(tmpdir.c_str(), S_IRUSR | S_IWUSR | S_IXUSR) && errno != EEXIST) {
-      LOG(FATAL) << "cannot create FRT tmpdir '" << tmpdir
-                 << "': " << strerror(errno);
-    }
+  if (!emulation_mode.empty()) {
+    // The run directory of the user is read before FRT exports anything.
+    const auto user_run_dir = GetUserEnv("SDACCEL_EM_RUN_DIR");
+    environ_ = GetEnviron();
+    ExportEnviron(environ_, /* overwrite = */ true);
 
-    // If SDACCEL_EM_RUN_DIR is not set, use a per-use tmpdir for `.run`.
-    setenv("SDACCEL_EM_RUN_DIR", tmpdir.c_str(), 0);
+    // XRT reads the mode from the process environment only once, so a
+    // process cannot mix emulation modes; this throws if it tries to.
+    Environ emulation_environ = {{"XCL_EMULATION_MODE", emulation_mode}};
+    ExportEnviron(emulation_environ, /* overwrite = */ false);
 
-    // If EMCONFIG_PATH is not set, use a per-user and per-device tmpdir to
-    // cache `emconfig.json`.
+    const std::string tmpdir = GetRuntimeDir();
+    Environ default_environ = {
+        // Vitis software simulation stucks without $USER.
+        {"USER", std::to_string(geteuid())},
+        // If EMCONFIG_PATH is not set, use a per-user and per-device tmpdir
+        // to cache `emconfig.json`.
+        {"EMCONFIG_PATH", tmpdir + "/emconfig." + target_device_name},
+    };
+    ExportDefaults(default_environ);
+    for (const auto* exported : {&emulation_environ, &default_environ}) {
+      for (const auto& [name, value] : *exported) {
+        environ_[name] = value;
+      }
+    }
 
-    std::string emconfig_dir;
-    if (const char* emconfig_dir_or_null = getenv("EMCONFIG_PATH")) {
-      emconfig_dir = emconfig_dir_or_null;
+    // If SDACCEL_EM_RUN_DIR is not set, use a per-instance tmpdir for `.run`
+    // so that parallel emulation jobs do not collide.
+    if (user_run_dir.has_value()) {
+      environ_["SDACCEL_EM_RUN_DIR"] = *user_run_dir;
     } else {
-      emconfig_dir = tmpdir;
-      emconfig_dir += "/emconfig.";
-      emconfig_dir += target_device_name;
-      setenv("EMCONFIG_PATH", emconfig_dir.c_str(), 0);
+      run_dir_ = tmpdir + "/run.XXXXXX";
+      LOG_IF(FATAL, ::mkdtemp(&run_dir_[0]) == nullptr)
+          << "cannot create emulation run directory: " << strerror(errno);
+      environ_["SDACCEL_EM_RUN_DIR"] = run_dir_;
     }
 
+    const std::string& emconfig_dir = environ_["EMCONFIG_PATH"];
+
     // Generate `emconfig.json` when necessary.
     std::string cmd =
         "jq --exit-status "
@@ -164,13 +366,63 @@ XilinxOpenclDevice::XilinxOpenclDevice(const cl::Program::Binaries& binaries) {
     cmd += target_device_name;
     cmd += " --od ";
     cmd += emconfig_dir;
-    if (system(cmd.c_str())) {
+    // `emconfig.json` is shared by all instances; lock it so that concurrent
+    // instances do not generate it at the same time.
+    const std::string lock_path = emconfig_dir + ".lock";
+    int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    PLOG_IF(FATAL, lock_fd < 0) << "cannot open '" << lock_path << "'";
+    PLOG_IF(FATAL, flock(lock_fd, LOCK_EX)) << "cannot lock '" << lock_path
+                                            << "'";
+    if (subprocess::Popen({"bash", "-c", cmd},
+                          subprocess::environment(environ_))
+            .wait()) {
       LOG(WARNING) << "emconfigutil failed";
     }
+    close(lock_fd);
   }
 
-  Initialize(binaries, "Xilinx", target_device_name, kernel_names,
-             kernel_arg_counts);
+  if (run_dir_.empty()) {
+    Initialize(binaries, "Xilinx", target_device_name, kernel_names,
+               kernel_arg_counts, shell_id);
+  } else {
+    // XRT reads SDACCEL_EM_RUN_DIR from the process environment when the
+    // program is loaded, so loading is serialized among emulation instances.
+    // Emulation itself still runs in parallel.
+    // Contexts are not shared with other instances, whose run directories
+    // are removed with them.
+    static std::mutex mtx;
+    std::lock_guard<std::mutex> lock(mtx);
+    Environ run_environ = {{"SDACCEL_EM_RUN_DIR", run_dir_}};
+    ExportEnviron(run_environ, /* overwrite = */ true);
+    try {
+      Initialize(binaries, "Xilinx", target_device_name, kernel_names,
+                 kernel_arg_counts);
+    } catch (const std::exception&) {
+      // The destructor does not run, so the logs of the failed emulation are
+      // kept.
+      std::clog << "INFO: keeping emulation run directory '" << run_dir_
+                << "'" << std::endl;
+      throw;
+    }
+  }
+}
+
+XilinxOpenclDevice::~XilinxOpenclDevice() {
+  for (unsigned ip_index : opened_ips_) {
+    xclCloseContext(xrt_device_, xclbin_uuid_.data(), ip_index);
+  }
+  if (run_dir_.empty()) {
+    return;
+  }
+  if (has_failed_) {
+    std::clog << "INFO: keeping emulation run directory '" << run_dir_ << "'"
+              << std::endl;
+    return;
+  }
+
+  // Release OpenCL objects first so that XRT stops using the run directory.
+  ReleaseClObjects();
+  fs::remove_all(run_dir_);
 }
 
 std::unique_ptr<Device> XilinxOpenclDevice::New(
@@ -182,83 +434,139 @@ std::unique_ptr<Device> XilinxOpenclDevice::New(
   return std::make_unique<XilinxOpenclDevice>(binaries);
 }
 
+void XilinxOpenclDevice::SetBufferArg(int index, Tag tag,
+                                      const BufferArg& arg) {
+  OpenclDevice::SetBufferArg(index, tag, arg);
+  // Kernels access host memory directly; no migration is necessary.
+  if (host_indices_.count(index)) {
+    load_indices_.erase(index);
+    store_indices_.erase(index);
+  }
+}
+
 void XilinxOpenclDevice::SetStreamArg(int index, Tag tag, StreamWrapper& arg) {
   auto pair = GetKernel(index);
   arg.Attach(std::make_unique<XilinxOpenclStream>(
       arg.name, device_, pair.second, pair.first, tag));
 }
 
-void XilinxOpenclDevice::WriteToDevice() {
-  if (!load_indices_.empty()) {
-    load_event_.resize(1);
-    CL_CHECK(cmd_.enqueueMigrateMemObjects(GetLoadBuffers(), /* flags = */ 0,
-                                           /* events = */ nullptr,
-                                           load_event_.data()));
-  } else {
-    load_event_.clear();
+uint32_t XilinxOpenclDevice::ReadRegister(const std::string& name) {
+  auto reg = registers_.find(name);
+  if (reg == registers_.end()) {
+    throw std::invalid_argument("register '" + name + "' does not exist");
   }
+  if (xclRegRead == nullptr) {
+    throw std::runtime_error("reading registers requires XRT");
+  }
+  uint32_t value;
+  std::lock_guard<std::mutex> lock(register_mtx_);
+  if (xrt_device_ == nullptr) {
+    cl_int err;
+    xrt_device_ = xclGetXrtDevice(device_(), &err);
+    CL_CHECK(err);
+  }
+  const auto [ip_index, offset] = reg->second;
+  // Shared contexts let the OpenCL runtime keep launching the kernels.
+  if (!opened_ips_.count(ip_index)) {
+    if (xclOpenContext(xrt_device_, xclbin_uuid_.data(), ip_index,
+                       /* shared = */ true) != 0) {
+      throw std::runtime_error("cannot open compute unit for register '" +
+                               name + "'");
+    }
+    opened_ips_.insert(ip_index);
+  }
+  if (xclRegRead(xrt_device_, ip_index, offset, &value) != 0) {
+    throw std::runtime_error("cannot read register '" + name + "'");
+  }
+  return value;
 }
 
-void XilinxOpenclDevice::ReadFromDevice() {
-  if (!store_indices_.empty()) {
-    store_event_.resize(1);
-    CL_CHECK(cmd_.enqueueMigrateMemObjects(
-        GetStoreBuffers(), CL_MIGRATE_MEM_OBJECT_HOST, &compute_event_,
-        store_event_.data()));
-  } else {
-    store_event_.clear();
-  }
+bool XilinxOpenclDevice::IsInHostMemory(int index) const {
+  return host_indices_.count(index);
 }
 
-XilinxOpenclDevice::Environ XilinxOpenclDevice::GetEnviron() {
-  std::string xilinx_tool;
-  for (const char* env : {
-           "XILINX_VITIS",
-           "XILINX_SDX",
-           "XILINX_HLS",
-           "XILINX_VIVADO",
-       }) {
-    if (const char* value = getenv(env)) {
-      xilinx_tool = value;
-      break;
-    }
-  }
+void XilinxOpenclDevice::EnqueueLoad(const TransferList& transfers,
+                                     const std::vector<cl::Event>& events) {
+  EnqueueMigration(transfers, events, /* is_store = */ false, load_event_);
+}
 
-  if (xilinx_tool.empty()) {
-    for (std::string hls : {"vitis_hls", "vivado_hls"}) {
-      subprocess::OutBuffer buf = subprocess::check_output({
-          "bash",
-          "-c",
-          "\"$0\" -version -help -l /dev/null 2>/dev/null",
-          hls,
-      });
-      std::istringstream lines(std::string(buf.buf.data(), buf.length));
-      for (std::string line; getline(lines, line);) {
-        std::string_view prefix = "source ";
-        std::string suffix = "/scripts/" + hls + "/hls.tcl -notrace";
-        if (line.size() > prefix.size() + suffix.size() &&
-            line.compare(0, prefix.size(), prefix) == 0 &&
-            line.compare(line.size() - suffix.size(), suffix.size(), suffix) ==
-                0) {
-          xilinx_tool = line.substr(
-              prefix.size(), line.size() - prefix.size() - suffix.size());
-          break;
-        }
+void XilinxOpenclDevice::EnqueueStore(const TransferList& transfers,
+                                      const std::vector<cl::Event>& events) {
+  EnqueueMigration(transfers, events, /* is_store = */ true, store_event_);
+}
+
+void XilinxOpenclDevice::EnqueueMigration(
+    const TransferList& transfers, const std::vector<cl::Event>& events,
+    bool is_store, std::vector<cl::Event>& transfer_events) {
+  const cl_mem_migration_flags flags =
+      is_store ? CL_MIGRATE_MEM_OBJECT_HOST : 0;
+  const size_t chunk_size = GetTransferChunkSize(is_store);
+  if (transfers.buffers.empty()) {
+    transfer_events.clear();
+  } else if (chunk_size == SIZE_MAX) {
+    transfer_events.resize(1);
+    CL_CHECK(cmd_.enqueueMigrateMemObjects(transfers.buffers, flags, &events,
+                                           transfer_events.data()));
+  } else {
+    // Migrations cannot move part of a buffer, so throttled buffers are
+    // grouped into migrations of about the chunk size, each paced on its own.
+    // Larger buffers would go out in one burst and are not throttled.
+    transfer_events.resize(transfers.buffers.size());
+    for (size_t begin = 0, end; begin < transfers.buffers.size();
+         begin = end) {
+      size_t size = transfers.sizes[begin];
+      for (end = begin + 1; end < transfers.buffers.size() &&
+                            size + transfers.sizes[end] <= chunk_size;
+           ++end) {
+        size += transfers.sizes[end];
+      }
+      std::vector<cl::Event> wait_events = events;
+      if (size <= chunk_size) {
+        wait_events = Throttle(is_store, size, std::move(wait_events));
+      } else if (!is_oversized_migration_reported_) {
+        is_oversized_migration_reported_ = true;
+        std::clog << "WARNING: buffer of argument "
+                  << transfers.indices[begin] << " has " << size
+                  << " bytes, more than the chunk size of the bandwidth "
+                     "limit; it is migrated as a whole without throttling"
+                  << std::endl;
       }
+      const std::vector<cl::Memory> buffers(transfers.buffers.begin() + begin,
+                                            transfers.buffers.begin() + end);
+      CL_CHECK(cmd_.enqueueMigrateMemObjects(buffers, flags, &wait_events,
+                                             &transfer_events[begin]));
+      std::fill(transfer_events.begin() + begin + 1,
+                transfer_events.begin() + end, transfer_events[begin]);
     }
   }
+}
 
-  Environ environ;
-  UpdateEnviron(xilinx_tool + "/settings64.sh", environ);
-  if (const char* xrt = getenv("XILINX_XRT")) {
-    UpdateEnviron(std::string(xrt) + "/setup.sh", environ);
-  }
-  return environ;
+const Environ& XilinxOpenclDevice::GetEnviron() {
+  // Sourcing the settings scripts is slow and the result does not change.
+  static const auto* environ = new Environ(LoadEnviron());
+  return *environ;
 }
 
 cl::Buffer XilinxOpenclDevice::CreateBuffer(int index, cl_mem_flags flags,
                                             void* host_ptr, size_t size) {
+  if (host_ptr == nullptr) {
+    // Chunked and compressed buffers are gathered into device memory by
+    // offset writes.
+    if (host_indices_.count(index)) {
+      throw std::runtime_error(
+          "chunked and compressed buffers cannot be in host memory");
+    }
+    return OpenclDevice::CreateBuffer(index, flags, host_ptr, size);
+  }
   flags |= CL_MEM_USE_HOST_PTR;
+  if (host_indices_.count(index)) {
+    cl_mem_ext_ptr_t ext;
+    ext.flags = XCL_MEM_EXT_HOST_ONLY;
+    ext.obj = host_ptr;
+    ext.param = nullptr;
+    return OpenclDevice::CreateBuffer(index, flags | CL_MEM_EXT_PTR_XILINX,
+                                      &ext, size);
+  }
   return OpenclDevice::CreateBuffer(index, flags, host_ptr, size);
 }
 
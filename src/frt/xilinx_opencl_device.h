@@ -2,14 +2,19 @@
 #define FPGA_RUNTIME_XILINX_OPENCL_DEVICE_H_
 
 #include <cstddef>
+#include <cstdint>
 
+#include <array>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <CL/cl.h>
 #include <CL/cl2.hpp>
 
+#include "frt/environ.h"
 #include "frt/opencl_device.h"
 
 namespace fpga {
@@ -17,21 +22,59 @@ namespace internal {
 
 class XilinxOpenclDevice : public OpenclDevice {
  public:
-  using Environ = std::unordered_map<std::string, std::string>;
-
   XilinxOpenclDevice(const cl::Program::Binaries& binaries);
+  ~XilinxOpenclDevice() override;
 
   static std::unique_ptr<Device> New(const cl::Program::Binaries& binaries);
 
+  void SetBufferArg(int index, Tag tag, const BufferArg& arg) override;
   void SetStreamArg(int index, Tag tag, StreamWrapper& arg) override;
-  void WriteToDevice() override;
-  void ReadFromDevice() override;
+  // Reads a control register of the kernels through XRT. Registers are named
+  // after the kernel arguments whose offsets are in the xclbin metadata.
+  uint32_t ReadRegister(const std::string& name) override;
 
-  static Environ GetEnviron();
+  // Returns the variables set or changed by the settings scripts of the
+  // Xilinx tools and XRT.
+  static const Environ& GetEnviron();
 
  private:
   cl::Buffer CreateBuffer(int index, cl_mem_flags flags, void* host_ptr,
                           size_t size) override;
+  bool IsInHostMemory(int index) const override;
+  void EnqueueLoad(const TransferList& transfers,
+                   const std::vector<cl::Event>& events) override;
+  void EnqueueStore(const TransferList& transfers,
+                    const std::vector<cl::Event>& events) override;
+  // Enqueues migrations of `transfers` after `events`, and sets
+  // `transfer_events` to their events.
+  void EnqueueMigration(const TransferList& transfers,
+                        const std::vector<cl::Event>& events, bool is_store,
+                        std::vector<cl::Event>& transfer_events);
+
+  // Environment of subprocesses spawned for this device.
+  Environ environ_;
+  // Per-instance emulation run directory created by FRT, if any. It is
+  // removed on destruction, and kept if initialization or commands fail.
+  std::string run_dir_;
+  // Indices of arguments connected to host memory.
+  std::unordered_set<int> host_indices_;
+  // Whether a buffer too large to throttle has been reported.
+  bool is_oversized_migration_reported_ = false;
+
+  // A control register, at `offset` of the compute unit at `ip_index` of the
+  // IP layout.
+  struct Register {
+    unsigned ip_index;
+    uint32_t offset;
+  };
+  // Control registers, keyed by argument name.
+  std::unordered_map<std::string, Register> registers_;
+  // Identifies the xclbin when compute units are opened for register reads.
+  std::array<unsigned char, 16> xclbin_uuid_;
+  // Guards the XRT device handle and the compute units opened on it.
+  std::mutex register_mtx_;
+  void* xrt_device_ = nullptr;
+  std::unordered_set<unsigned> opened_ips_;
 };
 
 }  // namespace internal
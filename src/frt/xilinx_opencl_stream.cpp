@@ -7,6 +7,7 @@
 #include <CL/cl2.hpp>
 
 #include "frt/opencl_util.h"
+#include "frt/probes.h"
 
 // Link against libxilinxopencl only if necessary.
 #pragma weak clCreateStream
@@ -76,9 +77,11 @@ void XilinxOpenclStream::Read(void* host_ptr, size_t size, bool eot) {
     req.flags = CL_STREAM_EOT;
   }
   req.priv_data = const_cast<char*>(name_.c_str());
+  FRT_PROBE(stream__read__begin, name_.c_str(), host_ptr, size, eot);
   cl_int err;
   clReadStream(stream_, host_ptr, size, &req, &err);
   CL_CHECK(err);
+  FRT_PROBE(stream__read__end, name_.c_str(), size);
 }
 
 void XilinxOpenclStream::Write(const void* host_ptr, size_t size, bool eot) {
@@ -90,9 +93,11 @@ void XilinxOpenclStream::Write(const void* host_ptr, size_t size, bool eot) {
     req.flags = CL_STREAM_EOT;
   }
   req.priv_data = const_cast<char*>(name_.c_str());
+  FRT_PROBE(stream__write__begin, name_.c_str(), host_ptr, size, eot);
   cl_int err;
   clWriteStream(stream_, const_cast<void*>(host_ptr), size, &req, &err);
   CL_CHECK(err);
+  FRT_PROBE(stream__write__end, name_.c_str(), size);
 }
 
 }  // namespace internal
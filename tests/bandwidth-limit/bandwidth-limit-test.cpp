@@ -0,0 +1,154 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+int64_t ElapsedNs(clock_type::time_point tic) {
+  const auto elapsed = clock_type::now() - tic;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+// 32 MiB/s after a burst of 1 MiB, in chunks of 1 MiB.
+fpga::BandwidthLimit MakeLimit(bool is_store) {
+  fpga::BandwidthLimit limit;
+  (is_store ? limit.store_bytes_per_second : limit.load_bytes_per_second) =
+      32 << 20;
+  limit.burst_bytes = 1 << 20;
+  limit.chunk_bytes = 1 << 20;
+  return limit;
+}
+
+// Splits `data` into `count` chunks of equal size.
+std::vector<std::pair<float*, size_t>> Split(std::vector<float>& data,
+                                             int count) {
+  std::vector<std::pair<float*, size_t>> chunks;
+  for (int i = 0; i < count; ++i) {
+    chunks.push_back(
+        {data.data() + i * data.size() / count, data.size() / count});
+  }
+  return chunks;
+}
+
+using BandwidthLimitTest = FakeIcdPlatformTest;
+
+TEST_P(BandwidthLimitTest, LoadsAreThrottled) {
+  constexpr uint64_t n = 1 << 18;
+  constexpr int kInvocations = 4;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(bitstream_);
+  auto limit = MakeLimit(/* is_store = */ false);
+  instance.SetBandwidthLimit(limit);
+  for (int i = 0; i < kInvocations; ++i) {
+    vadd.Invoke(instance);
+    EXPECT_TRUE(vadd.IsResult());
+  }
+
+  // Loading 8 MiB in 1 MiB commands at 32 MiB/s after a 1 MiB burst holds
+  // all commands but the first for about 7 MiB worth of time.
+  const auto stats = instance.GetThrottleStats();
+  clog << stats << endl;
+  EXPECT_GE(stats.load_throttled_time_ns, 150'000'000);
+  EXPECT_LT(stats.load_throttled_time_ns, 1'000'000'000);
+  EXPECT_EQ(stats.store_throttled_time_ns, 0);
+  EXPECT_GE(stats.throttled_commands, 2 * kInvocations - 1);
+  if (IsIntel()) {
+    EXPECT_EQ(CountCalls("clEnqueueWriteBuffer"), 2 * kInvocations);
+    EXPECT_EQ(CountCalls("clEnqueueReadBuffer"), kInvocations);
+  } else {
+    EXPECT_EQ(CountCalls("clEnqueueMigrateMemObjects"), 3 * kInvocations);
+  }
+
+  limit.store_bytes_per_second = -1;
+  EXPECT_THROW(instance.SetBandwidthLimit(limit), std::invalid_argument);
+}
+
+TEST_P(BandwidthLimitTest, StoresArePacedAfterKernels) {
+  platform_.devices[0].kernel_time_ns = 100'000'000;
+  Reset(platform_);
+
+  // The output is chunked, so that Xilinx devices can throttle it as well.
+  constexpr uint64_t n = 1 << 20;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(bitstream_);
+  instance.SetBandwidthLimit(MakeLimit(/* is_store = */ true));
+  const auto tic = clock_type::now();
+  instance.Invoke(fpga::WriteOnly(vadd.a.data(), n),
+                  fpga::WriteOnly(vadd.b.data(), n),
+                  fpga::ReadOnly(Split(vadd.c, 4)), n);
+  const int64_t elapsed_ns = ElapsedNs(tic);
+  EXPECT_TRUE(vadd.IsResult());
+
+  // The 4 chunks of 1 MiB are paced once the kernel has finished, rather than
+  // while it runs, so 3 of them are held after it for about 94 ms.
+  const auto stats = instance.GetThrottleStats();
+  clog << stats << endl;
+  EXPECT_GE(elapsed_ns, platform_.devices[0].kernel_time_ns + 90'000'000);
+  EXPECT_GE(stats.store_throttled_time_ns, 90'000'000);
+  EXPECT_EQ(stats.load_throttled_time_ns, 0);
+  EXPECT_EQ(stats.throttled_commands, 3);
+}
+
+TEST_P(BandwidthLimitTest, DeferredLoadsArePacedAfterFlush) {
+  constexpr uint64_t n = 1 << 20;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(bitstream_);
+  instance.SetBandwidthLimit(MakeLimit(/* is_store = */ false));
+  instance.DeferSubmission(100);
+  instance.SetArgs(fpga::WriteOnly(Split(vadd.a, 4)),
+                   fpga::WriteOnly(Split(vadd.b, 4)),
+                   fpga::ReadOnly(vadd.c.data(), n), n);
+  instance.WriteToDevice();
+  instance.Exec();
+  instance.ReadFromDevice();
+
+  // Loads of 8 MiB are held after the flush, not while they are deferred.
+  const auto tic = clock_type::now();
+  instance.Flush();
+  instance.Finish();
+  const int64_t elapsed_ns = ElapsedNs(tic);
+  EXPECT_TRUE(vadd.IsResult());
+  EXPECT_GE(elapsed_ns, 200'000'000);
+  EXPECT_GE(instance.GetThrottleStats().load_throttled_time_ns, 200'000'000);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVendors, BandwidthLimitTest, AllVendors(),
+                         VendorName);
+
+using XilinxBandwidthLimitTest = FakeIcdTest;
+
+TEST_F(XilinxBandwidthLimitTest, BuffersLargerThanChunksAreNotThrottled) {
+  Reset(MakePlatform(Vendor::kXilinx));
+
+  // Migrations cannot split the 4 MiB buffers into chunks of 1 MiB.
+  constexpr uint64_t n = 1 << 20;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(WriteBitstream(Vendor::kXilinx));
+  instance.SetBandwidthLimit(MakeLimit(/* is_store = */ false));
+  vadd.Invoke(instance);
+  EXPECT_TRUE(vadd.IsResult());
+  const auto stats = instance.GetThrottleStats();
+  EXPECT_EQ(stats.load_throttled_time_ns, 0);
+  EXPECT_EQ(stats.throttled_commands, 0);
+  EXPECT_EQ(CountCalls("clEnqueueMigrateMemObjects"), 3);
+}
+
+}  // namespace
+}  // namespace fake_icd
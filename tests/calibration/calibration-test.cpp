@@ -0,0 +1,62 @@
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using CalibrationTest = FakeIcdTest;
+
+TEST_F(CalibrationTest, FitRecoversDeviceModel) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  auto& device = platform.devices[0];
+  device.transfer_latency_ns = 5000;
+  device.h2d_bandwidth = 2.;
+  device.d2h_bandwidth = 4.;
+  device.launch_latency_ns = 7000;
+  Reset(platform);
+  RegisterKernel("VecAdd", VecAdd, /* time_ns = */ 0);
+  UseCleanTmpdir();
+
+  fpga::Instance instance(WriteBitstream(Vendor::kXilinx));
+  EXPECT_FALSE(instance.GetCalibration().has_value());
+
+  // Kernels are not launched unless asked for.
+  ClearCalls();
+  EXPECT_EQ(instance.Calibrate().launch_latency_ns, 0);
+  EXPECT_EQ(CountCalls("clEnqueueNDRangeKernel"), 0);
+
+  // The fitted model recovers the parameters of the fake device.
+  float a = 0, b = 0, c = 0;
+  instance.SetArgs(fpga::WriteOnly(&a, 1), fpga::WriteOnly(&b, 1),
+                   fpga::ReadOnly(&c, 1), uint64_t{1});
+  fpga::CalibrationOptions options;
+  options.probe_launch = true;
+  const auto profile = instance.Calibrate(options);
+  clog << profile << endl;
+  EXPECT_NEAR(profile.load_latency_ns, 5000, 2);
+  EXPECT_NEAR(profile.load_bytes_per_ns, 2., 1e-3);
+  EXPECT_NEAR(profile.store_latency_ns, 5000, 2);
+  EXPECT_NEAR(profile.store_bytes_per_ns, 4., 1e-3);
+  EXPECT_NEAR(profile.launch_latency_ns, 7000, kDurationToleranceNs);
+  EXPECT_NEAR(profile.LoadTimeNanoSeconds(1 << 20), 5000 + (1 << 19), 100);
+
+  // The profile is saved for the device and platform.
+  const auto saved = fpga::LoadCalibration(platform.name, device.name);
+  ASSERT_TRUE(saved.has_value());
+  EXPECT_EQ(saved->load_latency_ns, profile.load_latency_ns);
+  EXPECT_EQ(saved->store_bytes_per_ns, profile.store_bytes_per_ns);
+  EXPECT_EQ(saved->launch_latency_ns, profile.launch_latency_ns);
+  EXPECT_TRUE(instance.GetCalibration().has_value());
+  EXPECT_FALSE(fpga::LoadCalibration(platform.name, "other").has_value());
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,42 @@
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+namespace fake_icd {
+namespace {
+
+using CaptureTest = FakeIcdPlatformTest;
+
+TEST_P(CaptureTest, ReplayRerunsCapturedCommands) {
+  constexpr uint64_t n = 1 << 10;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(bitstream_);
+  vadd.SetArgs(instance);
+  instance.BeginCapture();
+  instance.WriteToDevice();
+  instance.Exec();
+  instance.ReadFromDevice();
+  instance.Finish();
+  instance.EndCapture();
+  EXPECT_EQ(CountCalls("clEnqueueNDRangeKernel"), 0);
+
+  for (int i = 0; i < 3; ++i) {
+    for (uint64_t j = 0; j < n; ++j) {
+      vadd.a[j] = i * j;
+      vadd.b[j] = i;
+    }
+    instance.Replay();
+    EXPECT_TRUE(vadd.IsResult());
+  }
+  EXPECT_EQ(CountCalls("clEnqueueNDRangeKernel"), 3);
+  EXPECT_EQ(CountCalls("clCreateBuffer"), 3);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVendors, CaptureTest, AllVendors(), VendorName);
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,64 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+namespace fake_icd {
+namespace {
+
+using ChunkedBuffersTest = FakeIcdPlatformTest;
+
+TEST_P(ChunkedBuffersTest, ChunksShareOneDeviceBuffer) {
+  // Inputs and outputs are split into separately allocated chunks.
+  const std::vector<uint64_t> sizes = {1000, 0, 24000, 4};
+  uint64_t n = 0;
+  std::vector<std::vector<float>> a, c;
+  std::vector<std::pair<float*, size_t>> a_chunks, c_chunks;
+  for (auto size : sizes) {
+    a.emplace_back(size);
+    c.emplace_back(size, -1.f);
+    n += size;
+  }
+  std::vector<float> b(n);
+  for (int i = 0; i < sizes.size(); ++i) {
+    for (uint64_t j = 0; j < sizes[i]; ++j) {
+      a[i][j] = (i + j) % 10;
+    }
+    a_chunks.push_back({a[i].data(), sizes[i]});
+    c_chunks.push_back({c[i].data(), sizes[i]});
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    b[i] = i % 9;
+  }
+
+  fpga::Instance instance(bitstream_);
+  for (int i = 0; i < 2; ++i) {
+    instance.Invoke(fpga::WriteOnly(a_chunks), fpga::WriteOnly(b.data(), n),
+                    fpga::ReadOnly(c_chunks), n);
+    uint64_t k = 0;
+    for (int j = 0; j < sizes.size(); ++j) {
+      EXPECT_TRUE(
+          IsVecAddResult(a[j].data(), &b[k], c[j].data(), sizes[j]))
+          << "in chunk " << j;
+      k += sizes[j];
+      std::fill(c[j].begin(), c[j].end(), -1.f);
+    }
+  }
+  // Each non-empty chunk is transferred at its offset in one device buffer.
+  EXPECT_EQ(CountCalls("clCreateBuffer"), 3);
+  EXPECT_EQ(CountCalls("clEnqueueReadBuffer"), 3 * 2);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVendors, ChunkedBuffersTest, AllVendors(),
+                         VendorName);
+
+}  // namespace
+}  // namespace fake_icd
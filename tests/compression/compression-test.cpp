@@ -0,0 +1,151 @@
+#include <cstdint>
+#include <cstring>
+
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using CompressionTest = FakeIcdPlatformTest;
+
+TEST_P(CompressionTest, BlocksAreTransferredCompressed) {
+  constexpr uint64_t n = 10000;
+  fpga::CompressionOptions options;
+  options.block_bytes = 4096;
+  options.alignment = 256;
+  const fpga::internal::BlockCompressor compressor(n * sizeof(float),
+                                                   options);
+  ASSERT_EQ(compressor.GetBlockCount(), 10);
+
+  // The kernel decompresses `a` and compresses `c`, as on-chip decompressors
+  // and compressors would.
+  RegisterKernel("VecAdd", [&](const std::vector<KernelArg>& args) {
+    CHECK_EQ(args[0].size, compressor.GetCapacity());
+    CHECK_EQ(args[2].size, compressor.GetCapacity());
+    std::vector<float> a(n), c(n);
+    compressor.Decompress(args[0].data, a.data());
+    auto b = static_cast<const float*>(args[1].data);
+    for (uint64_t i = 0; i < n; ++i) {
+      c[i] = a[i] + b[i];
+    }
+    compressor.Compress(c.data(), args[2].data);
+  });
+
+  std::vector<float> a(n), b(n), c(n);
+  for (uint64_t i = 0; i < n; ++i) {
+    a[i] = i / 100 % 7;
+    b[i] = i % 9;
+  }
+  fpga::Instance instance(bitstream_);
+  instance.Invoke(fpga::Compressed(fpga::WriteOnly(a.data(), n), options),
+                  fpga::WriteOnly(b.data(), n),
+                  fpga::Compressed(fpga::ReadOnly(c.data(), n), options), n);
+  EXPECT_TRUE(IsVecAddResult(a.data(), b.data(), c.data(), n));
+
+  // Each block of `a` is written on its own, followed by the index table.
+  auto stats = instance.GetCompressionStats();
+  clog << stats << endl;
+  EXPECT_EQ(stats.load_raw_bytes, n * sizeof(float));
+  EXPECT_LT(stats.load_compressed_bytes * 4, stats.load_raw_bytes);
+  EXPECT_EQ(stats.store_raw_bytes, n * sizeof(float));
+  EXPECT_LT(stats.store_compressed_bytes * 4, stats.store_raw_bytes);
+  size_t written_bytes = 0;
+  size_t read_bytes = 0;
+  for (const auto& call : GetCalls()) {
+    if (call.name == "clEnqueueWriteBuffer") {
+      written_bytes += call.bytes;
+    } else if (call.name == "clEnqueueReadBuffer") {
+      read_bytes += call.bytes;
+    }
+  }
+  // Intel writes `b` as well; Xilinx migrates it.
+  EXPECT_EQ(CountCalls("clEnqueueWriteBuffer"), 11 + IsIntel());
+  EXPECT_EQ(written_bytes,
+            stats.load_compressed_bytes + (IsIntel() ? n * sizeof(float) : 0));
+  EXPECT_EQ(CountCalls("clEnqueueReadBuffer"), 11);
+  EXPECT_EQ(read_bytes, stats.store_compressed_bytes);
+
+  // Incompressible blocks are stored as is, and replaying a captured graph
+  // compresses the current content.
+  instance.BeginCapture();
+  instance.WriteToDevice();
+  instance.Exec();
+  instance.ReadFromDevice();
+  instance.Finish();
+  instance.EndCapture();
+  std::mt19937 rng;
+  for (uint64_t i = 0; i < n; ++i) {
+    a[i] = std::uniform_real_distribution<float>()(rng);
+  }
+  instance.Replay();
+  EXPECT_TRUE(IsVecAddResult(a.data(), b.data(), c.data(), n));
+  const auto raw_stats = instance.GetCompressionStats();
+  EXPECT_EQ(raw_stats.load_compressed_bytes - stats.load_compressed_bytes,
+            compressor.GetIndexBytes() + n * sizeof(float));
+
+  // Outputs that are not in the block format are reported by `Finish`.
+  RegisterKernel("VecAdd", [](const std::vector<KernelArg>& args) {
+    memset(args[2].data, 0, args[2].size);
+  });
+  EXPECT_THROW(instance.Replay(), std::runtime_error);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVendors, CompressionTest, AllVendors(),
+                         VendorName);
+
+TEST(BlockCompressorTest, CorruptedIndexIsRejected) {
+  constexpr uint64_t n = 10000;
+  fpga::CompressionOptions options;
+  options.block_bytes = 4096;
+  const fpga::internal::BlockCompressor compressor(n * sizeof(float),
+                                                   options);
+  std::vector<float> raw(n, 1.f);
+  std::vector<char> compressed(compressor.GetCapacity());
+  compressor.Compress(raw.data(), compressed.data());
+  const auto index = compressor.ReadIndex(compressed.data());
+  ASSERT_EQ(index.size(), compressor.GetBlockCount());
+
+  // Overwrites the offset of the last block, whose entry ends the index.
+  auto corrupt = [&](uint64_t offset) {
+    auto corrupted = compressed;
+    auto block = index.back();
+    block.offset = offset;
+    memcpy(corrupted.data() + compressor.GetIndexBytes() - sizeof(block),
+           &block, sizeof(block));
+    return corrupted;
+  };
+  std::vector<float> decompressed(n);
+  const auto& block = index.back();
+  for (const uint64_t offset : {
+           // Ends one byte past the buffer.
+           compressor.GetCapacity() - block.compressed_bytes + 1,
+           // Starts past the buffer.
+           uint64_t{compressor.GetCapacity()} + 1,
+           // Ends past the buffer, at an offset that wraps around.
+           UINT64_MAX - block.compressed_bytes + 2,
+       }) {
+    const auto corrupted = corrupt(offset);
+    EXPECT_THROW(compressor.ReadIndex(corrupted.data()), std::runtime_error)
+        << "at offset " << offset;
+    EXPECT_THROW(compressor.Decompress(corrupted.data(), decompressed.data()),
+                 std::runtime_error)
+        << "at offset " << offset;
+  }
+  EXPECT_EQ(corrupt(block.offset), compressed);
+}
+
+}  // namespace
+}  // namespace fake_icd
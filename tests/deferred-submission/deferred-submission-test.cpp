@@ -0,0 +1,88 @@
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+namespace fake_icd {
+namespace {
+
+class DeferredSubmissionTest : public FakeIcdPlatformTest {
+ protected:
+  void SetUp() override {
+    FakeIcdPlatformTest::SetUp();
+    RegisterKernel("VecAdd", [this](const std::vector<KernelArg>& args) {
+      VecAdd(args);
+      ++launches_;
+    });
+  }
+
+  std::atomic<int> launches_{0};
+};
+
+TEST_P(DeferredSubmissionTest, FlushSubmitsAllInvocations) {
+  constexpr uint64_t n = 1 << 10;
+  constexpr int kInvocations = 4;
+  std::vector<VecAddArgs> vadds(kInvocations, VecAddArgs(n));
+  for (int i = 0; i < kInvocations; ++i) {
+    for (float& a : vadds[i].a) {
+      a += i;
+    }
+  }
+  fpga::Instance instance(bitstream_);
+  instance.DeferSubmission(100);
+  ClearCalls();
+  for (int i = 0; i < kInvocations; ++i) {
+    vadds[i].SetArgs(instance);
+    instance.WriteToDevice();
+    instance.Exec();
+    instance.ReadFromDevice();
+  }
+
+  // Nothing runs until flushed, and all invocations are flushed at once.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(launches_, 0);
+  instance.Flush();
+  instance.Finish();
+  EXPECT_EQ(launches_, kInvocations);
+  EXPECT_EQ(CountCalls("clFlush"), 2);
+  for (int i = 0; i < kInvocations; ++i) {
+    EXPECT_TRUE(vadds[i].IsResult()) << "in invocation " << i;
+  }
+}
+
+TEST_P(DeferredSubmissionTest, FullBatchIsFlushed) {
+  constexpr uint64_t n = 1 << 10;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(bitstream_);
+  vadd.SetArgs(instance);
+  ClearCalls();
+
+  // A full batch is flushed without waiting for an explicit flush.
+  instance.DeferSubmission(3);
+  instance.WriteToDevice();
+  instance.Exec();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(launches_, 0);
+  instance.ReadFromDevice();
+  EXPECT_EQ(CountCalls("clFlush"), 1);
+  for (int i = 0; i < 1000 && launches_ == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(launches_, 1);
+  instance.DeferSubmission(0);
+  instance.Finish();
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVendors, DeferredSubmissionTest, AllVendors(),
+                         VendorName);
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,202 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+#include <CL/cl.h>
+#include <CL/cl2.hpp>
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+#include "frt/dependency_tracker.h"
+
+namespace fake_icd {
+namespace {
+
+using DependenciesTest = FakeIcdPlatformTest;
+
+TEST_P(DependenciesTest, ConsumerWaitsForProducer) {
+  constexpr uint64_t n = 1 << 16;
+  VecAddArgs vadd(n);
+  std::vector<float> d(n, -1.f);
+  fpga::Instance producer(bitstream_);
+  fpga::Instance consumer(bitstream_);
+  for (int i = 0; i < 2; ++i) {
+    vadd.SetArgs(producer);
+    consumer.SetArgs(fpga::WriteOnly(vadd.c.data(), n),
+                     fpga::WriteOnly(vadd.b.data(), n),
+                     fpga::ReadOnly(d.data(), n), n);
+
+    // The consumer reads `c` after the producer writes it without `Finish`.
+    producer.WriteToDevice();
+    producer.Exec();
+    producer.ReadFromDevice();
+    consumer.WriteToDevice();
+    consumer.Exec();
+    consumer.ReadFromDevice();
+    consumer.Finish();
+    for (uint64_t j = 0; j < n; ++j) {
+      ASSERT_EQ(d[j], vadd.a[j] + 2 * vadd.b[j]) << "at index " << j;
+    }
+    producer.Finish();
+    std::fill(vadd.c.begin(), vadd.c.end(), -1.f);
+    std::fill(d.begin(), d.end(), -1.f);
+  }
+
+  // Buffers are reused when arguments are set to the same memory again.
+  EXPECT_EQ(CountCalls("clCreateBuffer"), 6);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVendors, DependenciesTest, AllVendors(),
+                         VendorName);
+
+using HostMemoryDependenciesTest = FakeIcdTest;
+
+TEST_F(HostMemoryDependenciesTest, TransfersWaitForKernelsInHostMemory) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  platform.devices[0].kernel_time_ns = 20'000'000;
+  Reset(platform);
+
+  // The producer writes `c` directly to host memory, which the consumer
+  // migrates as its input.
+  auto kernels = kVecAddKernels;
+  kernels[0].args[2].memory = "HOST";
+  fpga::Instance producer(WriteTempFile(
+      "vadd.host.xclbin", MakeXclbin(platform.devices[0].name, kernels)));
+  fpga::Instance consumer(WriteBitstream(Vendor::kXilinx));
+
+  constexpr uint64_t n = 1 << 10;
+  VecAddArgs vadd(n);
+  std::vector<float> d(n, -1.f);
+  vadd.SetArgs(producer);
+  consumer.SetArgs(fpga::WriteOnly(vadd.c.data(), n),
+                   fpga::WriteOnly(vadd.b.data(), n),
+                   fpga::ReadOnly(d.data(), n), n);
+  producer.WriteToDevice();
+  producer.Exec();
+  consumer.WriteToDevice();
+  consumer.Exec();
+  consumer.ReadFromDevice();
+  consumer.Finish();
+  producer.Finish();
+  EXPECT_TRUE(vadd.IsResult());
+  for (uint64_t i = 0; i < n; ++i) {
+    ASSERT_EQ(d[i], vadd.a[i] + 2 * vadd.b[i]) << "at index " << i;
+  }
+}
+
+class DependencyTrackerTest : public FakeIcdTest {
+ protected:
+  void SetUp() override {
+    Reset(MakePlatform(Vendor::kXilinx));
+    std::vector<cl::Platform> platforms;
+    ASSERT_EQ(cl::Platform::get(&platforms), CL_SUCCESS);
+    ASSERT_EQ(platforms.size(), 1);
+    std::vector<cl::Device> devices;
+    ASSERT_EQ(platforms[0].getDevices(CL_DEVICE_TYPE_ACCELERATOR, &devices),
+              CL_SUCCESS);
+    ASSERT_EQ(devices.size(), 1);
+    cl_int err;
+    device_ = devices[0];
+    context_ = cl::Context(device_, nullptr, nullptr, nullptr, &err);
+    ASSERT_EQ(err, CL_SUCCESS);
+  }
+
+  void TearDown() override {
+    for (auto& event : events_) {
+      event.setStatus(CL_COMPLETE);
+    }
+    FakeIcdTest::TearDown();
+  }
+
+  // Returns a command that is still in flight.
+  cl::Event NewCommand() {
+    cl_int err;
+    events_.emplace_back(context_, &err);
+    EXPECT_EQ(err, CL_SUCCESS);
+    return events_.back();
+  }
+
+  std::vector<cl::Event> GetDependencies(const void* ptr, size_t size,
+                                         bool is_write) {
+    std::vector<cl::Event> events;
+    tracker_.GetDependencies(context_, ptr, size, is_write, events);
+    return events;
+  }
+
+  cl::Device device_;
+  cl::Context context_;
+  std::vector<cl::UserEvent> events_;
+  fpga::internal::DependencyTracker tracker_;
+};
+
+TEST_F(DependencyTrackerTest, OverlappingStoresAreKeptUnlessWaitedFor) {
+  std::vector<float> host(1024);
+  const size_t size = host.size() * sizeof(float);
+
+  // Two stores to overlapping host memory are enqueued together, so the
+  // second does not wait for the first; readers wait for both.
+  const auto first = NewCommand();
+  const auto second = NewCommand();
+  ASSERT_TRUE(
+      GetDependencies(host.data(), size, /* is_write = */ true).empty());
+  tracker_.AddAccess(context_, host.data(), size / 2, /* is_write = */ true,
+                     first, /* waited = */ {});
+  tracker_.AddAccess(context_, host.data(), size, /* is_write = */ true,
+                     second, /* waited = */ {});
+  auto dependencies = GetDependencies(host.data(), size, false);
+  ASSERT_EQ(dependencies.size(), 2);
+  EXPECT_EQ(dependencies[0](), first());
+  EXPECT_EQ(dependencies[1](), second());
+
+  // A store that waits for both covers them.
+  const auto third = NewCommand();
+  tracker_.AddAccess(context_, host.data(), size, /* is_write = */ true,
+                     third, dependencies);
+  dependencies = GetDependencies(host.data(), size, false);
+  ASSERT_EQ(dependencies.size(), 1);
+  EXPECT_EQ(dependencies[0](), third());
+}
+
+TEST_F(DependencyTrackerTest, CommandsInOtherContextsAreBridgedOnce) {
+  std::vector<float> host(1024);
+  const size_t size = host.size() * sizeof(float);
+  cl_int err;
+  const cl::Context other(device_, nullptr, nullptr, nullptr, &err);
+  ASSERT_EQ(err, CL_SUCCESS);
+  cl::UserEvent store(other, &err);
+  ASSERT_EQ(err, CL_SUCCESS);
+  events_.push_back(store);
+  tracker_.AddAccess(other, host.data(), size, /* is_write = */ true, store,
+                     /* waited = */ {});
+
+  // Commands in this context wait for the store through one user event.
+  ClearCalls();
+  const auto dependencies = GetDependencies(host.data(), size, false);
+  ASSERT_EQ(dependencies.size(), 1);
+  EXPECT_NE(dependencies[0](), store());
+  auto bridged = GetDependencies(host.data(), size / 2, true);
+  ASSERT_EQ(bridged.size(), 1);
+  EXPECT_EQ(bridged[0](), dependencies[0]());
+  EXPECT_EQ(CountCalls("clCreateUserEvent"), 1);
+  EXPECT_EQ(CountCalls("clSetEventCallback"), 1);
+
+  // A write that waited for the bridge covers the store.
+  const auto load = NewCommand();
+  tracker_.AddAccess(context_, host.data(), size, /* is_write = */ true, load,
+                     dependencies);
+  bridged = GetDependencies(host.data(), size, false);
+  ASSERT_EQ(bridged.size(), 1);
+  EXPECT_EQ(bridged[0](), load());
+
+  // The bridge completes with the store.
+  ASSERT_EQ(store.setStatus(CL_COMPLETE), CL_SUCCESS);
+  EXPECT_EQ(dependencies[0].getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>(),
+            CL_COMPLETE);
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,163 @@
+#include <cstdint>
+#include <cstdlib>
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+namespace fake_icd {
+namespace {
+
+// Runs in its own executable because the emulation mode sticks to the
+// process.
+using EmulationTest = FakeIcdTest;
+
+TEST_F(EmulationTest, ModeSticksToProcess) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  Reset(platform);
+
+  // Use an empty Vitis installation and a clean runtime directory.
+  const std::string tmpdir = UseCleanTmpdir();
+  std::ofstream(tmpdir + "/settings64.sh");
+  setenv("XILINX_VITIS", tmpdir.c_str(), /* __replace = */ 1);
+  unsetenv("SDACCEL_EM_RUN_DIR");
+
+  const auto bitstream = WriteTempFile(
+      "vadd.sw_emu.xclbin",
+      MakeXclbin(platform.devices[0].name, kVecAddKernels, "csim"));
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&bitstream] { Run(bitstream, 1 << 10); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_NE(getenv("XCL_EMULATION_MODE"), nullptr);
+  EXPECT_EQ(std::string(getenv("XCL_EMULATION_MODE")), "sw_emu");
+  {
+    constexpr uint64_t n = 1 << 10;
+    VecAddArgs vadd(n);
+    fpga::Instance instance(bitstream);
+    vadd.SetArgs(instance);
+    instance.DeferSubmission(100);
+    instance.WriteToDevice();
+    instance.Exec();
+  }
+
+  // Per-instance run directories are removed on destruction, even with
+  // commands still deferred.
+  const std::string runtime_dir =
+      tmpdir + "/.frt." + std::to_string(geteuid());
+  DIR* dir = opendir(runtime_dir.c_str());
+  ASSERT_NE(dir, nullptr) << runtime_dir;
+  while (auto entry = readdir(dir)) {
+    EXPECT_NE(std::string(entry->d_name).rfind("run.", 0), 0)
+        << "leftover run directory " << entry->d_name;
+  }
+  closedir(dir);
+
+  // Emulation modes cannot be mixed in one process.
+  EXPECT_THROW(
+      Run(WriteTempFile("vadd.hw_emu.xclbin",
+                        MakeXclbin(platform.devices[0].name, kVecAddKernels,
+                                   "hw_em")),
+          1),
+      std::runtime_error);
+  EXPECT_EQ(std::string(getenv("XCL_EMULATION_MODE")), "sw_emu");
+
+  // Instances in the same mode find the environment already exported.
+  Run(bitstream, 1 << 10);
+}
+
+TEST_F(EmulationTest, UserEnvironmentIsKept) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  Reset(platform);
+
+  // Run from a login shell that has set the variables FRT defaults.
+  const std::string tmpdir = UseCleanTmpdir();
+  std::ofstream(tmpdir + "/settings64.sh");
+  setenv("XILINX_VITIS", tmpdir.c_str(), /* __replace = */ 1);
+  const std::string emconfig_dir = tmpdir + "/emconfig";
+  const std::string run_dir = tmpdir + "/run";
+  ASSERT_EQ(mkdir(run_dir.c_str(), S_IRWXU), 0);
+  setenv("USER", "alice", /* __replace = */ 1);
+  setenv("EMCONFIG_PATH", emconfig_dir.c_str(), /* __replace = */ 1);
+  setenv("SDACCEL_EM_RUN_DIR", run_dir.c_str(), /* __replace = */ 1);
+
+  Run(WriteTempFile(
+          "vadd.sw_emu.xclbin",
+          MakeXclbin(platform.devices[0].name, kVecAddKernels, "csim")),
+      1 << 10);
+  EXPECT_EQ(std::string(getenv("USER")), "alice");
+  EXPECT_EQ(std::string(getenv("EMCONFIG_PATH")), emconfig_dir);
+  EXPECT_EQ(std::string(getenv("SDACCEL_EM_RUN_DIR")), run_dir);
+
+  // The run directory of the user is used and kept.
+  struct stat run_dir_stat;
+  EXPECT_EQ(stat(run_dir.c_str(), &run_dir_stat), 0);
+  const std::string runtime_dir =
+      tmpdir + "/.frt." + std::to_string(geteuid());
+  DIR* dir = opendir(runtime_dir.c_str());
+  ASSERT_NE(dir, nullptr) << runtime_dir;
+  while (auto entry = readdir(dir)) {
+    EXPECT_NE(std::string(entry->d_name).rfind("run.", 0), 0)
+        << "unexpected run directory " << entry->d_name;
+  }
+  closedir(dir);
+}
+
+TEST_F(EmulationTest, RunDirectoryIsKeptAfterFailedReplay) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  Reset(platform);
+  const std::string tmpdir = UseCleanTmpdir();
+  std::ofstream(tmpdir + "/settings64.sh");
+  setenv("XILINX_VITIS", tmpdir.c_str(), /* __replace = */ 1);
+  unsetenv("SDACCEL_EM_RUN_DIR");
+
+  {
+    constexpr uint64_t n = 1 << 10;
+    VecAddArgs vadd(n);
+    fpga::Instance instance(WriteTempFile(
+        "vadd.sw_emu.xclbin",
+        MakeXclbin(platform.devices[0].name, kVecAddKernels, "csim")));
+    vadd.SetArgs(instance);
+    instance.BeginCapture();
+    instance.WriteToDevice();
+    instance.Exec();
+    instance.ReadFromDevice();
+    instance.Finish();
+    instance.EndCapture();
+    SetFinishError(CL_OUT_OF_RESOURCES);
+    EXPECT_THROW(instance.Replay(), std::runtime_error);
+    SetFinishError(CL_SUCCESS);
+  }
+
+  // The logs of the failed emulation are kept for inspection.
+  const std::string runtime_dir =
+      tmpdir + "/.frt." + std::to_string(geteuid());
+  DIR* dir = opendir(runtime_dir.c_str());
+  ASSERT_NE(dir, nullptr) << runtime_dir;
+  int run_dir_count = 0;
+  while (auto entry = readdir(dir)) {
+    if (std::string(entry->d_name).rfind("run.", 0) == 0) {
+      ++run_dir_count;
+    }
+  }
+  closedir(dir);
+  EXPECT_EQ(run_dir_count, 1);
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,113 @@
+#include <cstdint>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "fake-icd.h"
+#include "frt.h"
+
+DEFINE_int32(iterations, 10, "number of invocations to measure");
+DEFINE_uint64(n, 1 << 22, "number of elements per buffer");
+DEFINE_uint64(run, 16, "number of equal consecutive elements in the input");
+DEFINE_double(link_gbps, 1., "simulated bandwidth of each direction in GB/s");
+DEFINE_uint64(block_bytes, 1 << 20, "uncompressed bytes per block");
+
+using clock_type = std::chrono::steady_clock;
+using std::clog;
+using std::endl;
+
+namespace {
+
+// Stands for a kernel that decompresses its input, computes, and compresses
+// its output at line rate. The output has the same content as the input, so
+// the input in the block format is also a valid output.
+void Copy(const std::vector<fake_icd::KernelArg>& args) {
+  CHECK_EQ(args[0].size, args[1].size);
+  memcpy(args[1].data, args[0].data, args[0].size);
+}
+
+template <typename Func>
+double MeasureNanoSeconds(Func&& func) {
+  const auto tic = clock_type::now();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    func();
+  }
+  const auto toc = clock_type::now();
+  return std::chrono::duration<double, std::nano>(toc - tic).count() /
+         FLAGS_iterations;
+}
+
+void Report(const std::string& name, double ns, size_t bytes) {
+  clog << name << ": " << ns / 1e6 << " ms/iteration, "
+       << static_cast<double>(bytes) / ns << " GB/s effective" << endl;
+}
+
+}  // namespace
+
+// Compares invocations that move plain buffers over a simulated link with
+// invocations that move compressed buffers, which are compressed on the host
+// while earlier blocks are transferred.
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, /* remove_flags = */ true);
+  google::InitGoogleLogging(argv[0]);
+
+  auto platform = fake_icd::XilinxPlatform("xilinx_fake_202010_1");
+  auto& device = platform.devices[0];
+  device.h2d_bandwidth = FLAGS_link_gbps;
+  device.d2h_bandwidth = FLAGS_link_gbps;
+  device.kernel_time_ns = 0;
+  fake_icd::Reset({platform});
+  fake_icd::RegisterKernel("Copy", Copy);
+
+  const auto bitstream = fake_icd::WriteTempFile(
+      "copy.xclbin",
+      fake_icd::MakeXclbin(device.name,
+                           {{"Copy",
+                             {
+                                 {"in", "uint32_t*", fake_icd::ArgSpec::kMmap},
+                                 {"out", "uint32_t*", fake_icd::ArgSpec::kMmap},
+                                 {"n", "uint64_t", fake_icd::ArgSpec::kScalar},
+                             }}}));
+
+  const uint64_t n = FLAGS_n;
+  std::vector<uint32_t> in(n), out(n);
+  for (uint64_t i = 0; i < n; ++i) {
+    in[i] = i / FLAGS_run % 4096;
+  }
+  fpga::Instance instance(bitstream);
+  const size_t bytes = 2 * n * sizeof(uint32_t);
+
+  const auto plain_ns = MeasureNanoSeconds([&] {
+    instance.Invoke(fpga::WriteOnly(in.data(), n),
+                    fpga::ReadOnly(out.data(), n), n);
+  });
+  CHECK(in == out);
+
+  fpga::CompressionOptions options;
+  options.block_bytes = FLAGS_block_bytes;
+  out.assign(n, 0);
+  const auto compressed_ns = MeasureNanoSeconds([&] {
+    instance.Invoke(fpga::Compressed(fpga::WriteOnly(in.data(), n), options),
+                    fpga::Compressed(fpga::ReadOnly(out.data(), n), options),
+                    n);
+  });
+  CHECK(in == out);
+
+  const auto stats = instance.GetCompressionStats();
+  clog << stats << endl;
+  Report("Uncompressed", plain_ns, bytes);
+  Report("Compressed", compressed_ns, bytes);
+  clog << "Compression ratio: "
+       << static_cast<double>(stats.load_raw_bytes) /
+              stats.load_compressed_bytes
+       << ", speedup: " << plain_ns / compressed_ns << "x" << endl;
+
+  clog << "PASS!" << endl;
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include "fake-icd-fixture.h"
+
+#include <cstdlib>
+
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "fake-icd.h"
+#include "frt.h"
+
+namespace fake_icd {
+
+namespace {
+
+constexpr char kXilinxDevice[] = "xilinx_fake_202010_1";
+constexpr char kIntelBoard[] = "fake_board";
+
+}  // namespace
+
+const std::vector<KernelSpec> kVecAddKernels = {
+    {"VecAdd",
+     {
+         {"a", "float*", ArgSpec::kMmap},
+         {"b", "float*", ArgSpec::kMmap},
+         {"c", "float*", ArgSpec::kMmap},
+         {"n", "uint64_t", ArgSpec::kScalar},
+     }},
+};
+
+void VecAdd(const std::vector<KernelArg>& args) {
+  CHECK_EQ(args.size(), 4);
+  auto a = static_cast<const float*>(args[0].data);
+  auto b = static_cast<const float*>(args[1].data);
+  auto c = static_cast<float*>(args[2].data);
+  auto n = *static_cast<const uint64_t*>(args[3].data);
+  for (uint64_t i = 0; i < n; ++i) {
+    c[i] = a[i] + b[i];
+  }
+}
+
+::testing::AssertionResult IsVecAddResult(const float* a, const float* b,
+                                          const float* c, uint64_t n) {
+  for (uint64_t i = 0; i < n; ++i) {
+    if (c[i] != a[i] + b[i]) {
+      return ::testing::AssertionFailure()
+             << "c[" << i << "] = " << c[i] << ", expected " << a[i] << " + "
+             << b[i];
+    }
+  }
+  return ::testing::AssertionSuccess();
+}
+
+VecAddArgs::VecAddArgs(uint64_t n) : n(n), a(n), b(n), c(n, -1.f) {
+  for (uint64_t i = 0; i < n; ++i) {
+    a[i] = i % 10;
+    b[i] = i % 9;
+  }
+}
+
+void VecAddArgs::SetArgs(fpga::Instance& instance) {
+  instance.SetArgs(fpga::WriteOnly(a.data(), n), fpga::WriteOnly(b.data(), n),
+                   fpga::ReadOnly(c.data(), n), n);
+}
+
+void VecAddArgs::Invoke(fpga::Instance& instance) {
+  instance.Invoke(fpga::WriteOnly(a.data(), n), fpga::WriteOnly(b.data(), n),
+                  fpga::ReadOnly(c.data(), n), n);
+}
+
+::testing::AssertionResult VecAddArgs::IsResult() const {
+  return IsVecAddResult(a.data(), b.data(), c.data(), n);
+}
+
+PlatformConfig MakePlatform(Vendor vendor) {
+  switch (vendor) {
+    case Vendor::kXilinx:
+      return XilinxPlatform(kXilinxDevice);
+    case Vendor::kIntel:
+      return IntelPlatform(kIntelBoard);
+  }
+  LOG(FATAL) << "unknown vendor";
+  return {};
+}
+
+std::string WriteBitstream(Vendor vendor,
+                           const std::vector<KernelSpec>& kernels) {
+  switch (vendor) {
+    case Vendor::kXilinx:
+      return WriteTempFile("vadd.xclbin", MakeXclbin(kXilinxDevice, kernels));
+    case Vendor::kIntel:
+      return WriteTempFile("vadd.aocx", MakeAocx(kIntelBoard, kernels));
+  }
+  LOG(FATAL) << "unknown vendor";
+  return {};
+}
+
+void FakeIcdTest::TearDown() {
+  if (old_tmpdir_.has_value()) {
+    setenv("TMPDIR", old_tmpdir_->c_str(), /* __replace = */ 1);
+    old_tmpdir_.reset();
+  }
+}
+
+void FakeIcdTest::Reset(const PlatformConfig& platform) {
+  fake_icd::Reset({platform});
+  RegisterKernel("VecAdd", VecAdd);
+}
+
+std::string FakeIcdTest::UseCleanTmpdir() {
+  if (!old_tmpdir_.has_value()) {
+    old_tmpdir_ = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+  }
+  std::string tmpdir = "/tmp/fake-icd-test.XXXXXX";
+  CHECK(mkdtemp(&tmpdir[0]) != nullptr);
+  setenv("TMPDIR", tmpdir.c_str(), /* __replace = */ 1);
+  return tmpdir;
+}
+
+fpga::Instance FakeIcdTest::Run(const std::string& bitstream, uint64_t n) {
+  VecAddArgs vadd(n);
+  fpga::Instance instance(bitstream);
+  vadd.Invoke(instance);
+  EXPECT_TRUE(vadd.IsResult());
+  auto args = instance.GetArgsInfo();
+  EXPECT_EQ(args.size(), 4);
+  if (args.size() == 4) {
+    EXPECT_EQ(args[2].name, "c");
+    EXPECT_EQ(args[3].cat, fpga::ArgInfo::kScalar);
+  }
+  return instance;
+}
+
+void FakeIcdPlatformTest::SetUp() {
+  platform_ = MakePlatform(GetParam());
+  Reset(platform_);
+  bitstream_ = WriteBitstream(GetParam());
+}
+
+std::string VendorName(const ::testing::TestParamInfo<Vendor>& info) {
+  return info.param == Vendor::kIntel ? "Intel" : "Xilinx";
+}
+
+}  // namespace fake_icd
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, /* remove_flags = */ true);
+  google::InitGoogleLogging(argv[0]);
+  return RUN_ALL_TESTS();
+}
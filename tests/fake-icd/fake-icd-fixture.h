@@ -0,0 +1,105 @@
+#ifndef FPGA_RUNTIME_TESTS_FAKE_ICD_FIXTURE_H_
+#define FPGA_RUNTIME_TESTS_FAKE_ICD_FIXTURE_H_
+
+#include <cstdint>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd.h"
+#include "frt.h"
+
+// Shared setup of the tests that run `fpga::Instance` on the fake ICD. Test
+// executables link `fake-icd-fixture`, which also provides their `main`.
+namespace fake_icd {
+
+// A kernel that adds `a` and `b` into `c`, all of `n` floats.
+extern const std::vector<KernelSpec> kVecAddKernels;
+void VecAdd(const std::vector<KernelArg>& args);
+
+// Returns whether `c` holds the sums of `a` and `b`, describing the first
+// mismatch otherwise.
+::testing::AssertionResult IsVecAddResult(const float* a, const float* b,
+                                          const float* c, uint64_t n);
+
+// Arguments of `VecAdd` on `n` elements, with inputs of small integers so
+// that the sums are exact, and an output that holds no sum yet.
+struct VecAddArgs {
+  explicit VecAddArgs(uint64_t n);
+
+  // Sets the arguments of `instance`, or invokes it, with `a` and `b` as
+  // inputs and `c` as the output.
+  void SetArgs(fpga::Instance& instance);
+  void Invoke(fpga::Instance& instance);
+
+  // Returns whether `c` holds the sums of `a` and `b`.
+  ::testing::AssertionResult IsResult() const;
+
+  uint64_t n;
+  std::vector<float> a;
+  std::vector<float> b;
+  std::vector<float> c;
+};
+
+// Durations reported by instances are device durations mapped to the host
+// clock by a fitted rate, which is refitted if a test runs for long, so they
+// are compared with the timing model within this tolerance.
+constexpr int64_t kDurationToleranceNs = 100;
+
+enum class Vendor { kXilinx, kIntel };
+
+// Returns a platform of `vendor` with one device.
+PlatformConfig MakePlatform(Vendor vendor);
+
+// Writes a bitstream of `kernels` for the device of `MakePlatform(vendor)`
+// and returns its path.
+std::string WriteBitstream(
+    Vendor vendor, const std::vector<KernelSpec>& kernels = kVecAddKernels);
+
+// Base of the tests, which resets the fake ICD before use.
+class FakeIcdTest : public ::testing::Test {
+ protected:
+  void TearDown() override;
+
+  // Replaces the platforms of the fake ICD with `platform` and registers
+  // `VecAdd`.
+  static void Reset(const PlatformConfig& platform);
+
+  // Points `TMPDIR` to a new directory until the test ends, so that runtime
+  // records of earlier runs are not seen, and returns the directory.
+  std::string UseCleanTmpdir();
+
+  // Invokes `VecAdd` on `n` elements in `bitstream`, checks the result, and
+  // returns the instance for inspection.
+  static fpga::Instance Run(const std::string& bitstream, uint64_t n);
+
+ private:
+  std::optional<std::string> old_tmpdir_;
+};
+
+// Runs each test on the Xilinx and on the Intel platform, which `SetUp`
+// resets to `platform_` with `VecAdd` in `bitstream_`.
+class FakeIcdPlatformTest : public FakeIcdTest,
+                            public ::testing::WithParamInterface<Vendor> {
+ protected:
+  void SetUp() override;
+
+  bool IsIntel() const { return GetParam() == Vendor::kIntel; }
+
+  PlatformConfig platform_;
+  std::string bitstream_;
+};
+
+// Parameters and names of the instantiations of `FakeIcdPlatformTest`, e.g.,
+// `INSTANTIATE_TEST_SUITE_P(AllVendors, FooTest, AllVendors(), VendorName)`.
+inline auto AllVendors() {
+  return ::testing::Values(Vendor::kXilinx, Vendor::kIntel);
+}
+std::string VendorName(const ::testing::TestParamInfo<Vendor>& info);
+
+}  // namespace fake_icd
+
+#endif  // FPGA_RUNTIME_TESTS_FAKE_ICD_FIXTURE_H_
@@ -0,0 +1,138 @@
+#include <cstdint>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+namespace fake_icd {
+namespace {
+
+using BasicTest = FakeIcdTest;
+
+TEST_F(BasicTest, Xilinx) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  auto device = platform.devices[0];
+  Reset(platform);
+
+  constexpr uint64_t n = 1 << 16;
+  auto instance = Run(WriteBitstream(Vendor::kXilinx), n);
+
+  // Inputs and outputs are migrated with one command each.
+  EXPECT_EQ(CountCalls("clEnqueueMigrateMemObjects"), 2);
+  EXPECT_EQ(CountCalls("clEnqueueNDRangeKernel"), 1);
+  EXPECT_NEAR(instance.LoadTimeNanoSeconds(),
+              H2dTimeNanoSeconds(device, 2 * n * sizeof(float)),
+              kDurationToleranceNs);
+  EXPECT_NEAR(instance.ComputeTimeNanoSeconds(),
+              device.launch_latency_ns + device.kernel_time_ns,
+              kDurationToleranceNs);
+  EXPECT_NEAR(instance.StoreTimeNanoSeconds(),
+              D2hTimeNanoSeconds(device, n * sizeof(float)),
+              kDurationToleranceNs);
+}
+
+TEST_F(BasicTest, Intel) {
+  auto platform = MakePlatform(Vendor::kIntel);
+  // Slow transfers keep host overhead between the writes off the timeline.
+  platform.devices[0].h2d_bandwidth = .1;
+  auto device = platform.devices[0];
+  Reset(platform);
+
+  constexpr uint64_t n = 1 << 16;
+  auto instance = Run(WriteBitstream(Vendor::kIntel), n);
+
+  // Each buffer is written or read separately on the same DMA engine.
+  EXPECT_EQ(CountCalls("clEnqueueWriteBuffer"), 2);
+  EXPECT_EQ(CountCalls("clEnqueueReadBuffer"), 1);
+  EXPECT_NEAR(instance.LoadTimeNanoSeconds(),
+              2 * H2dTimeNanoSeconds(device, n * sizeof(float)),
+              kDurationToleranceNs);
+  EXPECT_NEAR(instance.StoreTimeNanoSeconds(),
+              D2hTimeNanoSeconds(device, n * sizeof(float)),
+              kDurationToleranceNs);
+}
+
+TEST_F(BasicTest, IntelBanks) {
+  Reset(MakePlatform(Vendor::kIntel));
+
+  const auto bitstream = WriteTempFile(
+      "vadd.aocx", MakeAocx("fake_board", kVecAddKernels, /* banks = */ 2));
+  auto get_banks = [](const fpga::Instance& instance) {
+    std::vector<int> banks;
+    for (const auto& arg : instance.GetArgsInfo()) {
+      if (arg.cat == fpga::ArgInfo::kMmap) {
+        EXPECT_EQ(arg.memory, "DDR");
+        banks.push_back(arg.bank);
+      }
+    }
+    return banks;
+  };
+
+  // Buffers are interleaved across banks.
+  auto instance = Run(bitstream, 1 << 10);
+  EXPECT_EQ(get_banks(instance), std::vector<int>({0, 1, 0}));
+  std::vector<int> channels;
+  for (const auto& call : GetCalls()) {
+    if (call.name == "clCreateBuffer") {
+      channels.push_back((call.flags >> 16) & 7);
+    }
+  }
+  EXPECT_EQ(channels, std::vector<int>({1, 2, 1}));
+
+  // Users may choose banks.
+  constexpr uint64_t n = 1 << 10;
+  VecAddArgs vadd(n);
+  fpga::Instance hinted(bitstream);
+  hinted.SetBufferBank(2, 1);
+  vadd.SetArgs(hinted);
+  EXPECT_EQ(get_banks(hinted), std::vector<int>({0, 1, 1}));
+  EXPECT_THROW(hinted.SetBufferBank(2, 2), std::out_of_range);
+}
+
+TEST_F(BasicTest, HostMemory) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  auto device = platform.devices[0];
+  Reset(platform);
+
+  auto kernels = kVecAddKernels;
+  kernels[0].args[0].memory = "HOST";
+  kernels[0].args[1].memory = "HOST";
+  constexpr uint64_t n = 1 << 16;
+  auto instance = Run(WriteBitstream(Vendor::kXilinx, kernels), n);
+
+  // Inputs in host memory are not migrated.
+  EXPECT_EQ(CountCalls("clEnqueueMigrateMemObjects"), 1);
+  EXPECT_EQ(instance.LoadTimeNanoSeconds(), 0);
+  EXPECT_NEAR(instance.StoreTimeNanoSeconds(),
+              D2hTimeNanoSeconds(device, n * sizeof(float)),
+              kDurationToleranceNs);
+}
+
+TEST_F(BasicTest, Parallel) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  platform.devices[0].context_time_ns = 10'000'000;
+  platform.devices[0].program_time_ns = 10'000'000;
+  Reset(platform);
+
+  const auto bitstream = WriteBitstream(Vendor::kXilinx);
+
+  // Instances are constructed and run concurrently.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&bitstream, i] { Run(bitstream, 1 << (8 + i)); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(CountCalls("clEnqueueNDRangeKernel"), 8);
+}
+
+}  // namespace
+}  // namespace fake_icd
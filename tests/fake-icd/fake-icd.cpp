@@ -0,0 +1,1666 @@
+#include "fake-icd.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <elf.h>
+#include <unistd.h>
+
+#include <CL/cl.h>
+#include <CL/cl_ext.h>
+#include <xclbin.h>
+
+#ifndef XCL_MEM_EXT_HOST_ONLY
+#define XCL_MEM_EXT_HOST_ONLY (1 << 29)
+#endif  // XCL_MEM_EXT_HOST_ONLY
+#ifndef CL_CONTEXT_COMPILER_MODE_INTELFPGA
+#define CL_CONTEXT_COMPILER_MODE_INTELFPGA 0x40F0
+#endif  // CL_CONTEXT_COMPILER_MODE_INTELFPGA
+#ifndef CL_CONTEXT_COMPILER_MODE_PRELOADED_BINARY_ONLY_INTELFPGA
+#define CL_CONTEXT_COMPILER_MODE_PRELOADED_BINARY_ONLY_INTELFPGA 3
+#endif  // CL_CONTEXT_COMPILER_MODE_PRELOADED_BINARY_ONLY_INTELFPGA
+#ifndef CL_MEM_EXT_PTR_XILINX
+#define CL_MEM_EXT_PTR_XILINX (1u << 31)
+#endif  // CL_MEM_EXT_PTR_XILINX
+
+namespace {
+
+using fake_icd::DeviceConfig;
+using fake_icd::PlatformConfig;
+
+constexpr cl_int kPlatformNotFound = -1001;  // CL_PLATFORM_NOT_FOUND_KHR
+
+// Returns an xclbin section consisting of an `int32_t` count followed by
+// `items`, e.g., `mem_topology`.
+template <typename Section, typename Item>
+std::string MakeSection(const std::vector<Item>& items) {
+  // All such sections place the array right after the count, padded.
+  constexpr size_t kOffset = sizeof(Section) - sizeof(Item);
+  std::string section(kOffset + items.size() * sizeof(Item), '\0');
+  const int32_t count = items.size();
+  memcpy(&section[0], &count, sizeof(count));
+  memcpy(&section[kOffset], items.data(), items.size() * sizeof(Item));
+  return section;
+}
+
+int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Object {
+  virtual ~Object() = default;
+  std::atomic<int> refs{1};
+};
+
+template <typename T>
+cl_int Retain(T* obj) {
+  if (obj == nullptr) {
+    return CL_INVALID_VALUE;
+  }
+  ++obj->refs;
+  return CL_SUCCESS;
+}
+
+template <typename T>
+cl_int Release(T* obj) {
+  if (obj == nullptr) {
+    return CL_INVALID_VALUE;
+  }
+  if (--obj->refs == 0) {
+    delete obj;
+  }
+  return CL_SUCCESS;
+}
+
+// Keeps an object alive for as long as a command refers to it.
+template <typename T>
+std::shared_ptr<T> Hold(T* obj) {
+  Retain(obj);
+  return std::shared_ptr<T>(obj, [](T* obj) { Release(obj); });
+}
+
+}  // namespace
+
+struct _cl_platform_id {
+  PlatformConfig config;
+  std::vector<std::unique_ptr<_cl_device_id>> devices;
+};
+
+struct _cl_device_id {
+  DeviceConfig config;
+  cl_platform_id platform;
+  // Bitstream the device is configured with.
+  std::mutex mtx;
+  std::string binary;
+};
+
+struct _cl_context : Object {
+  cl_device_id device;
+  std::atomic<bool> has_program{false};
+  // Whether programs use the bitstream on the device without reconfiguring.
+  bool is_preloaded = false;
+};
+
+struct _cl_command_queue : Object {
+  ~_cl_command_queue() override { Release(context); }
+  cl_context context;
+  cl_device_id device;
+  cl_command_queue_properties properties;
+  cl_event last = nullptr;
+  // Commands that are enqueued but not complete yet.
+  std::unordered_set<cl_event> outstanding;
+};
+
+struct _cl_mem : Object {
+  ~_cl_mem() override;
+  char* Data() {
+    return parent      ? parent->Data() + origin
+           : host_only ? static_cast<char*>(host_ptr)
+                       : storage.data();
+  }
+  void* HostPtr() {
+    return parent ? static_cast<char*>(parent->HostPtr()) + origin : host_ptr;
+  }
+  cl_context context;
+  cl_mem_flags flags;
+  size_t size;
+  void* host_ptr = nullptr;
+  std::vector<char> storage;
+  cl_mem parent = nullptr;
+  size_t origin = 0;
+  // Host-only buffers have no device copy.
+  bool host_only = false;
+};
+
+struct _cl_program : Object {
+  ~_cl_program() override { Release(context); }
+  cl_context context;
+  cl_device_id device;
+  std::string binary;
+};
+
+struct _cl_kernel : Object {
+  struct Arg {
+    std::vector<char> value;
+    cl_mem mem = nullptr;
+  };
+  ~_cl_kernel() override { Release(program); }
+  cl_program program;
+  std::string name;
+  std::map<cl_uint, Arg> args;
+};
+
+struct _cl_event : Object {
+  using Callback = void(CL_CALLBACK*)(cl_event, cl_int, void*);
+  cl_context context = nullptr;
+  cl_command_queue queue = nullptr;
+  cl_command_type type;
+  cl_int status = CL_QUEUED;
+  int64_t queued = 0;
+  int64_t submit = 0;
+  int64_t start = 0;
+  int64_t end = 0;
+  std::vector<std::pair<Callback, void*>> callbacks;
+};
+
+namespace {
+
+struct Command {
+  cl_event event;
+  std::vector<cl_event> deps;
+  cl_device_id device;
+  std::string engine;
+  int64_t duration_ns;
+  std::function<void()> action;
+};
+
+struct KernelEntry {
+  fake_icd::KernelFunction function;
+  int64_t time_ns;
+};
+
+class Runtime {
+ public:
+  std::vector<cl_platform_id> Platforms() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<cl_platform_id> platforms;
+    for (auto& platform : platforms_) {
+      platforms.push_back(platform.get());
+    }
+    return platforms;
+  }
+
+  void Reset(const std::vector<PlatformConfig>& configs) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    // FRT may keep contexts across instances, so devices stay valid (and
+    // their IDs unique) after reset.
+    for (auto& platform : platforms_) {
+      retired_platforms_.push_back(std::move(platform));
+    }
+    platforms_.clear();
+    for (auto& config : configs) {
+      auto platform = std::make_unique<_cl_platform_id>();
+      platform->config = config;
+      for (auto& device_config : config.devices) {
+        auto device = std::make_unique<_cl_device_id>();
+        device->config = device_config;
+        device->platform = platform.get();
+        platform->devices.push_back(std::move(device));
+      }
+      platforms_.push_back(std::move(platform));
+    }
+    kernels_.clear();
+    engine_free_.clear();
+    finish_error_ = CL_SUCCESS;
+    ClearCalls();
+    std::lock_guard<std::mutex> registers_lock(registers_mtx_);
+    registers_.clear();
+  }
+
+  void RegisterKernel(const std::string& name, KernelEntry entry) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    kernels_[name] = std::move(entry);
+  }
+
+  void Record(const char* name, size_t bytes = 0, uint64_t flags = 0) {
+    std::lock_guard<std::mutex> lock(calls_mtx_);
+    calls_.push_back({name, bytes, flags});
+  }
+
+  std::vector<fake_icd::Call> GetCalls() {
+    std::lock_guard<std::mutex> lock(calls_mtx_);
+    return calls_;
+  }
+
+  void ClearCalls() {
+    std::lock_guard<std::mutex> lock(calls_mtx_);
+    calls_.clear();
+  }
+
+  void AddMem(cl_mem mem) {
+    std::lock_guard<std::mutex> lock(mems_mtx_);
+    mems_.insert(mem);
+  }
+
+  void RemoveMem(cl_mem mem) {
+    std::lock_guard<std::mutex> lock(mems_mtx_);
+    mems_.erase(mem);
+  }
+
+  bool IsMem(cl_mem mem) {
+    std::lock_guard<std::mutex> lock(mems_mtx_);
+    return mems_.count(mem) != 0;
+  }
+
+  cl_int Enqueue(cl_command_queue queue, cl_command_type type,
+                 std::string engine, int64_t duration_ns,
+                 std::function<void()> action, cl_uint num_events,
+                 const cl_event* wait_list, cl_event* event_out,
+                 bool blocking = false) {
+    if (queue == nullptr) {
+      return CL_INVALID_COMMAND_QUEUE;
+    }
+    if ((num_events == 0) != (wait_list == nullptr)) {
+      return CL_INVALID_EVENT_WAIT_LIST;
+    }
+    for (cl_uint i = 0; i < num_events; ++i) {
+      if (wait_list[i] == nullptr) {
+        return CL_INVALID_EVENT_WAIT_LIST;
+      }
+    }
+    auto event = new _cl_event;
+    event->context = queue->context;
+    event->queue = queue;
+    event->type = type;
+    event->queued = Now();
+
+    Command command;
+    command.event = event;
+    command.device = queue->device;
+    command.engine = std::move(engine);
+    command.duration_ns = duration_ns;
+    command.action = std::move(action);
+    for (cl_uint i = 0; i < num_events; ++i) {
+      Retain(wait_list[i]);
+      command.deps.push_back(wait_list[i]);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      // A marker without a wait list waits for everything before it.
+      if (type == CL_COMMAND_MARKER && num_events == 0) {
+        for (auto outstanding : queue->outstanding) {
+          Retain(outstanding);
+          command.deps.push_back(outstanding);
+        }
+      }
+      if (!(queue->properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)) {
+        if (queue->last != nullptr) {
+          command.deps.push_back(queue->last);
+        }
+        Retain(event);
+        queue->last = event;
+      }
+      Retain(queue);
+      queue->outstanding.insert(event);
+      if (event_out != nullptr) {
+        Retain(event);
+        *event_out = event;
+      }
+      if (blocking) {
+        Retain(event);
+      }
+      pending_.push_back(std::move(command));
+      if (!thread_.joinable()) {
+        thread_ = std::thread(&Runtime::Run, this);
+      }
+    }
+    cv_.notify_all();
+
+    if (blocking) {
+      cl_int err = WaitForEvents(1, &event);
+      Release(event);
+      return err;
+    }
+    return CL_SUCCESS;
+  }
+
+  cl_event CreateUserEvent(cl_context context) {
+    auto event = new _cl_event;
+    event->context = context;
+    event->type = CL_COMMAND_USER;
+    event->status = CL_SUBMITTED;
+    event->queued = event->submit = Now();
+    return event;
+  }
+
+  cl_int SetUserEventStatus(cl_event event, cl_int status) {
+    if (event == nullptr || event->type != CL_COMMAND_USER) {
+      return CL_INVALID_EVENT;
+    }
+    if (status > CL_COMPLETE) {
+      return CL_INVALID_VALUE;
+    }
+    std::vector<std::pair<_cl_event::Callback, void*>> callbacks;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (event->status <= CL_COMPLETE) {
+        return CL_INVALID_OPERATION;
+      }
+      event->status = status;
+      event->start = event->end = Now();
+      callbacks.swap(event->callbacks);
+    }
+    cv_.notify_all();
+    done_cv_.notify_all();
+    for (auto& [callback, data] : callbacks) {
+      callback(event, status, data);
+    }
+    return CL_SUCCESS;
+  }
+
+  cl_int SetEventCallback(cl_event event, _cl_event::Callback callback,
+                          void* data) {
+    cl_int status;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      status = event->status;
+      if (status > CL_COMPLETE) {
+        event->callbacks.emplace_back(callback, data);
+        return CL_SUCCESS;
+      }
+    }
+    callback(event, status, data);
+    return CL_SUCCESS;
+  }
+
+  cl_int WaitForEvents(cl_uint num_events, const cl_event* events) {
+    if (num_events == 0 || events == nullptr) {
+      return CL_INVALID_VALUE;
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    done_cv_.wait(lock, [&] {
+      for (cl_uint i = 0; i < num_events; ++i) {
+        if (events[i]->status > CL_COMPLETE) {
+          return false;
+        }
+      }
+      return true;
+    });
+    for (cl_uint i = 0; i < num_events; ++i) {
+      if (events[i]->status < 0) {
+        return CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST;
+      }
+    }
+    return CL_SUCCESS;
+  }
+
+  cl_int Finish(cl_command_queue queue) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    done_cv_.wait(lock, [&] { return queue->outstanding.empty(); });
+    return finish_error_;
+  }
+
+  void SetFinishError(cl_int error) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    finish_error_ = error;
+  }
+
+  cl_int GetStatus(cl_event event) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return event->status;
+  }
+
+  cl_int GetProfilingInfo(cl_event event, cl_profiling_info name,
+                          cl_ulong* value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (event->queue == nullptr ||
+        !(event->queue->properties & CL_QUEUE_PROFILING_ENABLE) ||
+        event->status != CL_COMPLETE) {
+      return CL_PROFILING_INFO_NOT_AVAILABLE;
+    }
+    const DeviceConfig& device = event->queue->device->config;
+    auto to_device_time = [&device](int64_t time) {
+      return device.clock_offset_ns + std::llround(time * device.clock_rate);
+    };
+    switch (name) {
+      case CL_PROFILING_COMMAND_QUEUED:
+        *value = to_device_time(event->queued);
+        return CL_SUCCESS;
+      case CL_PROFILING_COMMAND_SUBMIT:
+        *value = to_device_time(event->submit);
+        return CL_SUCCESS;
+      case CL_PROFILING_COMMAND_START:
+        *value = to_device_time(event->start);
+        return CL_SUCCESS;
+      case CL_PROFILING_COMMAND_END:
+        *value = to_device_time(event->end);
+        return CL_SUCCESS;
+    }
+    return CL_INVALID_VALUE;
+  }
+
+  void SetRegister(unsigned ip_index, uint32_t offset, uint32_t value) {
+    std::lock_guard<std::mutex> lock(registers_mtx_);
+    registers_[{ip_index, offset}] = value;
+  }
+
+  uint32_t GetRegister(unsigned ip_index, uint32_t offset) {
+    std::lock_guard<std::mutex> lock(registers_mtx_);
+    auto it = registers_.find({ip_index, offset});
+    return it == registers_.end() ? 0 : it->second;
+  }
+
+  std::pair<fake_icd::KernelFunction, int64_t> GetKernel(
+      const std::string& name, const DeviceConfig& device) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = kernels_.find(name);
+    if (it == kernels_.end()) {
+      return {nullptr, device.kernel_time_ns};
+    }
+    return {it->second.function, it->second.time_ns < 0
+                                     ? device.kernel_time_ns
+                                     : it->second.time_ns};
+  }
+
+ private:
+  // Timer thread that starts commands once their dependencies are complete
+  // and completes them once their modeled end time has passed.
+  void Run() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (;;) {
+      for (auto it = pending_.begin(); it != pending_.end();) {
+        bool ready = true;
+        int64_t ready_time = it->event->queued;
+        for (auto dep : it->deps) {
+          if (dep->status > CL_COMPLETE) {
+            ready = false;
+            break;
+          }
+          ready_time = std::max(ready_time, dep->end);
+        }
+        if (!ready) {
+          ++it;
+          continue;
+        }
+        int64_t start = ready_time;
+        if (!it->engine.empty()) {
+          auto& engine_free = engine_free_[{it->device, it->engine}];
+          start = std::max(start, engine_free);
+          engine_free = start + it->duration_ns;
+        }
+        it->event->submit = ready_time;
+        it->event->start = start;
+        it->event->end = start + it->duration_ns;
+        it->event->status = CL_RUNNING;
+        running_.push_back(std::move(*it));
+        it = pending_.erase(it);
+      }
+
+      const int64_t now = Now();
+      int64_t next = std::numeric_limits<int64_t>::max();
+      std::vector<Command> completed;
+      for (auto it = running_.begin(); it != running_.end();) {
+        if (it->event->end <= now) {
+          completed.push_back(std::move(*it));
+          it = running_.erase(it);
+        } else {
+          next = std::min(next, it->event->end);
+          ++it;
+        }
+      }
+
+      if (!completed.empty()) {
+        std::vector<std::pair<cl_event, decltype(_cl_event::callbacks)>>
+            callbacks;
+        for (auto& command : completed) {
+          cl_int status = CL_COMPLETE;
+          for (auto dep : command.deps) {
+            if (dep->status < 0) {
+              status = dep->status;
+            }
+          }
+          if (status == CL_COMPLETE && command.action) {
+            command.action();
+          }
+          command.event->status = status;
+          callbacks.emplace_back(command.event,
+                                 std::move(command.event->callbacks));
+        }
+        done_cv_.notify_all();
+        lock.unlock();
+        for (auto& [event, event_callbacks] : callbacks) {
+          for (auto& [callback, data] : event_callbacks) {
+            callback(event, event->status, data);
+          }
+        }
+        for (auto& command : completed) {
+          for (auto dep : command.deps) {
+            Release(dep);
+          }
+          auto queue = command.event->queue;
+          {
+            std::lock_guard<std::mutex> queue_lock(mtx_);
+            if (queue->last == command.event) {
+              queue->last = nullptr;
+              Release(command.event);
+            }
+            queue->outstanding.erase(command.event);
+          }
+          done_cv_.notify_all();
+          Release(command.event);
+          Release(queue);
+        }
+        completed.clear();
+        lock.lock();
+        continue;
+      }
+
+      if (next != std::numeric_limits<int64_t>::max()) {
+        cv_.wait_until(lock, std::chrono::steady_clock::time_point(
+                                 std::chrono::nanoseconds(next)));
+      } else {
+        cv_.wait(lock);
+      }
+    }
+  }
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  std::vector<std::unique_ptr<_cl_platform_id>> platforms_;
+  std::vector<std::unique_ptr<_cl_platform_id>> retired_platforms_;
+  std::unordered_map<std::string, KernelEntry> kernels_;
+  std::list<Command> pending_;
+  std::list<Command> running_;
+  std::map<std::pair<cl_device_id, std::string>, int64_t> engine_free_;
+  cl_int finish_error_ = CL_SUCCESS;
+  std::thread thread_;
+
+  std::mutex calls_mtx_;
+  std::vector<fake_icd::Call> calls_;
+
+  std::mutex mems_mtx_;
+  std::unordered_set<cl_mem> mems_;
+
+  // Control registers keyed by IP index and offset.
+  std::mutex registers_mtx_;
+  std::map<std::pair<unsigned, uint32_t>, uint32_t> registers_;
+};
+
+// Never destroyed so that the timer thread may outlive `main`.
+Runtime& GetRuntime() {
+  static auto runtime = new Runtime;
+  return *runtime;
+}
+
+cl_int ReturnInfo(const void* data, size_t size, size_t param_value_size,
+                  void* param_value, size_t* param_value_size_ret) {
+  if (param_value != nullptr) {
+    if (param_value_size < size) {
+      return CL_INVALID_VALUE;
+    }
+    memcpy(param_value, data, size);
+  }
+  if (param_value_size_ret != nullptr) {
+    *param_value_size_ret = size;
+  }
+  return CL_SUCCESS;
+}
+
+cl_int ReturnString(const std::string& value, size_t param_value_size,
+                    void* param_value, size_t* param_value_size_ret) {
+  return ReturnInfo(value.c_str(), value.size() + 1, param_value_size,
+                    param_value, param_value_size_ret);
+}
+
+template <typename T>
+cl_int ReturnValue(const T& value, size_t param_value_size, void* param_value,
+                   size_t* param_value_size_ret) {
+  return ReturnInfo(&value, sizeof(value), param_value_size, param_value,
+                    param_value_size_ret);
+}
+
+void SetError(cl_int* errcode_ret, cl_int err) {
+  if (errcode_ret != nullptr) {
+    *errcode_ret = err;
+  }
+}
+
+void SleepNanoSeconds(int64_t ns) {
+  if (ns > 0) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+  }
+}
+
+}  // namespace
+
+_cl_mem::~_cl_mem() {
+  GetRuntime().RemoveMem(this);
+  Release(parent);
+  Release(context);
+}
+
+namespace fake_icd {
+
+PlatformConfig XilinxPlatform(const std::string& device_name) {
+  PlatformConfig platform;
+  platform.name = "Xilinx";
+  platform.devices.emplace_back();
+  platform.devices.back().name = device_name;
+  return platform;
+}
+
+PlatformConfig IntelPlatform(const std::string& board_name) {
+  PlatformConfig platform;
+  platform.name = "Intel(R) FPGA SDK for OpenCL(TM)";
+  platform.devices.emplace_back();
+  platform.devices.back().name = board_name + " : Fake Board (acl0)";
+  return platform;
+}
+
+void Reset(const std::vector<PlatformConfig>& platforms) {
+  GetRuntime().Reset(platforms);
+}
+
+void RegisterKernel(const std::string& name, KernelFunction function,
+                    int64_t time_ns) {
+  GetRuntime().RegisterKernel(name, {std::move(function), time_ns});
+}
+
+std::vector<Call> GetCalls() { return GetRuntime().GetCalls(); }
+
+size_t CountCalls(const std::string& name) {
+  auto calls = GetCalls();
+  return std::count_if(calls.begin(), calls.end(),
+                       [&](const Call& call) { return call.name == name; });
+}
+
+void ClearCalls() { GetRuntime().ClearCalls(); }
+
+void SetRegister(unsigned ip_index, uint32_t offset, uint32_t value) {
+  GetRuntime().SetRegister(ip_index, offset, value);
+}
+
+void SetFinishError(cl_int error) { GetRuntime().SetFinishError(error); }
+
+int64_t H2dTimeNanoSeconds(const DeviceConfig& device, size_t bytes) {
+  return device.transfer_latency_ns +
+         static_cast<int64_t>(static_cast<double>(bytes) /
+                              device.h2d_bandwidth);
+}
+
+int64_t D2hTimeNanoSeconds(const DeviceConfig& device, size_t bytes) {
+  return device.transfer_latency_ns +
+         static_cast<int64_t>(static_cast<double>(bytes) /
+                              device.d2h_bandwidth);
+}
+
+std::string MakeXclbin(const std::string& platform_vbnv,
+                       const std::vector<KernelSpec>& kernels,
+                       const std::string& target, bool partial) {
+  std::string xml =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+      "<project name=\"fake\"><platform><device><core target=\"" +
+      target + "\">";
+  for (auto& kernel : kernels) {
+    xml += "<kernel name=\"" + kernel.name + "\">";
+    int id = 0;
+    // Control registers of arguments follow the HLS layout.
+    for (auto& arg : kernel.args) {
+      xml += "<arg name=\"" + arg.name + "\" addressQualifier=\"" +
+             std::to_string(arg.cat) + "\" id=\"" + std::to_string(id) +
+             "\" offset=\"" + std::to_string(0x10 + 8 * id) + "\" type=\"" +
+             arg.type + "\"/>";
+      ++id;
+    }
+    xml += "</kernel>";
+  }
+  xml += "</core></device></platform></project>";
+  // `XilinxOpenclDevice` parses the metadata as a C string.
+  xml.push_back('\0');
+
+  // Memory-mapped arguments are connected to DDR unless specified otherwise.
+  std::vector<mem_data> mems(2);
+  memset(mems.data(), 0, mems.size() * sizeof(mem_data));
+  mems[0].m_type = MEM_DDR4;
+  mems[0].m_used = 1;
+  strcpy(reinterpret_cast<char*>(mems[0].m_tag), "DDR[0]");
+  mems[1].m_type = MEM_DDR4;
+  mems[1].m_used = 1;
+  strcpy(reinterpret_cast<char*>(mems[1].m_tag), "HOST[0]");
+  std::vector<ip_data> ips(kernels.size());
+  memset(ips.data(), 0, ips.size() * sizeof(ip_data));
+  std::vector<connection> connections;
+  for (int i = 0; i < kernels.size(); ++i) {
+    ips[i].m_type = IP_KERNEL;
+    strncpy(reinterpret_cast<char*>(ips[i].m_name),
+            (kernels[i].name + ":" + kernels[i].name + "_1").c_str(),
+            sizeof(ips[i].m_name) - 1);
+    for (int j = 0; j < kernels[i].args.size(); ++j) {
+      if (kernels[i].args[j].cat == ArgSpec::kMmap) {
+        connections.push_back({j, i, kernels[i].args[j].memory == "HOST"});
+      }
+    }
+  }
+
+  const std::vector<std::pair<axlf_section_kind, std::string>> sections = {
+      {EMBEDDED_METADATA, xml},
+      {MEM_TOPOLOGY, MakeSection<mem_topology>(mems)},
+      {IP_LAYOUT, MakeSection<ip_layout>(ips)},
+      {CONNECTIVITY, MakeSection<connectivity>(connections)},
+  };
+  std::string xclbin(offsetof(axlf, m_sections) +
+                         sections.size() * sizeof(axlf_section_header),
+                     '\0');
+  std::vector<axlf_section_header> headers(sections.size());
+  for (size_t i = 0; i < sections.size(); ++i) {
+    xclbin.resize((xclbin.size() + 7) / 8 * 8);
+    headers[i] = {};
+    headers[i].m_sectionKind = sections[i].first;
+    headers[i].m_sectionOffset = xclbin.size();
+    headers[i].m_sectionSize = sections[i].second.size();
+    xclbin += sections[i].second;
+  }
+  auto top = reinterpret_cast<axlf*>(&xclbin[0]);
+  memcpy(top->m_magic, "xclbin2", 8);
+  top->m_header.m_length = xclbin.size();
+  top->m_header.m_mode = target == "hw_em"  ? XCLBIN_HW_EMU
+                         : target == "csim" ? XCLBIN_SW_EMU
+                         : partial          ? XCLBIN_PR
+                                            : XCLBIN_FLAT;
+  strncpy(reinterpret_cast<char*>(top->m_header.m_platformVBNV),
+          platform_vbnv.c_str(), sizeof(top->m_header.m_platformVBNV) - 1);
+  top->m_header.m_numSections = sections.size();
+  memcpy(top->m_sections, headers.data(),
+         headers.size() * sizeof(axlf_section_header));
+  return xclbin;
+}
+
+std::string MakeAocx(const std::string& board_name,
+                     const std::vector<KernelSpec>& kernels, int banks) {
+  std::string xml = "<board>";
+  for (auto& kernel : kernels) {
+    xml += "<kernel name=\"" + kernel.name + "\">";
+    for (auto& arg : kernel.args) {
+      xml += "<argument name=\"" + arg.name + "\" type_name=\"" + arg.type +
+             "\" opencl_access_type=\"" +
+             (arg.cat == ArgSpec::kMmap ? "2" : "0") + "\" buffer_location=\"" +
+             (arg.cat == ArgSpec::kMmap ? arg.memory : "") + "\"/>";
+    }
+    xml += "</kernel>";
+  }
+  xml += "</board>";
+  xml.push_back('\0');
+
+  std::string board_spec = "<board name=\"" + board_name + "\">";
+  board_spec += "<global_mem name=\"DDR\" default=\"1\">";
+  for (int i = 0; i < banks; ++i) {
+    board_spec += "<interface name=\"board\" port=\"kernel_mem" +
+                  std::to_string(i) + "\"/>";
+  }
+  board_spec += "</global_mem></board>";
+  board_spec.push_back('\0');
+
+  const std::vector<std::pair<std::string, std::string>> sections = {
+      {"", ""},
+      {".shstrtab", ""},
+      {".acl.kernel_arg_info.xml", xml},
+      {".acl.board", board_name},
+      {".acl.board_spec.xml", board_spec},
+  };
+  std::string shstrtab;
+  std::vector<Elf32_Shdr> headers(sections.size());
+  for (size_t i = 0; i < sections.size(); ++i) {
+    headers[i] = {};
+    headers[i].sh_name = shstrtab.size();
+    shstrtab += sections[i].first;
+    shstrtab.push_back('\0');
+  }
+
+  std::string aocx(sizeof(Elf32_Ehdr), '\0');
+  for (size_t i = 1; i < sections.size(); ++i) {
+    const std::string& content = i == 1 ? shstrtab : sections[i].second;
+    headers[i].sh_type = i == 1 ? SHT_STRTAB : SHT_PROGBITS;
+    headers[i].sh_offset = aocx.size();
+    headers[i].sh_size = content.size();
+    aocx += content;
+  }
+  aocx.resize((aocx.size() + 3) / 4 * 4, '\0');
+
+  Elf32_Ehdr elf_header = {};
+  memcpy(elf_header.e_ident, ELFMAG, SELFMAG);
+  elf_header.e_ident[EI_CLASS] = ELFCLASS32;
+  elf_header.e_ident[EI_DATA] = ELFDATA2LSB;
+  elf_header.e_ident[EI_VERSION] = EV_CURRENT;
+  elf_header.e_type = ET_REL;
+  elf_header.e_version = EV_CURRENT;
+  elf_header.e_ehsize = sizeof(Elf32_Ehdr);
+  elf_header.e_shoff = aocx.size();
+  elf_header.e_shentsize = sizeof(Elf32_Shdr);
+  elf_header.e_shnum = sections.size();
+  elf_header.e_shstrndx = 1;
+  memcpy(&aocx[0], &elf_header, sizeof(elf_header));
+  aocx.append(reinterpret_cast<const char*>(headers.data()),
+              headers.size() * sizeof(Elf32_Shdr));
+  return aocx;
+}
+
+std::string WriteTempFile(const std::string& name,
+                          const std::string& content) {
+  const char* tmpdir = getenv("TMPDIR");
+  std::string dir = std::string(tmpdir ? tmpdir : "/tmp") + "/fake-icd.XXXXXX";
+  if (mkdtemp(&dir[0]) == nullptr) {
+    throw std::runtime_error("cannot create temporary directory");
+  }
+  std::string path = dir + "/" + name;
+  std::ofstream(path, std::ios::binary).write(content.data(), content.size());
+  return path;
+}
+
+}  // namespace fake_icd
+
+extern "C" {
+
+cl_int CL_API_CALL clGetPlatformIDs(cl_uint num_entries,
+                                    cl_platform_id* platforms,
+                                    cl_uint* num_platforms) {
+  GetRuntime().Record(__func__);
+  if ((num_entries == 0 && platforms != nullptr) ||
+      (platforms == nullptr && num_platforms == nullptr)) {
+    return CL_INVALID_VALUE;
+  }
+  auto all_platforms = GetRuntime().Platforms();
+  if (all_platforms.empty()) {
+    return kPlatformNotFound;
+  }
+  if (num_platforms != nullptr) {
+    *num_platforms = all_platforms.size();
+  }
+  for (cl_uint i = 0; platforms != nullptr && i < num_entries &&
+                      i < all_platforms.size();
+       ++i) {
+    platforms[i] = all_platforms[i];
+  }
+  return CL_SUCCESS;
+}
+
+cl_int CL_API_CALL clGetPlatformInfo(cl_platform_id platform,
+                                     cl_platform_info param_name,
+                                     size_t param_value_size,
+                                     void* param_value,
+                                     size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (platform == nullptr) {
+    return CL_INVALID_PLATFORM;
+  }
+  switch (param_name) {
+    case CL_PLATFORM_NAME:
+    case CL_PLATFORM_VENDOR:
+      return ReturnString(platform->config.name, param_value_size,
+                          param_value, param_value_size_ret);
+    case CL_PLATFORM_PROFILE:
+      return ReturnString("EMBEDDED_PROFILE", param_value_size, param_value,
+                          param_value_size_ret);
+    case CL_PLATFORM_VERSION:
+      return ReturnString("OpenCL 1.2 Fake", param_value_size, param_value,
+                          param_value_size_ret);
+    case CL_PLATFORM_EXTENSIONS:
+      return ReturnString("", param_value_size, param_value,
+                          param_value_size_ret);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_int CL_API_CALL clGetDeviceIDs(cl_platform_id platform,
+                                  cl_device_type device_type,
+                                  cl_uint num_entries, cl_device_id* devices,
+                                  cl_uint* num_devices) {
+  GetRuntime().Record(__func__);
+  if (platform == nullptr) {
+    return CL_INVALID_PLATFORM;
+  }
+  if (!(device_type & CL_DEVICE_TYPE_ACCELERATOR) ||
+      platform->devices.empty()) {
+    return CL_DEVICE_NOT_FOUND;
+  }
+  if (num_devices != nullptr) {
+    *num_devices = platform->devices.size();
+  }
+  for (cl_uint i = 0; devices != nullptr && i < num_entries &&
+                      i < platform->devices.size();
+       ++i) {
+    devices[i] = platform->devices[i].get();
+  }
+  return CL_SUCCESS;
+}
+
+cl_int CL_API_CALL clGetDeviceInfo(cl_device_id device,
+                                   cl_device_info param_name,
+                                   size_t param_value_size, void* param_value,
+                                   size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (device == nullptr) {
+    return CL_INVALID_DEVICE;
+  }
+  switch (param_name) {
+    case CL_DEVICE_NAME:
+      return ReturnString(device->config.name, param_value_size, param_value,
+                          param_value_size_ret);
+    case CL_DEVICE_VENDOR:
+      return ReturnString(device->platform->config.name, param_value_size,
+                          param_value, param_value_size_ret);
+    case CL_DEVICE_VERSION:
+      return ReturnString("OpenCL 1.2 Fake", param_value_size, param_value,
+                          param_value_size_ret);
+    case CL_DEVICE_TYPE:
+      return ReturnValue<cl_device_type>(CL_DEVICE_TYPE_ACCELERATOR,
+                                         param_value_size, param_value,
+                                         param_value_size_ret);
+    case CL_DEVICE_PLATFORM:
+      return ReturnValue(device->platform, param_value_size, param_value,
+                         param_value_size_ret);
+    case CL_DEVICE_AVAILABLE:
+      return ReturnValue<cl_bool>(CL_TRUE, param_value_size, param_value,
+                                  param_value_size_ret);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_int CL_API_CALL clRetainDevice(cl_device_id device) {
+  return device == nullptr ? CL_INVALID_DEVICE : CL_SUCCESS;
+}
+
+cl_int CL_API_CALL clReleaseDevice(cl_device_id device) {
+  return device == nullptr ? CL_INVALID_DEVICE : CL_SUCCESS;
+}
+
+cl_context CL_API_CALL clCreateContext(
+    const cl_context_properties* properties, cl_uint num_devices,
+    const cl_device_id* devices,
+    void(CL_CALLBACK* pfn_notify)(const char*, const void*, size_t, void*),
+    void* user_data, cl_int* errcode_ret) {
+  GetRuntime().Record(__func__);
+  if (num_devices != 1 || devices == nullptr || devices[0] == nullptr) {
+    SetError(errcode_ret, CL_INVALID_DEVICE);
+    return nullptr;
+  }
+  SleepNanoSeconds(devices[0]->config.context_time_ns);
+  auto context = new _cl_context;
+  context->device = devices[0];
+  for (auto property = properties; property != nullptr && property[0] != 0;
+       property += 2) {
+    if (property[0] == CL_CONTEXT_COMPILER_MODE_INTELFPGA) {
+      context->is_preloaded =
+          property[1] ==
+          CL_CONTEXT_COMPILER_MODE_PRELOADED_BINARY_ONLY_INTELFPGA;
+    }
+  }
+  SetError(errcode_ret, CL_SUCCESS);
+  return context;
+}
+
+cl_int CL_API_CALL clRetainContext(cl_context context) {
+  return Retain(context);
+}
+
+cl_int CL_API_CALL clReleaseContext(cl_context context) {
+  return Release(context);
+}
+
+cl_int CL_API_CALL clGetContextInfo(cl_context context,
+                                    cl_context_info param_name,
+                                    size_t param_value_size, void* param_value,
+                                    size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (context == nullptr) {
+    return CL_INVALID_CONTEXT;
+  }
+  if (param_name == CL_CONTEXT_DEVICES) {
+    return ReturnValue(context->device, param_value_size, param_value,
+                       param_value_size_ret);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_command_queue CL_API_CALL clCreateCommandQueue(
+    cl_context context, cl_device_id device,
+    cl_command_queue_properties properties, cl_int* errcode_ret) {
+  GetRuntime().Record(__func__);
+  if (context == nullptr) {
+    SetError(errcode_ret, CL_INVALID_CONTEXT);
+    return nullptr;
+  }
+  if (device != context->device) {
+    SetError(errcode_ret, CL_INVALID_DEVICE);
+    return nullptr;
+  }
+  auto queue = new _cl_command_queue;
+  Retain(context);
+  queue->context = context;
+  queue->device = device;
+  queue->properties = properties;
+  SetError(errcode_ret, CL_SUCCESS);
+  return queue;
+}
+
+cl_int CL_API_CALL clRetainCommandQueue(cl_command_queue queue) {
+  return Retain(queue);
+}
+
+cl_int CL_API_CALL clReleaseCommandQueue(cl_command_queue queue) {
+  return Release(queue);
+}
+
+cl_mem CL_API_CALL clCreateBuffer(cl_context context, cl_mem_flags flags,
+                                  size_t size, void* host_ptr,
+                                  cl_int* errcode_ret) {
+  GetRuntime().Record(__func__, size, flags);
+  if (context == nullptr) {
+    SetError(errcode_ret, CL_INVALID_CONTEXT);
+    return nullptr;
+  }
+  if (size == 0) {
+    SetError(errcode_ret, CL_INVALID_BUFFER_SIZE);
+    return nullptr;
+  }
+  bool host_only = false;
+  if (flags & CL_MEM_EXT_PTR_XILINX) {
+    if (host_ptr == nullptr) {
+      SetError(errcode_ret, CL_INVALID_HOST_PTR);
+      return nullptr;
+    }
+    auto ext = static_cast<const cl_mem_ext_ptr_t*>(host_ptr);
+    host_only = ext->flags & XCL_MEM_EXT_HOST_ONLY;
+    host_ptr = ext->obj;
+  }
+  const bool needs_host_ptr =
+      flags & (CL_MEM_USE_HOST_PTR | CL_MEM_COPY_HOST_PTR);
+  if (needs_host_ptr != (host_ptr != nullptr) ||
+      (host_only && !(flags & CL_MEM_USE_HOST_PTR))) {
+    SetError(errcode_ret, CL_INVALID_HOST_PTR);
+    return nullptr;
+  }
+  auto mem = new _cl_mem;
+  Retain(context);
+  mem->context = context;
+  mem->flags = flags;
+  mem->size = size;
+  mem->host_only = host_only;
+  if (!host_only) {
+    mem->storage.resize(size);
+  }
+  if (flags & CL_MEM_USE_HOST_PTR) {
+    mem->host_ptr = host_ptr;
+  }
+  if (flags & CL_MEM_COPY_HOST_PTR) {
+    memcpy(mem->storage.data(), host_ptr, size);
+  }
+  GetRuntime().AddMem(mem);
+  SetError(errcode_ret, CL_SUCCESS);
+  return mem;
+}
+
+cl_mem CL_API_CALL clCreateSubBuffer(cl_mem buffer, cl_mem_flags flags,
+                                     cl_buffer_create_type buffer_create_type,
+                                     const void* buffer_create_info,
+                                     cl_int* errcode_ret) {
+  GetRuntime().Record(__func__);
+  if (buffer == nullptr || buffer->parent != nullptr) {
+    SetError(errcode_ret, CL_INVALID_MEM_OBJECT);
+    return nullptr;
+  }
+  auto region = static_cast<const cl_buffer_region*>(buffer_create_info);
+  if (buffer_create_type != CL_BUFFER_CREATE_TYPE_REGION ||
+      region == nullptr || region->size == 0 ||
+      region->origin + region->size > buffer->size) {
+    SetError(errcode_ret, CL_INVALID_VALUE);
+    return nullptr;
+  }
+  auto mem = new _cl_mem;
+  Retain(buffer->context);
+  Retain(buffer);
+  mem->context = buffer->context;
+  mem->flags = flags ? flags : buffer->flags;
+  mem->size = region->size;
+  mem->parent = buffer;
+  mem->origin = region->origin;
+  GetRuntime().AddMem(mem);
+  SetError(errcode_ret, CL_SUCCESS);
+  return mem;
+}
+
+cl_int CL_API_CALL clRetainMemObject(cl_mem mem) { return Retain(mem); }
+
+cl_int CL_API_CALL clReleaseMemObject(cl_mem mem) { return Release(mem); }
+
+cl_int CL_API_CALL clGetMemObjectInfo(cl_mem mem, cl_mem_info param_name,
+                                      size_t param_value_size,
+                                      void* param_value,
+                                      size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (mem == nullptr) {
+    return CL_INVALID_MEM_OBJECT;
+  }
+  switch (param_name) {
+    case CL_MEM_SIZE:
+      return ReturnValue(mem->size, param_value_size, param_value,
+                         param_value_size_ret);
+    case CL_MEM_FLAGS:
+      return ReturnValue(mem->flags, param_value_size, param_value,
+                         param_value_size_ret);
+    case CL_MEM_HOST_PTR:
+      return ReturnValue(mem->HostPtr(), param_value_size, param_value,
+                         param_value_size_ret);
+    case CL_MEM_CONTEXT:
+      return ReturnValue(mem->context, param_value_size, param_value,
+                         param_value_size_ret);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_program CL_API_CALL clCreateProgramWithBinary(
+    cl_context context, cl_uint num_devices, const cl_device_id* device_list,
+    const size_t* lengths, const unsigned char** binaries,
+    cl_int* binary_status, cl_int* errcode_ret) {
+  GetRuntime().Record(__func__);
+  if (context == nullptr) {
+    SetError(errcode_ret, CL_INVALID_CONTEXT);
+    return nullptr;
+  }
+  if (num_devices != 1 || device_list == nullptr ||
+      device_list[0] != context->device) {
+    SetError(errcode_ret, CL_INVALID_DEVICE);
+    return nullptr;
+  }
+  if (lengths == nullptr || binaries == nullptr || lengths[0] == 0 ||
+      binaries[0] == nullptr) {
+    if (binary_status != nullptr) {
+      binary_status[0] = CL_INVALID_VALUE;
+    }
+    SetError(errcode_ret, CL_INVALID_VALUE);
+    return nullptr;
+  }
+  const auto top = reinterpret_cast<const axlf*>(binaries[0]);
+  const bool is_partial = lengths[0] >= sizeof(axlf) &&
+                          memcmp(top->m_magic, "xclbin2", 8) == 0 &&
+                          top->m_header.m_mode == XCLBIN_PR;
+  const auto& config = context->device->config;
+  const std::string binary(reinterpret_cast<const char*>(binaries[0]),
+                           lengths[0]);
+  {
+    std::lock_guard<std::mutex> lock(context->device->mtx);
+    if (context->is_preloaded) {
+      if (context->device->binary != binary) {
+        if (binary_status != nullptr) {
+          binary_status[0] = CL_INVALID_BINARY;
+        }
+        SetError(errcode_ret, CL_INVALID_BINARY);
+        return nullptr;
+      }
+    } else {
+      context->device->binary = binary;
+    }
+  }
+  if (!context->is_preloaded) {
+    SleepNanoSeconds(is_partial && context->has_program.exchange(true)
+                         ? config.partial_program_time_ns
+                         : config.program_time_ns);
+  }
+  context->has_program = true;
+  auto program = new _cl_program;
+  Retain(context);
+  program->context = context;
+  program->device = context->device;
+  program->binary = binary;
+  if (binary_status != nullptr) {
+    binary_status[0] = CL_SUCCESS;
+  }
+  SetError(errcode_ret, CL_SUCCESS);
+  return program;
+}
+
+cl_int CL_API_CALL clRetainProgram(cl_program program) {
+  return Retain(program);
+}
+
+cl_int CL_API_CALL clReleaseProgram(cl_program program) {
+  return Release(program);
+}
+
+cl_int CL_API_CALL clBuildProgram(cl_program program, cl_uint num_devices,
+                                  const cl_device_id* device_list,
+                                  const char* options,
+                                  void(CL_CALLBACK* pfn_notify)(cl_program,
+                                                                void*),
+                                  void* user_data) {
+  GetRuntime().Record(__func__);
+  if (program == nullptr) {
+    return CL_INVALID_PROGRAM;
+  }
+  if (pfn_notify != nullptr) {
+    pfn_notify(program, user_data);
+  }
+  return CL_SUCCESS;
+}
+
+cl_int CL_API_CALL clGetProgramInfo(cl_program program,
+                                    cl_program_info param_name,
+                                    size_t param_value_size, void* param_value,
+                                    size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (program == nullptr) {
+    return CL_INVALID_PROGRAM;
+  }
+  switch (param_name) {
+    case CL_PROGRAM_NUM_DEVICES:
+      return ReturnValue<cl_uint>(1, param_value_size, param_value,
+                                  param_value_size_ret);
+    case CL_PROGRAM_DEVICES:
+      return ReturnValue(program->device, param_value_size, param_value,
+                         param_value_size_ret);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_int CL_API_CALL clGetProgramBuildInfo(cl_program program,
+                                         cl_device_id device,
+                                         cl_program_build_info param_name,
+                                         size_t param_value_size,
+                                         void* param_value,
+                                         size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (program == nullptr) {
+    return CL_INVALID_PROGRAM;
+  }
+  switch (param_name) {
+    case CL_PROGRAM_BUILD_STATUS:
+      return ReturnValue<cl_build_status>(CL_BUILD_SUCCESS, param_value_size,
+                                          param_value, param_value_size_ret);
+    case CL_PROGRAM_BUILD_OPTIONS:
+    case CL_PROGRAM_BUILD_LOG:
+      return ReturnString("", param_value_size, param_value,
+                          param_value_size_ret);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_kernel CL_API_CALL clCreateKernel(cl_program program,
+                                     const char* kernel_name,
+                                     cl_int* errcode_ret) {
+  GetRuntime().Record(__func__);
+  if (program == nullptr) {
+    SetError(errcode_ret, CL_INVALID_PROGRAM);
+    return nullptr;
+  }
+  if (kernel_name == nullptr) {
+    SetError(errcode_ret, CL_INVALID_VALUE);
+    return nullptr;
+  }
+  auto kernel = new _cl_kernel;
+  Retain(program);
+  kernel->program = program;
+  kernel->name = kernel_name;
+  SetError(errcode_ret, CL_SUCCESS);
+  return kernel;
+}
+
+cl_int CL_API_CALL clRetainKernel(cl_kernel kernel) { return Retain(kernel); }
+
+cl_int CL_API_CALL clReleaseKernel(cl_kernel kernel) {
+  return Release(kernel);
+}
+
+cl_int CL_API_CALL clSetKernelArg(cl_kernel kernel, cl_uint arg_index,
+                                  size_t arg_size, const void* arg_value) {
+  GetRuntime().Record(__func__, arg_size);
+  if (kernel == nullptr) {
+    return CL_INVALID_KERNEL;
+  }
+  if (arg_value == nullptr) {
+    return CL_INVALID_ARG_VALUE;
+  }
+  _cl_kernel::Arg arg;
+  // Without kernel metadata, a pointer-sized argument is a buffer iff it
+  // holds a live memory object.
+  cl_mem mem = nullptr;
+  if (arg_size == sizeof(cl_mem)) {
+    memcpy(&mem, arg_value, sizeof(mem));
+  }
+  if (mem != nullptr && GetRuntime().IsMem(mem)) {
+    arg.mem = mem;
+  } else {
+    auto bytes = static_cast<const char*>(arg_value);
+    arg.value.assign(bytes, bytes + arg_size);
+  }
+  kernel->args[arg_index] = std::move(arg);
+  return CL_SUCCESS;
+}
+
+cl_int CL_API_CALL clGetKernelInfo(cl_kernel kernel,
+                                   cl_kernel_info param_name,
+                                   size_t param_value_size, void* param_value,
+                                   size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (kernel == nullptr) {
+    return CL_INVALID_KERNEL;
+  }
+  if (param_name == CL_KERNEL_FUNCTION_NAME) {
+    return ReturnString(kernel->name, param_value_size, param_value,
+                        param_value_size_ret);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_int CL_API_CALL clWaitForEvents(cl_uint num_events,
+                                   const cl_event* event_list) {
+  GetRuntime().Record(__func__);
+  return GetRuntime().WaitForEvents(num_events, event_list);
+}
+
+cl_int CL_API_CALL clGetEventInfo(cl_event event, cl_event_info param_name,
+                                  size_t param_value_size, void* param_value,
+                                  size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (event == nullptr) {
+    return CL_INVALID_EVENT;
+  }
+  switch (param_name) {
+    case CL_EVENT_COMMAND_EXECUTION_STATUS:
+      return ReturnValue(GetRuntime().GetStatus(event), param_value_size,
+                         param_value, param_value_size_ret);
+    case CL_EVENT_COMMAND_TYPE:
+      return ReturnValue(event->type, param_value_size, param_value,
+                         param_value_size_ret);
+    case CL_EVENT_COMMAND_QUEUE:
+      return ReturnValue(event->queue, param_value_size, param_value,
+                         param_value_size_ret);
+    case CL_EVENT_CONTEXT:
+      return ReturnValue(event->context, param_value_size, param_value,
+                         param_value_size_ret);
+    case CL_EVENT_REFERENCE_COUNT:
+      return ReturnValue<cl_uint>(event->refs, param_value_size, param_value,
+                                  param_value_size_ret);
+  }
+  return CL_INVALID_VALUE;
+}
+
+cl_event CL_API_CALL clCreateUserEvent(cl_context context,
+                                       cl_int* errcode_ret) {
+  GetRuntime().Record(__func__);
+  if (context == nullptr) {
+    SetError(errcode_ret, CL_INVALID_CONTEXT);
+    return nullptr;
+  }
+  SetError(errcode_ret, CL_SUCCESS);
+  return GetRuntime().CreateUserEvent(context);
+}
+
+cl_int CL_API_CALL clRetainEvent(cl_event event) { return Retain(event); }
+
+cl_int CL_API_CALL clReleaseEvent(cl_event event) { return Release(event); }
+
+cl_int CL_API_CALL clSetUserEventStatus(cl_event event,
+                                        cl_int execution_status) {
+  GetRuntime().Record(__func__);
+  return GetRuntime().SetUserEventStatus(event, execution_status);
+}
+
+cl_int CL_API_CALL clSetEventCallback(
+    cl_event event, cl_int command_exec_callback_type,
+    void(CL_CALLBACK* pfn_notify)(cl_event, cl_int, void*), void* user_data) {
+  GetRuntime().Record(__func__);
+  if (event == nullptr) {
+    return CL_INVALID_EVENT;
+  }
+  if (pfn_notify == nullptr || command_exec_callback_type != CL_COMPLETE) {
+    return CL_INVALID_VALUE;
+  }
+  return GetRuntime().SetEventCallback(event, pfn_notify, user_data);
+}
+
+cl_int CL_API_CALL clGetEventProfilingInfo(cl_event event,
+                                           cl_profiling_info param_name,
+                                           size_t param_value_size,
+                                           void* param_value,
+                                           size_t* param_value_size_ret) {
+  GetRuntime().Record(__func__);
+  if (event == nullptr) {
+    return CL_INVALID_EVENT;
+  }
+  cl_ulong value;
+  cl_int err = GetRuntime().GetProfilingInfo(event, param_name, &value);
+  if (err != CL_SUCCESS) {
+    return err;
+  }
+  return ReturnValue(value, param_value_size, param_value,
+                     param_value_size_ret);
+}
+
+cl_int CL_API_CALL clFlush(cl_command_queue command_queue) {
+  GetRuntime().Record(__func__);
+  return command_queue == nullptr ? CL_INVALID_COMMAND_QUEUE : CL_SUCCESS;
+}
+
+cl_int CL_API_CALL clFinish(cl_command_queue command_queue) {
+  GetRuntime().Record(__func__);
+  if (command_queue == nullptr) {
+    return CL_INVALID_COMMAND_QUEUE;
+  }
+  return GetRuntime().Finish(command_queue);
+}
+
+cl_int CL_API_CALL clEnqueueReadBuffer(cl_command_queue command_queue,
+                                       cl_mem buffer, cl_bool blocking_read,
+                                       size_t offset, size_t size, void* ptr,
+                                       cl_uint num_events_in_wait_list,
+                                       const cl_event* event_wait_list,
+                                       cl_event* event) {
+  GetRuntime().Record(__func__, size);
+  if (command_queue == nullptr) {
+    return CL_INVALID_COMMAND_QUEUE;
+  }
+  if (buffer == nullptr) {
+    return CL_INVALID_MEM_OBJECT;
+  }
+  if (ptr == nullptr || offset + size > buffer->size) {
+    return CL_INVALID_VALUE;
+  }
+  auto mem = Hold(buffer);
+  return GetRuntime().Enqueue(
+      command_queue, CL_COMMAND_READ_BUFFER, "d2h",
+      fake_icd::D2hTimeNanoSeconds(command_queue->device->config, size),
+      [mem, offset, size, ptr] { memcpy(ptr, mem->Data() + offset, size); },
+      num_events_in_wait_list, event_wait_list, event, blocking_read);
+}
+
+cl_int CL_API_CALL clEnqueueWriteBuffer(cl_command_queue command_queue,
+                                        cl_mem buffer, cl_bool blocking_write,
+                                        size_t offset, size_t size,
+                                        const void* ptr,
+                                        cl_uint num_events_in_wait_list,
+                                        const cl_event* event_wait_list,
+                                        cl_event* event) {
+  GetRuntime().Record(__func__, size);
+  if (command_queue == nullptr) {
+    return CL_INVALID_COMMAND_QUEUE;
+  }
+  if (buffer == nullptr) {
+    return CL_INVALID_MEM_OBJECT;
+  }
+  if (ptr == nullptr || offset + size > buffer->size) {
+    return CL_INVALID_VALUE;
+  }
+  auto mem = Hold(buffer);
+  return GetRuntime().Enqueue(
+      command_queue, CL_COMMAND_WRITE_BUFFER, "h2d",
+      fake_icd::H2dTimeNanoSeconds(command_queue->device->config, size),
+      [mem, offset, size, ptr] { memcpy(mem->Data() + offset, ptr, size); },
+      num_events_in_wait_list, event_wait_list, event, blocking_write);
+}
+
+cl_int CL_API_CALL clEnqueueMigrateMemObjects(
+    cl_command_queue command_queue, cl_uint num_mem_objects,
+    const cl_mem* mem_objects, cl_mem_migration_flags flags,
+    cl_uint num_events_in_wait_list, const cl_event* event_wait_list,
+    cl_event* event) {
+  if (command_queue == nullptr) {
+    GetRuntime().Record(__func__);
+    return CL_INVALID_COMMAND_QUEUE;
+  }
+  if (num_mem_objects == 0 || mem_objects == nullptr) {
+    GetRuntime().Record(__func__);
+    return CL_INVALID_VALUE;
+  }
+  std::vector<std::shared_ptr<_cl_mem>> mems;
+  size_t bytes = 0;
+  for (cl_uint i = 0; i < num_mem_objects; ++i) {
+    if (mem_objects[i] == nullptr) {
+      GetRuntime().Record(__func__);
+      return CL_INVALID_MEM_OBJECT;
+    }
+    mems.push_back(Hold(mem_objects[i]));
+    bytes += mem_objects[i]->size;
+  }
+  GetRuntime().Record(__func__, bytes);
+  const bool to_host = flags & CL_MIGRATE_MEM_OBJECT_HOST;
+  const auto& config = command_queue->device->config;
+  return GetRuntime().Enqueue(
+      command_queue, CL_COMMAND_MIGRATE_MEM_OBJECTS, to_host ? "d2h" : "h2d",
+      to_host ? fake_icd::D2hTimeNanoSeconds(config, bytes)
+              : fake_icd::H2dTimeNanoSeconds(config, bytes),
+      [mems, to_host] {
+        for (auto& mem : mems) {
+          void* host_ptr = mem->HostPtr();
+          if (host_ptr == nullptr || host_ptr == mem->Data()) {
+            continue;
+          }
+          if (to_host) {
+            memcpy(host_ptr, mem->Data(), mem->size);
+          } else {
+            memcpy(mem->Data(), host_ptr, mem->size);
+          }
+        }
+      },
+      num_events_in_wait_list, event_wait_list, event);
+}
+
+cl_int CL_API_CALL clEnqueueNDRangeKernel(
+    cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim,
+    const size_t* global_work_offset, const size_t* global_work_size,
+    const size_t* local_work_size, cl_uint num_events_in_wait_list,
+    const cl_event* event_wait_list, cl_event* event) {
+  GetRuntime().Record(__func__);
+  if (command_queue == nullptr) {
+    return CL_INVALID_COMMAND_QUEUE;
+  }
+  if (kernel == nullptr) {
+    return CL_INVALID_KERNEL;
+  }
+
+  // Arguments are captured at enqueue time.
+  std::vector<std::shared_ptr<_cl_mem>> mems;
+  std::vector<std::vector<char>> values;
+  for (auto& [index, arg] : kernel->args) {
+    if (index != mems.size()) {
+      return CL_INVALID_KERNEL_ARGS;
+    }
+    mems.push_back(arg.mem ? Hold(arg.mem) : nullptr);
+    values.push_back(arg.value);
+  }
+
+  const auto& config = command_queue->device->config;
+  auto [function, time_ns] = GetRuntime().GetKernel(kernel->name, config);
+  return GetRuntime().Enqueue(
+      command_queue, CL_COMMAND_NDRANGE_KERNEL, "kernel:" + kernel->name,
+      config.launch_latency_ns + time_ns,
+      [function = function, mems, values]() mutable {
+        if (!function) {
+          return;
+        }
+        std::vector<fake_icd::KernelArg> args;
+        for (size_t i = 0; i < mems.size(); ++i) {
+          if (mems[i]) {
+            args.push_back({mems[i]->Data(), mems[i]->size, true});
+          } else {
+            args.push_back({values[i].data(), values[i].size(), false});
+          }
+        }
+        function(args);
+      },
+      num_events_in_wait_list, event_wait_list, event);
+}
+
+cl_int CL_API_CALL clEnqueueTask(cl_command_queue command_queue,
+                                 cl_kernel kernel,
+                                 cl_uint num_events_in_wait_list,
+                                 const cl_event* event_wait_list,
+                                 cl_event* event) {
+  const size_t one = 1;
+  return clEnqueueNDRangeKernel(command_queue, kernel, 1, nullptr, &one, &one,
+                                num_events_in_wait_list, event_wait_list,
+                                event);
+}
+
+cl_int CL_API_CALL clEnqueueMarkerWithWaitList(
+    cl_command_queue command_queue, cl_uint num_events_in_wait_list,
+    const cl_event* event_wait_list, cl_event* event) {
+  GetRuntime().Record(__func__);
+  return GetRuntime().Enqueue(command_queue, CL_COMMAND_MARKER, "", 0, nullptr,
+                              num_events_in_wait_list, event_wait_list, event);
+}
+
+// XRT functions used by FRT to read kernel registers. The device handle is the
+// OpenCL device itself.
+void* xclGetXrtDevice(cl_device_id device, cl_int* errcode_ret) {
+  GetRuntime().Record(__func__);
+  *errcode_ret = device == nullptr ? CL_INVALID_DEVICE : CL_SUCCESS;
+  return device;
+}
+
+int xclOpenContext(void* handle, const unsigned char* xclbin_id,
+                   unsigned ip_index, bool shared) {
+  GetRuntime().Record(__func__);
+  return handle == nullptr ? -EINVAL : 0;
+}
+
+int xclCloseContext(void* handle, const unsigned char* xclbin_id,
+                    unsigned ip_index) {
+  GetRuntime().Record(__func__);
+  return handle == nullptr ? -EINVAL : 0;
+}
+
+int xclRegRead(void* handle, uint32_t ip_index, uint32_t offset,
+               uint32_t* datap) {
+  GetRuntime().Record(__func__);
+  if (handle == nullptr) {
+    return -EINVAL;
+  }
+  *datap = GetRuntime().GetRegister(ip_index, offset);
+  return 0;
+}
+
+}  // extern "C"
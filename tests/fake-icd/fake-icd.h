@@ -0,0 +1,144 @@
+#ifndef FPGA_RUNTIME_TESTS_FAKE_ICD_H_
+#define FPGA_RUNTIME_TESTS_FAKE_ICD_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <CL/cl.h>
+
+// A fake OpenCL implementation for exercising the OpenCL devices without
+// vendor runtimes or hardware.
+//
+// The fake is linked into the test executable and interposes the OpenCL entry
+// points, so `fpga::Instance` talks to it instead of the ICD loader. Enqueued
+// commands complete on a timer thread according to a per-device timing model.
+// Profiling timestamps follow the model exactly (not the wall clock that the
+// timer thread happens to wake up at), so tests can assert on them.
+namespace fake_icd {
+
+struct DeviceConfig {
+  // Reported as `CL_DEVICE_NAME`.
+  std::string name;
+  // Fixed cost of each transfer command.
+  int64_t transfer_latency_ns = 1000;
+  // Transfer bandwidth in bytes per nanosecond (i.e., GB/s).
+  double h2d_bandwidth = 10.;
+  double d2h_bandwidth = 10.;
+  // Fixed cost of each kernel launch.
+  int64_t launch_latency_ns = 2000;
+  // Execution time of kernels that do not specify their own.
+  int64_t kernel_time_ns = 10000;
+  // Wall time spent in `clCreateContext` and `clCreateProgramWithBinary`.
+  int64_t context_time_ns = 0;
+  int64_t program_time_ns = 0;
+  // Wall time spent in `clCreateProgramWithBinary` for a partial xclbin if the
+  // context has loaded a program before, i.e., the shell is already in place.
+  int64_t partial_program_time_ns = 0;
+  // Profiling timestamps are reported by a device clock that runs at
+  // `clock_rate` times the speed of the host clock and reads
+  // `clock_offset_ns` when the host clock reads zero.
+  int64_t clock_offset_ns = 0;
+  double clock_rate = 1.;
+};
+
+struct PlatformConfig {
+  // Reported as `CL_PLATFORM_NAME`.
+  std::string name;
+  std::vector<DeviceConfig> devices;
+};
+
+// Returns a platform that looks like the Xilinx runtime.
+PlatformConfig XilinxPlatform(const std::string& device_name);
+
+// Returns a platform that looks like the Intel FPGA runtime.
+PlatformConfig IntelPlatform(const std::string& board_name);
+
+// Replaces all platforms and drops registered kernels and recorded calls.
+// OpenCL objects that are still alive keep referring to the old devices.
+void Reset(const std::vector<PlatformConfig>& platforms);
+
+// A kernel argument as seen by a kernel function. Buffer arguments point to
+// the device copy of the buffer.
+struct KernelArg {
+  void* data;
+  size_t size;
+  bool is_buffer;
+};
+
+using KernelFunction = std::function<void(const std::vector<KernelArg>&)>;
+
+// Runs `function` whenever kernel `name` executes. If `time_ns` is
+// non-negative, it overrides `DeviceConfig::kernel_time_ns`.
+void RegisterKernel(const std::string& name, KernelFunction function,
+                    int64_t time_ns = -1);
+
+// An OpenCL API call observed by the fake.
+struct Call {
+  std::string name;
+  // Number of bytes moved, for transfer commands.
+  size_t bytes;
+  // Flags of `clCreateBuffer`.
+  uint64_t flags;
+};
+
+std::vector<Call> GetCalls();
+size_t CountCalls(const std::string& name);
+void ClearCalls();
+
+// Sets the control register at `offset` of the compute unit at `ip_index` of
+// the IP layout, which is read by `xclRegRead` and is zero unless set. Kernel
+// functions may set registers to expose counters.
+void SetRegister(unsigned ip_index, uint32_t offset, uint32_t value);
+
+// Makes `clFinish` return `error` after waiting for the queue, until `Reset`
+// or until `error` is `CL_SUCCESS` again.
+void SetFinishError(cl_int error);
+
+// Returns the modeled duration of a transfer command.
+int64_t H2dTimeNanoSeconds(const DeviceConfig& device, size_t bytes);
+int64_t D2hTimeNanoSeconds(const DeviceConfig& device, size_t bytes);
+
+// Describes a kernel in a synthetic bitstream.
+struct ArgSpec {
+  enum Cat {
+    kScalar = 0,
+    kMmap = 1,
+    kStream = 4,
+  };
+  std::string name;
+  std::string type;
+  Cat cat;
+  // Memory of memory-mapped arguments; "HOST" or "DDR" in xclbins, the
+  // buffer location in aocxs.
+  std::string memory = "DDR";
+};
+
+struct KernelSpec {
+  std::string name;
+  std::vector<ArgSpec> args;
+};
+
+// Returns a synthetic xclbin that `XilinxOpenclDevice` accepts. `target` is
+// one of "hw", "hw_em", and "csim". If `partial` is true, the xclbin only
+// reconfigures the PR region of the shell. Kernel `i` is at IP index `i`, and
+// argument `j` of a kernel is at control register offset `0x10 + 8 * j`.
+std::string MakeXclbin(const std::string& platform_vbnv,
+                       const std::vector<KernelSpec>& kernels,
+                       const std::string& target = "hw", bool partial = false);
+
+// Returns a synthetic aocx that `IntelOpenclDevice` accepts. The board has a
+// "DDR" global memory with `banks` banks.
+std::string MakeAocx(const std::string& board_name,
+                     const std::vector<KernelSpec>& kernels, int banks = 1);
+
+// Writes `content` to a new file in a temporary directory and returns its
+// path.
+std::string WriteTempFile(const std::string& name, const std::string& content);
+
+}  // namespace fake_icd
+
+#endif  // FPGA_RUNTIME_TESTS_FAKE_ICD_H_
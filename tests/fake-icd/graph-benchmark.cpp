@@ -0,0 +1,146 @@
+#include <cstdint>
+#include <ctime>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "fake-icd.h"
+#include "frt.h"
+
+DEFINE_int32(iterations, 1000, "number of invocations to measure");
+DEFINE_uint64(n, 1 << 10, "number of elements per vector");
+DEFINE_int32(batch, 16, "number of invocations per deferred submission");
+
+using clock_type = std::chrono::steady_clock;
+using std::clog;
+using std::endl;
+
+namespace {
+
+void VecAdd(const std::vector<fake_icd::KernelArg>& args) {
+  auto a = static_cast<const float*>(args[0].data);
+  auto b = static_cast<const float*>(args[1].data);
+  auto c = static_cast<float*>(args[2].data);
+  auto n = *static_cast<const uint64_t*>(args[3].data);
+  for (uint64_t i = 0; i < n; ++i) {
+    c[i] = a[i] + b[i];
+  }
+}
+
+int64_t ThreadCpuTimeNanoSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+}
+
+struct Result {
+  // Wall time per iteration, including waiting for the device.
+  double wall_ns;
+  // CPU time of the calling thread per iteration, i.e., host overhead.
+  double cpu_ns;
+  // Submissions to the driver per iteration.
+  double flushes;
+};
+
+template <typename Func>
+Result Measure(Func&& func) {
+  fake_icd::ClearCalls();
+  const auto wall_tic = clock_type::now();
+  const auto cpu_tic = ThreadCpuTimeNanoSeconds();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    func();
+  }
+  const auto cpu_toc = ThreadCpuTimeNanoSeconds();
+  const auto wall_toc = clock_type::now();
+  return {
+      std::chrono::duration<double, std::nano>(wall_toc - wall_tic).count() /
+          FLAGS_iterations,
+      static_cast<double>(cpu_toc - cpu_tic) / FLAGS_iterations,
+      static_cast<double>(fake_icd::CountCalls("clFlush")) / FLAGS_iterations,
+  };
+}
+
+void Report(const std::string& name, const Result& result) {
+  clog << name << ": " << result.wall_ns / 1e3 << " us/iteration wall, "
+       << result.cpu_ns / 1e3 << " us/iteration host CPU, " << result.flushes
+       << " flushes/iteration" << endl;
+}
+
+}  // namespace
+
+// Compares host overhead of repeated `Invoke` calls with replaying a captured
+// graph of the same operations, and with deferring the submission of batches
+// of invocations. The fake device takes no time, so wall time is dominated by
+// completion notification, and host CPU time by the runtime.
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, /* remove_flags = */ true);
+  google::InitGoogleLogging(argv[0]);
+
+  auto platform = fake_icd::XilinxPlatform("xilinx_fake_202010_1");
+  auto& device = platform.devices[0];
+  device.transfer_latency_ns = 0;
+  device.h2d_bandwidth = 1e9;
+  device.d2h_bandwidth = 1e9;
+  device.launch_latency_ns = 0;
+  device.kernel_time_ns = 0;
+  fake_icd::Reset({platform});
+  fake_icd::RegisterKernel("VecAdd", VecAdd);
+
+  const auto bitstream = fake_icd::WriteTempFile(
+      "vadd.xclbin",
+      fake_icd::MakeXclbin(device.name,
+                           {{"VecAdd",
+                             {
+                                 {"a", "float*", fake_icd::ArgSpec::kMmap},
+                                 {"b", "float*", fake_icd::ArgSpec::kMmap},
+                                 {"c", "float*", fake_icd::ArgSpec::kMmap},
+                                 {"n", "uint64_t", fake_icd::ArgSpec::kScalar},
+                             }}}));
+
+  const uint64_t n = FLAGS_n;
+  std::vector<float> a(n, 1.f), b(n, 2.f), c(n);
+  fpga::Instance instance(bitstream);
+
+  const auto invoke = Measure([&] {
+    instance.Invoke(fpga::WriteOnly(a.data(), n), fpga::WriteOnly(b.data(), n),
+                    fpga::ReadOnly(c.data(), n), n);
+  });
+
+  instance.BeginCapture();
+  instance.WriteToDevice();
+  instance.Exec();
+  instance.ReadFromDevice();
+  instance.Finish();
+  instance.EndCapture();
+  const auto replay = Measure([&] { instance.Replay(); });
+
+  instance.DeferSubmission(3 * FLAGS_batch);
+  int invocations = 0;
+  const auto deferred = Measure([&] {
+    instance.WriteToDevice();
+    instance.Exec();
+    instance.ReadFromDevice();
+    if (++invocations % FLAGS_batch == 0) {
+      instance.Finish();
+    }
+  });
+  instance.Finish();
+
+  for (uint64_t i = 0; i < n; ++i) {
+    CHECK_EQ(c[i], a[i] + b[i]) << "at index " << i;
+  }
+
+  Report("Invoke", invoke);
+  Report("Replay", replay);
+  Report("Deferred", deferred);
+  clog << "Host CPU time reduction: " << invoke.cpu_ns / replay.cpu_ns << "x"
+       << endl;
+
+  clog << "PASS!" << endl;
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include <cstdint>
+
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+#include "frt/instance_group.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using InstanceGroupTest = FakeIcdTest;
+
+TEST_F(InstanceGroupTest, FastMembersTakeMoreTasks) {
+  // Three cards of the same kind run the kernel at different speeds.
+  auto platform = XilinxPlatform("xilinx_fake_slow");
+  platform.devices[0].kernel_time_ns = 8'000'000;
+  platform.devices.push_back(platform.devices[0]);
+  platform.devices[1].name = "xilinx_fake_fast";
+  platform.devices[1].kernel_time_ns = 1'000'000;
+  platform.devices.push_back(platform.devices[0]);
+  platform.devices[2].name = "xilinx_fake_medium";
+  platform.devices[2].kernel_time_ns = 2'000'000;
+  Reset(platform);
+
+  std::vector<std::string> bitstreams;
+  for (const auto& device : platform.devices) {
+    bitstreams.push_back(
+        WriteTempFile(device.name + ".xclbin",
+                      MakeXclbin(device.name, kVecAddKernels)));
+  }
+  fpga::InstanceGroup group(bitstreams);
+
+  // Tasks are spread evenly before any throughput is known, and the faster
+  // cards take over the queue of the slow one.
+  constexpr int kTasks = 60;
+  std::atomic<int> done{0};
+  for (int i = 0; i < kTasks; ++i) {
+    group.Submit([&done, i](fpga::Instance& instance) {
+      constexpr uint64_t n = 1 << 10;
+      std::vector<float> a(n, i), b(n, 1.f), c(n);
+      instance.Invoke(fpga::WriteOnly(a.data(), n),
+                      fpga::WriteOnly(b.data(), n),
+                      fpga::ReadOnly(c.data(), n), n);
+      EXPECT_TRUE(IsVecAddResult(a.data(), b.data(), c.data(), n));
+      ++done;
+    });
+  }
+  group.Wait();
+  EXPECT_EQ(done, kTasks);
+
+  const auto stats = group.GetStats();
+  clog << stats << endl;
+  ASSERT_EQ(stats.members.size(), 3);
+  const auto& slow = stats.members[0];
+  const auto& fast = stats.members[1];
+  const auto& medium = stats.members[2];
+  EXPECT_EQ(slow.tasks + fast.tasks + medium.tasks, kTasks);
+  EXPECT_NEAR(slow.share + fast.share + medium.share, 1., 1e-9);
+  EXPECT_GT(fast.share, medium.share);
+  EXPECT_GT(medium.share, slow.share);
+  EXPECT_GT(fast.stolen_tasks + medium.stolen_tasks, 0);
+  // Throughput is learned from the compute time of each card.
+  EXPECT_GT(fast.throughput, 4 * slow.throughput);
+  EXPECT_GT(fast.utilization, 0.5);
+  EXPECT_LE(fast.utilization, 1.);
+
+  // Exceptions of tasks are rethrown by `Wait`.
+  group.Submit([](fpga::Instance&) { throw std::runtime_error("failed"); });
+  EXPECT_THROW(group.Wait(), std::runtime_error);
+}
+
+}  // namespace
+}  // namespace fake_icd
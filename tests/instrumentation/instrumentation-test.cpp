@@ -0,0 +1,93 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <iostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using InstrumentationTest = FakeIcdPlatformTest;
+
+TEST_P(InstrumentationTest, ObserversSeeEachCommand) {
+  constexpr uint64_t n = 1000;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(bitstream_);
+  std::vector<fpga::InstrumentationEvent> events;
+  const int id = fpga::AddInstrumentationObserver(
+      [&events](const fpga::InstrumentationEvent& event) {
+        events.push_back(event);
+      });
+  vadd.Invoke(instance);
+  vadd.Invoke(instance);
+  fpga::RemoveInstrumentationObserver(id);
+  vadd.Invoke(instance);
+
+  // Each invocation starts, enqueues 2 loads, 1 launch, and 1 store, and
+  // completes them in the same order.
+  ASSERT_EQ(events.size(), 2 * 9);
+  for (size_t i = 0; i < events.size(); ++i) {
+    const auto& event = events[i];
+    clog << event << endl;
+    EXPECT_EQ(event.instance_id, instance.GetInstrumentationId());
+    EXPECT_EQ(event.invocation, i / 9 + 1);
+    if (i > 0) {
+      EXPECT_GE(event.host_time_ns, events[i - 1].host_time_ns);
+    }
+    const size_t j = i % 9;
+    if (j == 0) {
+      EXPECT_EQ(event.kind, fpga::InstrumentationEvent::kInvocationStart);
+      continue;
+    }
+    EXPECT_EQ(event.kind, j <= 4 ? fpga::InstrumentationEvent::kEnqueue
+                                 : fpga::InstrumentationEvent::kComplete);
+    const auto& enqueue = events[i - (j > 4 ? 4 : 0)];
+    EXPECT_EQ(event.command, enqueue.command);
+    EXPECT_EQ(event.name, enqueue.name);
+    switch (event.command) {
+      case fpga::InstrumentationEvent::kLoad:
+        EXPECT_TRUE(event.name == "a" || event.name == "b") << event.name;
+        EXPECT_EQ(event.bytes, n * sizeof(float));
+        break;
+      case fpga::InstrumentationEvent::kLaunch:
+        EXPECT_EQ(event.arg_index, -1);
+        EXPECT_EQ(event.name, "VecAdd");
+        break;
+      case fpga::InstrumentationEvent::kStore:
+        EXPECT_EQ(event.arg_index, 2);
+        EXPECT_EQ(event.name, "c");
+        EXPECT_EQ(event.bytes, n * sizeof(float));
+        break;
+      default:
+        ADD_FAILURE() << "unexpected command " << event.command;
+    }
+    if (event.kind == fpga::InstrumentationEvent::kComplete) {
+      EXPECT_LE(event.queued_ns, event.start_ns);
+      EXPECT_LE(event.start_ns, event.end_ns);
+      EXPECT_LE(event.end_ns, event.host_time_ns);
+    }
+  }
+  EXPECT_EQ(events[3].command, fpga::InstrumentationEvent::kLaunch);
+  EXPECT_EQ(events[4].command, fpga::InstrumentationEvent::kStore);
+  EXPECT_LE(events[5].end_ns, events[7].start_ns);
+  EXPECT_LE(events[7].end_ns, events[8].start_ns);
+
+  // Instances are numbered in this process.
+  fpga::Instance other(bitstream_);
+  EXPECT_NE(other.GetInstrumentationId(), instance.GetInstrumentationId());
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVendors, InstrumentationTest, AllVendors(),
+                         VendorName);
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,82 @@
+#include <cstdint>
+
+#include <iostream>
+#include <numeric>
+#include <string>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using LiveStatsTest = FakeIcdTest;
+
+TEST_F(LiveStatsTest, InstancesArePublished) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  Reset(platform);
+  const auto bitstream = WriteBitstream(Vendor::kXilinx);
+  auto find = [&bitstream] {
+    for (const auto& stats : fpga::ReadLiveStats(getpid())) {
+      if (stats.bitstream == bitstream) {
+        return stats;
+      }
+    }
+    ADD_FAILURE() << "instance not published";
+    return fpga::LiveStats();
+  };
+
+  constexpr uint64_t n = 1000;
+  VecAddArgs vadd(n);
+  const size_t live_count = fpga::ReadLiveStats(getpid()).size();
+  {
+    fpga::Instance instance(bitstream);
+    EXPECT_EQ(fpga::ReadLiveStats(getpid()).size(), live_count + 1);
+    instance.EnableResultCache();
+    vadd.Invoke(instance);
+    vadd.Invoke(instance);
+    vadd.a[0] = 1;
+    vadd.Invoke(instance);
+
+    const auto stats = find();
+    clog << stats << endl;
+    EXPECT_EQ(stats.pid, getpid());
+    EXPECT_EQ(stats.device, platform.devices[0].name);
+    EXPECT_EQ(stats.invocations, 2);
+    EXPECT_EQ(stats.in_flight, 0);
+    EXPECT_EQ(stats.load_bytes, 2 * 2 * n * sizeof(float));
+    EXPECT_EQ(stats.store_bytes, 2 * n * sizeof(float));
+    EXPECT_GT(stats.compute_time_ns, 0);
+    EXPECT_EQ(stats.cache_hits, 1);
+    EXPECT_EQ(stats.cache_misses, 2);
+    EXPECT_GT(stats.LatencyPercentileNanoSeconds(0.5), 0);
+    EXPECT_GE(stats.LatencyPercentileNanoSeconds(0.99),
+              stats.LatencyPercentileNanoSeconds(0.5));
+
+    // Launches are in flight until `Finish`.
+    instance.WriteToDevice();
+    instance.Exec();
+    EXPECT_EQ(find().in_flight, 1);
+    instance.Finish();
+    const auto delta = find().Since(stats);
+    EXPECT_EQ(delta.invocations, 1);
+    EXPECT_EQ(delta.in_flight, 0);
+    EXPECT_EQ(delta.cache_hits, 0);
+    EXPECT_EQ(std::accumulate(delta.latency_histogram.begin(),
+                              delta.latency_histogram.end(), int64_t{0}),
+              1);
+  }
+  // Destroyed instances are no longer published.
+  EXPECT_EQ(fpga::ReadLiveStats(getpid()).size(), live_count);
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,45 @@
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using PartialReconfigurationTest = FakeIcdTest;
+
+TEST_F(PartialReconfigurationTest, ContextOfShellIsReused) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  auto& device = platform.devices[0];
+  device.context_time_ns = 20'000'000;
+  device.program_time_ns = 20'000'000;
+  device.partial_program_time_ns = 1'000'000;
+  Reset(platform);
+
+  const auto bitstream = WriteTempFile(
+      "vadd.pr.xclbin",
+      MakeXclbin(device.name, kVecAddKernels, "hw", /* partial = */ true));
+  auto first = Run(bitstream, 1 << 10).GetStartupProfile();
+  auto second = Run(bitstream, 1 << 10).GetStartupProfile();
+  clog << first << endl << second << endl;
+
+  // The second instance only reconfigures the PR region of the same shell.
+  EXPECT_EQ(CountCalls("clCreateContext"), 1);
+  EXPECT_TRUE(first.is_partial);
+  EXPECT_FALSE(first.is_context_reused);
+  EXPECT_GE(first.context_time_ns, device.context_time_ns);
+  EXPECT_GE(first.program_time_ns, device.program_time_ns);
+  EXPECT_TRUE(second.is_context_reused);
+  EXPECT_LT(second.context_time_ns, device.context_time_ns);
+  EXPECT_GE(second.program_time_ns, device.partial_program_time_ns);
+  EXPECT_LT(second.program_time_ns, device.program_time_ns);
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,40 @@
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using PreloadTest = FakeIcdTest;
+
+TEST_F(PreloadTest, ProgramIsReusedAcrossInstances) {
+  auto platform = MakePlatform(Vendor::kIntel);
+  platform.devices[0].program_time_ns = 10'000'000;
+  Reset(platform);
+  UseCleanTmpdir();
+
+  const auto bitstream = WriteBitstream(Vendor::kIntel);
+  auto first = Run(bitstream, 1 << 10).GetStartupProfile();
+  auto second = Run(bitstream, 1 << 10).GetStartupProfile();
+  clog << first << endl << second << endl;
+  EXPECT_FALSE(first.is_program_preloaded);
+  EXPECT_GE(first.program_time_ns, platform.devices[0].program_time_ns);
+  EXPECT_TRUE(second.is_program_preloaded);
+  EXPECT_LT(second.program_time_ns, platform.devices[0].program_time_ns);
+
+  // A device reconfigured behind the record's back is reconfigured again.
+  Reset(platform);
+  auto third = Run(bitstream, 1 << 10).GetStartupProfile();
+  EXPECT_FALSE(third.is_program_preloaded);
+  EXPECT_GE(third.program_time_ns, platform.devices[0].program_time_ns);
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,59 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+#include "frt/page_preparer.h"
+
+namespace fake_icd {
+namespace {
+
+using PrepareBufTest = FakeIcdTest;
+
+TEST_F(PrepareBufTest, PagesArePopulated) {
+  Reset(MakePlatform(Vendor::kXilinx));
+
+  // Freshly mapped memory has no pages until it is prepared.
+  constexpr uint64_t n = 1 << 24;
+  constexpr size_t size = n * sizeof(float) * 2;
+  void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(mem, MAP_FAILED);
+  auto a = static_cast<float*>(mem);
+  auto c = a + n;
+  fpga::Instance instance(WriteBitstream(Vendor::kXilinx));
+  instance.PrepareBuf(fpga::ReadOnly(c, n));
+  fpga::internal::PagePreparer::Wait(c, n * sizeof(float));
+  const long page_size = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> residency((n * sizeof(float) - 1) / page_size + 1);
+  ASSERT_EQ(mincore(c, n * sizeof(float), residency.data()), 0);
+  for (size_t i = 0; i < residency.size(); ++i) {
+    ASSERT_TRUE(residency[i] & 1) << "page " << i << " is not resident";
+  }
+
+  // Inputs are only read, so they may be read-only memory.
+  void* read_only = mmap(nullptr, n * sizeof(float), PROT_READ,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(read_only, MAP_FAILED);
+  auto b = static_cast<float*>(read_only);
+
+  // Transfers wait for preparations still in progress.
+  instance.PrepareBuf(fpga::WriteOnly(a, n));
+  instance.PrepareBuf(fpga::WriteOnly(b, n));
+  instance.Invoke(fpga::WriteOnly(a, n), fpga::WriteOnly(b, n),
+                  fpga::ReadOnly(c, n), n);
+  EXPECT_TRUE(IsVecAddResult(a, b, c, n));
+  ASSERT_EQ(munmap(read_only, n * sizeof(float)), 0);
+  ASSERT_EQ(munmap(mem, size), 0);
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,156 @@
+#include <cstdint>
+#include <cstring>
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace {
+
+// An in-memory byte pipe standing in for a kernel that echoes its input.
+class Loopback {
+ public:
+  void Write(const void* ptr, size_t size) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto data = static_cast<const char*>(ptr);
+    bytes_.insert(bytes_.end(), data, data + size);
+    write_sizes_.push_back(size);
+    cv_.notify_all();
+  }
+
+  void Read(void* ptr, size_t size) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [&] { return bytes_.size() >= size; });
+    std::copy_n(bytes_.begin(), size, static_cast<char*>(ptr));
+    bytes_.erase(bytes_.begin(), bytes_.begin() + size);
+  }
+
+  size_t Remaining() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return bytes_.size();
+  }
+
+  std::vector<size_t> WriteSizes() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return write_sizes_;
+  }
+
+ private:
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<char> bytes_;
+  std::vector<size_t> write_sizes_;
+};
+
+class LoopbackStream : public fpga::internal::StreamInterface {
+ public:
+  LoopbackStream(Loopback& loopback) : loopback_(loopback) {}
+  void Read(void* ptr, size_t size, bool eot) override {
+    loopback_.Read(ptr, size);
+  }
+  void Write(const void* ptr, size_t size, bool eot) override {
+    loopback_.Write(ptr, size);
+  }
+
+ private:
+  Loopback& loopback_;
+};
+
+void TestLoopback(size_t chunk_size) {
+  Loopback loopback;
+  fpga::WriteStream write_stream("in");
+  fpga::ReadStream read_stream("out");
+  write_stream.Attach(std::make_unique<LoopbackStream>(loopback));
+  read_stream.Attach(std::make_unique<LoopbackStream>(loopback));
+
+  // Records of all sizes, including empty ones and ones spanning many chunks.
+  std::mt19937 gen(chunk_size);
+  std::vector<std::string> records;
+  for (size_t i = 0; i < 1000; ++i) {
+    size_t size = i % 10 == 0 ? gen() % (chunk_size * 5) : gen() % 16;
+    std::string record(size, '\0');
+    for (auto& c : record) {
+      c = gen();
+    }
+    records.push_back(std::move(record));
+  }
+
+  std::thread writer_thread([&] {
+    fpga::RecordWriter writer(write_stream, chunk_size);
+    for (size_t i = 0; i < records.size(); ++i) {
+      writer.Write(records[i]);
+      if (i == records.size() / 2) {
+        writer.Flush();
+      }
+    }
+    writer.Close();
+  });
+
+  fpga::RecordReader reader(read_stream, chunk_size);
+  std::string_view record;
+  for (size_t i = 0; i < records.size(); ++i) {
+    CHECK(reader.Read(record)) << "record " << i;
+    CHECK_EQ(record, records[i]) << "record " << i;
+  }
+  CHECK(!reader.Read(record));
+  writer_thread.join();
+  CHECK_EQ(loopback.Remaining(), 0);
+
+  // Every transfer consists of whole chunks; large payloads are written
+  // directly in transfers of multiple chunks.
+  bool has_direct_write = false;
+  for (auto size : loopback.WriteSizes()) {
+    CHECK_EQ(size % chunk_size, 0);
+    has_direct_write |= size > chunk_size;
+  }
+  CHECK(has_direct_write);
+}
+
+void TestTyped() {
+  Loopback loopback;
+  fpga::WriteStream write_stream("in");
+  fpga::ReadStream read_stream("out");
+  write_stream.Attach(std::make_unique<LoopbackStream>(loopback));
+  read_stream.Attach(std::make_unique<LoopbackStream>(loopback));
+
+  const std::vector<float> values = {1.f, 2.f, 3.f};
+  fpga::RecordWriter writer(write_stream, 64);
+  writer.Write(values.data(), values.size());
+  writer.Close();
+
+  fpga::RecordReader reader(read_stream, 64);
+  const float* data;
+  size_t count;
+  CHECK(reader.Read(data, count));
+  CHECK_EQ(count, values.size());
+  CHECK_EQ(memcmp(data, values.data(), sizeof(float) * count), 0);
+  CHECK(!reader.Read(data, count));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+
+  for (size_t chunk_size : {4, 64, 4096}) {
+    TestLoopback(chunk_size);
+  }
+  TestTyped();
+
+  clog << "PASS!" << endl;
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <cstdint>
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using RegistersTest = FakeIcdTest;
+
+TEST_F(RegistersTest, RegistersAreSampled) {
+  Reset(MakePlatform(Vendor::kXilinx));
+  // `n` is argument 3 of kernel 0; the kernel exposes a counter in it.
+  constexpr uint32_t kOffset = 0x10 + 8 * 3;
+  SetRegister(0, kOffset, 5);
+  RegisterKernel(
+      "VecAdd",
+      [](const std::vector<KernelArg>& args) {
+        VecAdd(args);
+        SetRegister(0, kOffset, 42);
+      },
+      /* time_ns = */ 50'000'000);
+
+  constexpr uint64_t n = 1 << 10;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(WriteBitstream(Vendor::kXilinx));
+  EXPECT_EQ(instance.ReadRegister("n"), 5);
+  EXPECT_THROW(instance.ReadRegister("m"), std::invalid_argument);
+
+  // Registers are sampled while the kernel runs and once after it finishes.
+  instance.SampleRegisters({"n"}, std::chrono::milliseconds(5));
+  vadd.Invoke(instance);
+  const auto samples = instance.GetRegisterSamples();
+  ASSERT_GE(samples.size(), 5);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    EXPECT_EQ(samples[i].name, "n");
+    if (i > 0) {
+      EXPECT_GE(samples[i].time_ns, samples[i - 1].time_ns);
+    }
+  }
+  clog << samples.front() << endl;
+  EXPECT_EQ(samples.front().value, 5);
+  EXPECT_EQ(samples.back().value, 42);
+  EXPECT_GE(samples.back().time_ns, instance.GetTimeline().compute.end_ns);
+  // Compute units are opened once.
+  EXPECT_EQ(CountCalls("xclOpenContext"), 1);
+
+  // Disabled sampling keeps the samples of the last invocation.
+  instance.SampleRegisters({}, {});
+  vadd.Invoke(instance);
+  EXPECT_EQ(instance.GetRegisterSamples().size(), samples.size());
+}
+
+TEST_F(RegistersTest, IntelHasNoRegisterAccess) {
+  Reset(MakePlatform(Vendor::kIntel));
+  fpga::Instance instance(WriteBitstream(Vendor::kIntel));
+  EXPECT_THROW(
+      instance.SampleRegisters({"n"}, std::chrono::milliseconds(5)),
+      std::runtime_error);
+}
+
+}  // namespace
+}  // namespace fake_icd
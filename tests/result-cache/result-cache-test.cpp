@@ -0,0 +1,63 @@
+#include <cstdint>
+
+#include <algorithm>
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using ResultCacheTest = FakeIcdTest;
+
+TEST_F(ResultCacheTest, HitsSkipTheKernel) {
+  Reset(MakePlatform(Vendor::kXilinx));
+
+  constexpr uint64_t n = 1 << 16;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(WriteBitstream(Vendor::kXilinx));
+  fpga::ResultCacheOptions options;
+  options.sample_threshold_bytes = 1 << 12;
+  instance.EnableResultCache(options);
+  auto invoke = [&] {
+    std::fill(vadd.c.begin(), vadd.c.end(), -1.f);
+    vadd.Invoke(instance);
+    EXPECT_TRUE(vadd.IsResult());
+  };
+
+  invoke();
+  invoke();
+  EXPECT_EQ(CountCalls("clEnqueueNDRangeKernel"), 1);
+
+  // A change outside the sampled blocks is caught by verification.
+  vadd.a[1000] = -1.f;
+  invoke();
+  EXPECT_EQ(CountCalls("clEnqueueNDRangeKernel"), 2);
+  invoke();
+
+  const auto stats = instance.GetResultCacheStats();
+  clog << stats << endl;
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.evictions, 0);
+  EXPECT_EQ(stats.HitRate(), .5);
+  EXPECT_GT(stats.saved_time_ns, 0);
+
+  // With room for one entry, different inputs evict each other.
+  options.capacity_bytes = stats.size_bytes / 2;
+  instance.EnableResultCache(options);
+  invoke();
+  vadd.a[1000] = 0.f;
+  invoke();
+  EXPECT_EQ(instance.GetResultCacheStats().evictions, 1);
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,55 @@
+#include <cstdint>
+
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using TenantUsageTest = FakeIcdTest;
+
+TEST_F(TenantUsageTest, UsageIsChargedToTenants) {
+  auto platform = MakePlatform(Vendor::kXilinx);
+  auto device = platform.devices[0];
+  Reset(platform);
+  fpga::ResetTenantUsage();
+
+  constexpr uint64_t n = 1 << 10;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(WriteBitstream(Vendor::kXilinx));
+  instance.SetTenant("alice");
+  vadd.Invoke(instance);
+  vadd.Invoke(instance);
+  instance.SetTenant("bob");
+  vadd.Invoke(instance);
+  instance.SetTenant("");
+  vadd.Invoke(instance);
+
+  const auto usage = fpga::GetTenantUsage();
+  ASSERT_EQ(usage.size(), 2);
+  const auto& alice = usage.at("alice");
+  const auto& bob = usage.at("bob");
+  clog << alice << endl << bob << endl;
+  EXPECT_EQ(alice.invocations, 2);
+  EXPECT_EQ(bob.invocations, 1);
+  EXPECT_EQ(alice.load_bytes, 2 * 2 * n * sizeof(float));
+  EXPECT_EQ(alice.store_bytes, 2 * n * sizeof(float));
+  EXPECT_NEAR(alice.compute_time_ns,
+              2 * (device.launch_latency_ns + device.kernel_time_ns),
+              2 * kDurationToleranceNs);
+  EXPECT_NEAR(bob.load_time_ns,
+              H2dTimeNanoSeconds(device, 2 * n * sizeof(float)),
+              kDurationToleranceNs);
+  EXPECT_GE(bob.queue_time_ns, 0);
+}
+
+}  // namespace
+}  // namespace fake_icd
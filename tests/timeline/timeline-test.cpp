@@ -0,0 +1,61 @@
+#include <cstdint>
+
+#include <chrono>
+#include <iostream>
+#include <iterator>
+
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "fake-icd.h"
+#include "frt.h"
+
+using std::clog;
+using std::endl;
+
+namespace fake_icd {
+namespace {
+
+using TimelineTest = FakeIcdTest;
+
+TEST_F(TimelineTest, PhasesAreInHostTime) {
+  // The profiling clock of the device is far from the host clock.
+  auto platform = MakePlatform(Vendor::kXilinx);
+  platform.devices[0].clock_offset_ns = 5'000'000'000'000;
+  platform.devices[0].clock_rate = 1.001;
+  Reset(platform);
+
+  constexpr uint64_t n = 1 << 16;
+  VecAddArgs vadd(n);
+  fpga::Instance instance(WriteBitstream(Vendor::kXilinx));
+  auto now = [] {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  };
+  const int64_t begin = now();
+  vadd.Invoke(instance);
+  const int64_t end = now();
+
+  // Phases are mapped into the host time of the invocation, in order.
+  const auto timeline = instance.GetTimeline();
+  clog << timeline << endl;
+  constexpr int64_t kTolerance = 100'000;
+  const int64_t times[] = {
+      begin,
+      timeline.queued_ns,
+      timeline.load.begin_ns,
+      timeline.load.end_ns,
+      timeline.compute.begin_ns,
+      timeline.compute.end_ns,
+      timeline.store.begin_ns,
+      timeline.store.end_ns,
+      end,
+  };
+  for (int i = 1; i < std::size(times); ++i) {
+    EXPECT_LE(times[i - 1], times[i] + kTolerance) << "at " << i;
+  }
+}
+
+}  // namespace
+}  // namespace fake_icd
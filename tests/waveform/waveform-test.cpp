@@ -0,0 +1,102 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "fake-icd-fixture.h"
+#include "frt/tapa_fast_cosim_device.h"
+
+DECLARE_bool(xosim_save_waveform);
+DECLARE_string(xosim_waveform_begin);
+DECLARE_string(xosim_waveform_end);
+DECLARE_string(xosim_waveform_scopes);
+
+namespace fake_icd {
+namespace {
+
+using fpga::internal::CheckWaveformWindow;
+using fpga::internal::GetWaveformArgs;
+using fpga::internal::ParseSimulationTime;
+using fpga::internal::TapaFastCosimDevice;
+
+// Part of a help message that lists all waveform options.
+constexpr char kUsage[] = R"(
+  --save_waveform / --no_save_waveform
+  --waveform_begin TEXT
+  --waveform_end TEXT
+  --waveform_scope TEXT
+)";
+
+class WaveformTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_xosim_save_waveform = false;
+    FLAGS_xosim_waveform_begin.clear();
+    FLAGS_xosim_waveform_end.clear();
+    FLAGS_xosim_waveform_scopes.clear();
+  }
+};
+
+TEST_F(WaveformTest, SimulationTimesAreParsed) {
+  EXPECT_EQ(ParseSimulationTime("0s"), 0.);
+  EXPECT_EQ(ParseSimulationTime("250fs"), 250.);
+  EXPECT_EQ(ParseSimulationTime("1.5us"), 1.5e9);
+  EXPECT_EQ(ParseSimulationTime("500us"), 5e11);
+  EXPECT_EQ(ParseSimulationTime("2ms"), 2e12);
+  EXPECT_EQ(ParseSimulationTime("3s"), 3e15);
+  for (const char* value : {"", "us", "10", "10 us", "10usec", "-1us"}) {
+    EXPECT_LT(ParseSimulationTime(value), 0) << "of '" << value << "'";
+  }
+}
+
+TEST_F(WaveformTest, EmptyWindowIsRejected) {
+  FLAGS_xosim_waveform_begin = "600us";
+  FLAGS_xosim_waveform_end = "0.5ms";
+  EXPECT_THROW(CheckWaveformWindow(), std::invalid_argument);
+  EXPECT_THROW(TapaFastCosimDevice::New("vadd.xo", "PK\3\4"),
+               std::invalid_argument);
+  FLAGS_xosim_waveform_end = "600us";
+  EXPECT_THROW(CheckWaveformWindow(), std::invalid_argument);
+
+  // Windows open on either side are not empty.
+  FLAGS_xosim_waveform_end = "0.7ms";
+  EXPECT_NO_THROW(CheckWaveformWindow());
+  FLAGS_xosim_waveform_begin = "";
+  EXPECT_NO_THROW(CheckWaveformWindow());
+  FLAGS_xosim_waveform_begin = "600us";
+  FLAGS_xosim_waveform_end = "";
+  EXPECT_NO_THROW(CheckWaveformWindow());
+}
+
+TEST_F(WaveformTest, ArgsFollowFlags) {
+  using Args = std::vector<std::string>;
+  EXPECT_EQ(GetWaveformArgs(kUsage), Args());
+  FLAGS_xosim_save_waveform = true;
+  EXPECT_EQ(GetWaveformArgs(kUsage), Args({"--save_waveform"}));
+
+  // A window or scopes imply saving waveform.
+  FLAGS_xosim_save_waveform = false;
+  FLAGS_xosim_waveform_begin = "500us";
+  FLAGS_xosim_waveform_end = "600us";
+  FLAGS_xosim_waveform_scopes = "top.a,,top.b";
+  EXPECT_EQ(GetWaveformArgs(kUsage),
+            Args({
+                "--save_waveform",
+                "--waveform_begin=500us",
+                "--waveform_end=600us",
+                "--waveform_scope=top.a",
+                "--waveform_scope=top.b",
+            }));
+
+  // Options that the simulator does not list are left out, since it would
+  // reject them.
+  EXPECT_EQ(GetWaveformArgs("--save_waveform --waveform_begin_time TEXT"),
+            Args({"--save_waveform"}));
+  EXPECT_EQ(GetWaveformArgs("--save_waveform --waveform_end TEXT"),
+            Args({"--save_waveform", "--waveform_end=600us"}));
+}
+
+}  // namespace
+}  // namespace fake_icd
@@ -0,0 +1,108 @@
+#include <unistd.h>
+
+#include <cstdint>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "frt.h"
+
+DEFINE_int64(pid, 0, "process to monitor; 0 monitors all processes");
+DEFINE_double(interval, 1., "seconds between updates");
+DEFINE_int32(count, 0, "number of updates to show; 0 shows updates forever");
+
+using std::cout;
+using std::endl;
+using std::setw;
+
+namespace {
+
+using Key = std::tuple<int64_t, int, uint64_t>;
+
+Key GetKey(const fpga::LiveStats& stats) {
+  return Key(stats.pid, stats.slot, stats.generation);
+}
+
+std::string Basename(const std::string& path) {
+  return path.substr(path.find_last_of('/') + 1);
+}
+
+void PrintHeader(bool is_tty) {
+  if (is_tty) {
+    // Clears the screen and moves the cursor to the top left.
+    cout << "\033[2J\033[H";
+  }
+  cout << std::left << setw(8) << "PID" << setw(24) << "BITSTREAM" << setw(24)
+       << "DEVICE" << std::right << setw(10) << "INVOKE/s" << setw(7)
+       << "INFL" << setw(11) << "LOAD MB/s" << setw(11) << "STORE MB/s"
+       << setw(10) << "P50 us" << setw(10) << "P99 us" << setw(8) << "HIT%"
+       << endl;
+}
+
+// Prints the rates of `delta`, the counters accumulated in `seconds`.
+void PrintRow(const fpga::LiveStats& delta, double seconds) {
+  const double mb = 1e6 * seconds;
+  cout << std::left << setw(8) << delta.pid << setw(24)
+       << Basename(delta.bitstream).substr(0, 23) << setw(24)
+       << delta.device.substr(0, 23) << std::right << std::fixed
+       << std::setprecision(1) << setw(10) << delta.invocations / seconds
+       << setw(7) << delta.in_flight << setw(11) << delta.load_bytes / mb
+       << setw(11) << delta.store_bytes / mb << setw(10)
+       << delta.LatencyPercentileNanoSeconds(0.5) / 1e3 << setw(10)
+       << delta.LatencyPercentileNanoSeconds(0.99) / 1e3 << setw(8)
+       << delta.CacheHitRate() * 100 << endl;
+}
+
+}  // namespace
+
+// Shows the live rates of the FRT instances of running processes, as
+// published by the runtime in shared memory.
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, /* remove_flags = */ true);
+  if (FLAGS_interval <= 0) {
+    std::cerr << "ERROR: --interval must be positive" << endl;
+    return 1;
+  }
+
+  const bool is_tty = isatty(STDOUT_FILENO);
+  const auto interval = std::chrono::duration<double>(FLAGS_interval);
+  std::map<Key, fpga::LiveStats> previous;
+  auto last_read = std::chrono::steady_clock::now();
+  for (const auto& stats : fpga::ReadLiveStats(FLAGS_pid)) {
+    previous[GetKey(stats)] = stats;
+  }
+
+  for (int i = 0; FLAGS_count == 0 || i < FLAGS_count; ++i) {
+    std::this_thread::sleep_until(last_read + interval);
+    const auto now = std::chrono::steady_clock::now();
+    const double seconds =
+        std::chrono::duration<double>(now - last_read).count();
+    last_read = now;
+
+    std::map<Key, fpga::LiveStats> current;
+    for (const auto& stats : fpga::ReadLiveStats(FLAGS_pid)) {
+      current[GetKey(stats)] = stats;
+    }
+
+    PrintHeader(is_tty);
+    for (const auto& [key, stats] : current) {
+      // Instances that appeared during the interval are rated from zero.
+      auto it = previous.find(key);
+      PrintRow(it == previous.end() ? stats : stats.Since(it->second),
+               seconds);
+    }
+    if (!is_tty) {
+      cout << endl;
+    }
+    previous = std::move(current);
+  }
+  return 0;
+}